@@ -47,7 +47,7 @@
 #endif // COIN_INTERNAL
 
 class SbSphere;
-class coin_bspnode;
+class SbBSPTreeP;
 
 // *************************************************************************
 
@@ -70,6 +70,7 @@ public:
   void clear(const int initsize = 4);
   void findPoints(const SbSphere & sphere, SbIntList & array) const;
   int findClosest(const SbSphere & sphere, SbIntList & array) const;
+  void findClosest(const SbVec3f * pos, const int num, int * indices) const;
 
   const SbBox3f & getBBox() const;
   const SbVec3f * getPointsArrayPtr() const;
@@ -80,10 +81,9 @@ public:
   int findClosest(const SbSphere & sphere, SbList <int> & array) const;
 
 private:
-  friend class coin_bspnode;
   SbList <SbVec3f> pointsArray;
   SbList <void *> userdataArray;
-  coin_bspnode * topnode;
+  SbBSPTreeP * pimpl;
   int maxnodepoints;
   SbBox3f boundingBox;
 };
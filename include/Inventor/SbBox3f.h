@@ -74,6 +74,7 @@ public:
 
   void extendBy(const SbVec3f & pt);
   void extendBy(const SbBox3f & box);
+  void extendBy(const SbVec3f * points, const int num);
   void transform(const SbMatrix & matrix);
   void makeEmpty(void);
   SbBool isEmpty(void) const { return maxpt[0] < minpt[0]; }
@@ -86,6 +86,11 @@ private:
 
   class SoGetMatrixAction *getMatrixAction() const;
   void applyMatrixAction(const SoNode * const node) const;
+
+  friend class SoRayPickActionP; // recycles instances
+  void init(const SoPath * const path, SoState * const state,
+            const SbVec3f & objSpacePoint);
+  void clear(void);
 };
 
 #endif // !COIN_SOPICKEDPOINT_H
@@ -45,6 +45,10 @@ public:
   static SbBool isOverlayActive(void);
   static SbBool isConsoleActive(void);
 
+  static SbBool startTrace(const char * filename);
+  static void stopTrace(void);
+  static SbBool isTraceActive(void);
+
 }; // SoProfiler
 
 #endif // !COIN_SOPROFILER_H
@@ -94,6 +94,7 @@ public:
   const GLint * getPointIndices(void) const;
 
   void fit(void);
+  void reserve(const int numvertices);
   void depthSortTriangles(SoState * state);
 
 private:
@@ -72,8 +72,10 @@ private:
   ~SoGLDisplayList();
   SoGLDisplayListP * pimpl;
   void bindTexture(SoState *state);
+  int getRefCount(void) const;
 
   friend class SoGLCacheContextElement;
+  friend class SoGLImageP;
 };
 
 #endif // !COIN_SOGLDISPLAYLIST_H
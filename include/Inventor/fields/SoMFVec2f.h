@@ -54,6 +54,8 @@ public:
   void setValue(float x, float y);
   void setValue(const float xy[2]);
 
+private:
+  virtual SbBool readBinaryValues(SoInput * in, int num);
 }; // SoMFVec2f
 
 #endif // !COIN_SOMFVEC2F_H
@@ -53,6 +53,8 @@ public:
   void setValue(float x, float y, float z);
   void setValue(const float xyz[3]);
 
+private:
+  virtual SbBool readBinaryValues(SoInput * in, int num);
 }; // SoMFVec3f
 
 #endif // !COIN_SOMFVEC3F_H
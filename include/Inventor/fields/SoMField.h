@@ -58,6 +58,9 @@ public:
 
   static void initClass(void);
 
+  static void setValueSharing(const SbBool enable);
+  static SbBool isValueSharing(void);
+
   virtual void enableDeleteValues(void);
   virtual SbBool isDeleteValuesEnabled(void) const;
 
@@ -77,6 +80,9 @@ protected:
   void setChangedIndex(const int chgidx);
   void setChangedIndices(const int chgidx = -1, const int numchgind = 0);
 
+  SbBool shareValues(const SoMField & field);
+  void unshareValues(void);
+
   int num;
   int maxNum;
   SbBool userDataIsUsed;
@@ -263,7 +263,8 @@ public: \
   _valref_ operator=(_valref_ val) { this->setValue(val); return val; } \
   SbBool operator==(const _class_ & field) const; \
   SbBool operator!=(const _class_ & field) const { return !operator==(field); } \
-  _valtype_ * startEditing(void) { this->evaluate(); return this->values; } \
+  _valtype_ * startEditing(void) \
+    { this->evaluate(); this->unshareValues(); return this->values; } \
   void finishEditing(void) { this->valueChanged(); }
 
 #define SO_MFIELD_DERIVED_VALUE_HEADER(_class_, _valtype_, _valref_) \
@@ -340,6 +341,23 @@ _class_::operator=(const _class_ & field) \
 
 
 
+// Fields storing plain-old-data values through SoMField::allocValues()
+// share their value array on assignment, copy-on-write style.
+#define SO_MFIELD_SHARED_REQUIRED_SOURCE(_class_) \
+PRIVATE_TYPEID_SOURCE(_class_); \
+PRIVATE_EQUALITY_SOURCE(_class_); \
+const _class_ & \
+_class_::operator=(const _class_ & field) \
+{ \
+  if (!this->shareValues(field)) { \
+    this->allocValues(field.getNum()); \
+    this->setValues(0, field.getNum(), field.getValues(0)); \
+  } \
+  return *this; \
+}
+
+
+
 #define SO_MFIELD_VALUE_SOURCE(_class_, _valtype_, _valref_) \
 int \
 _class_::fieldSizeof(void) const \
@@ -372,6 +390,7 @@ _class_::find(_valref_ value, SbBool addifnotfound) \
 void \
 _class_::setValues(const int start, const int numarg, const _valtype_ * newvals) \
 { \
+  this->unshareValues(); \
   if (start+numarg > this->maxNum) this->allocValues(start+numarg); \
   else if (start+numarg > this->num) this->num = start+numarg; \
  \
@@ -385,6 +404,7 @@ _class_::setValues(const int start, const int numarg, const _valtype_ * newvals)
 void \
 _class_::set1Value(const int idx, _valref_ value) \
 { \
+  this->unshareValues(); \
   if (idx+1 > this->maxNum) this->allocValues(idx+1); \
   else if (idx+1 > this->num) this->num = idx+1; \
   this->values[idx] = value; \
@@ -499,7 +519,7 @@ _class_::allocValues(int number) \
 
 
 #define SO_MFIELD_SOURCE_MALLOC(_class_, _valtype_, _valref_) \
-  SO_MFIELD_REQUIRED_SOURCE(_class_); \
+  SO_MFIELD_SHARED_REQUIRED_SOURCE(_class_); \
   SO_MFIELD_CONSTRUCTOR_SOURCE(_class_); \
   SO_MFIELD_MALLOC_SOURCE(_class_, _valtype_); \
   SO_MFIELD_VALUE_SOURCE(_class_, _valtype_, _valref_)
@@ -189,6 +189,9 @@ public:
   static void endFrame(SoState * state);
   static void setDisplayListMaxAge(const uint32_t maxage);
   static void freeAllImages(SoState * state = NULL);
+  static void setTextureMemoryLimit(const size_t bytes);
+  static size_t getTextureMemoryLimit(void);
+  static size_t getTextureMemoryUsage(SoState * state);
 
   void setEndFrameCallback(void (*cb)(void *), void * closure);
   int getNumFramesSinceUsed(void) const;
@@ -74,7 +74,10 @@ public:
   void setNormal(const int32_t index, const SbVec3f &normal);
 
 private:
-  SbBSPTree bsp;
+  // takes the place of an SbBSPTree used in earlier versions, the
+  // reserved bytes keep the size of the class
+  class SoNormalGeneratorP * pimpl;
+  char reserved[sizeof(SbBSPTree) - sizeof(void *)];
   SbList <int> vertexList;
   SbList <int> vertexFace;
   SbList <SbVec3f> faceNormals;
@@ -84,7 +87,9 @@ private:
   SbBool perVertex;
   int currFaceStart;
 
-  SbVec3f calcFaceNormal();
+  int addPoint(const SbVec3f & v);
+  void resizePointTable(const int size);
+  void calcFaceNormals(void);
 };
 
 #endif // !COIN_SONORMALGENERATOR_H
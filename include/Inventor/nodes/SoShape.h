@@ -154,6 +154,7 @@ private:
   void validatePVCache(SoGLRenderAction * action);
   void getBBox(SoAction * action, SbBox3f & box, SbVec3f & center);
   void rayPickBoundingBox(SoRayPickAction * action);
+  void rayPickCached(SoRayPickAction * action);
   friend class soshape_primdata;           // internal class
   friend class so_generate_prim_private;   // a very private class
 };
@@ -511,6 +511,9 @@
 #ifndef GL_ELEMENT_ARRAY_BUFFER
 #define GL_ELEMENT_ARRAY_BUFFER 0x8893
 #endif /* GL_ELEMENT_ARRAY_BUFFER */
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif /* GL_PIXEL_PACK_BUFFER */
 #ifndef GL_READ_ONLY
 #define GL_READ_ONLY 0x88B8
 #endif /* GL_READ_ONLY */
@@ -230,6 +230,7 @@
 #include "misc/SoCompactPathList.h"
 
 #include "profiler/SoNodeProfiling.h"
+#include "profiler/SoProfilerTrace.h"
 
 // define this to debug path traversal
 // #define DEBUG_PATH_TRAVERSAL
@@ -474,6 +475,8 @@ SoAction::apply(SoNode * root)
   assert(this->traversalMethods);
   this->traversalMethods->setUp();
 
+  SoProfilerTraceScope trace("action", this->getTypeId().getName().getString());
+
   PRIVATE(this)->terminated = FALSE;
 
   this->currentpathcode = SoAction::NO_PATH;
@@ -629,6 +632,8 @@ SoAction::apply(SoPath * path)
   assert(this->traversalMethods);
   this->traversalMethods->setUp();
 
+  SoProfilerTraceScope trace("action", this->getTypeId().getName().getString());
+
   PRIVATE(this)->terminated = FALSE;
 
 #if COIN_DEBUG
@@ -690,6 +695,8 @@ SoAction::apply(const SoPathList & pathlist, SbBool obeysrules)
     return;
   }
 
+  SoProfilerTraceScope trace("action", this->getTypeId().getName().getString());
+
   // need to store these in case action in reapplied
   AppliedCode storedcode = PRIVATE(this)->appliedcode;
   SoActionP::AppliedData storeddata = PRIVATE(this)->applieddata;
@@ -106,6 +106,7 @@
 #include <Inventor/lists/SoPathList.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/misc/SoGLImage.h>
 #include <Inventor/nodes/SoGroup.h>
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/nodes/SoSeparator.h>
@@ -417,6 +418,52 @@
   \since TGS Inventor 4.0
 */
 
+/*!
+  \var SoGLRenderAction::TransparencyType SoGLRenderAction::WEIGHTED_BLENDED_OIT
+
+  This transparency type is a Coin extension versus the original SGI
+  Open Inventor API.
+
+  Order independent transparency in a single geometry pass. Opaque
+  objects are rendered first. The transparent objects are then
+  rendered once, with depth buffer updates disabled, into an offscreen
+  framebuffer object with two floating point color buffers. The first
+  buffer accumulates the alpha weighted colors and the alpha values,
+  the second the product of (1 - alpha) for all the fragments covering
+  a pixel. A GLSL program finally composites the average transparent
+  color on top of the opaque scene using the accumulated coverage.
+
+  The result does not depend on the order in which the transparent
+  objects (or the triangles within them) are rendered, and, unlike
+  SoGLRenderAction::SORTED_LAYERS_BLEND, the scene is only traversed
+  twice regardless of depth complexity. The price is that surfaces
+  seen through each other are averaged instead of being layered, so
+  overlapping surfaces with very different colors and high opacity
+  will look less correct than with the sorting modes. The per fragment
+  weight is 1, since the fragment color comes from the fixed function
+  pipeline or from application shaders, which Coin cannot modify.
+
+  Shaders, including the ones set up by SoShadowGroup, work unmodified
+  in this mode since OpenGL writes gl_FragColor to both color buffers.
+  SoSceneTexture2 nodes restore the framebuffer binding after
+  rendering their subgraph, and will themselves use this mode for
+  their scene when it is inherited from the state.
+
+  Like SoGLRenderAction::SORTED_LAYERS_BLEND, this mode overrides the
+  SoTransparencyType nodes in the scene graph.
+
+  OpenGL 2.0 with framebuffer objects, floating point textures and
+  per buffer blend functions (OpenGL 4.0 or \c
+  GL_ARB_draw_buffers_blend) is required. If not available,
+  SoGLRenderAction::SORTED_OBJECT_BLEND will be used instead.
+
+  The technique is described by Morgan McGuire and Louis Bavoil in
+  "Weighted Blended Order-Independent Transparency", Journal of
+  Computer Graphics Techniques, 2013.
+
+  \since Coin 4.0
+*/
+
 // FIXME:
 //  todo: - Add debug printout info concerning chosen blend method.
 //        - Add GL_[NV/HP]_occlusion_test support making the number of passes adaptive.
@@ -609,6 +656,25 @@ public:
   void setupFragmentProgram();
   void renderSortedLayersFP(const SoState * state);
 
+  // weighted blended order independent transparency
+  struct oitdata {
+    GLuint framebuffer;
+    GLuint textures[3]; // accumulation, revealage and depth
+    COIN_GLhandle program;
+  };
+  oitdata oit;
+  uint32_t oitcontext;
+  SbVec2s oitsize;
+  GLint oitprevframebuffer;
+  SbBool oitactive;
+
+  static SbBool canDoWeightedBlendedOIT(const cc_glglue * glue);
+  SbBool beginWeightedBlendedOIT(SoState * state);
+  void endWeightedBlendedOIT(SoState * state);
+  void setupWeightedBlendedOITBlending(SoState * state);
+  void freeWeightedBlendedOIT(void);
+  static void deleteWeightedBlendedOIT(void * closure, uint32_t contextid);
+
   void setupBlending(SoState * state, const SoGLRenderAction::TransparencyType newtype);
   void render(SoNode * node);
   void renderMulti(SoNode * node);
@@ -739,6 +805,16 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
   PRIVATE(this)->sortedobjectstrategy = BBOX_CENTER;
   PRIVATE(this)->sortedobjectcb = NULL;
   PRIVATE(this)->sortedobjectclosure = NULL;
+
+  PRIVATE(this)->oit.framebuffer = 0;
+  PRIVATE(this)->oit.textures[0] = 0;
+  PRIVATE(this)->oit.textures[1] = 0;
+  PRIVATE(this)->oit.textures[2] = 0;
+  PRIVATE(this)->oit.program = 0;
+  PRIVATE(this)->oitcontext = 0;
+  PRIVATE(this)->oitsize.setValue(0, 0);
+  PRIVATE(this)->oitprevframebuffer = 0;
+  PRIVATE(this)->oitactive = FALSE;
 }
 
 /*!
@@ -746,6 +822,7 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
 */
 SoGLRenderAction::~SoGLRenderAction()
 {
+  PRIVATE(this)->freeWeightedBlendedOIT();
 }
 
 /*!
@@ -1199,7 +1276,8 @@ SoGLRenderActionP::deleteNodeCB(void * userdata, SoSensor * COIN_UNUSED_ARG(sens
 
   Please note that this function considers the current transparency
   type when deciding what to do. It will delay rendering only when the
-  transparency type is DELAYED_* or SORTED_OBJECT_*. For other
+  transparency type is DELAYED_*, SORTED_OBJECT_* or
+  WEIGHTED_BLENDED_OIT. For other
   transparency types, transparent objects are rendered in the same
   pass as opaque objects.
 */
@@ -1254,7 +1332,8 @@ SoGLRenderAction::handleTransparency(SbBool istransparent)
   // for the transparency render pass(es) we should always render when
   // we get here.
   if (PRIVATE(this)->transparencyrender) {
-    if (PRIVATE(this)->transpdelayedrendertype == NONSOLID_SEPARATE_BACKFACE_PASS) {
+    if (PRIVATE(this)->transpdelayedrendertype == NONSOLID_SEPARATE_BACKFACE_PASS &&
+        transptype != WEIGHTED_BLENDED_OIT) {
       if (this->isRenderingTranspBackfaces()) {
         if (SoShapeHintsElement::getShapeType(this->state) == SoShapeHintsElement::SOLID) {
           // just delay this until the next pass
@@ -1289,6 +1368,7 @@ SoGLRenderAction::handleTransparency(SbBool istransparent)
     return FALSE;
   case SoGLRenderAction::DELAYED_ADD:
   case SoGLRenderAction::DELAYED_BLEND:
+  case SoGLRenderAction::WEIGHTED_BLENDED_OIT:
     PRIVATE(this)->addTransPath(this->getCurPath()->copy());
     SoCacheElement::setInvalid(TRUE);
     if (thestate->isCacheOpen()) {
@@ -1708,7 +1788,8 @@ SoGLRenderActionP::render(SoNode * node)
   SoLazyElement::setTransparencyType(state,
                                      static_cast<int32_t>(this->transparencytype));
 
-  if (this->transparencytype == SoGLRenderAction::SORTED_LAYERS_BLEND) {
+  if (this->transparencytype == SoGLRenderAction::SORTED_LAYERS_BLEND ||
+      this->transparencytype == SoGLRenderAction::WEIGHTED_BLENDED_OIT) {
     SoOverrideElement::setTransparencyTypeOverride(state, node, TRUE);
   }
 
@@ -1721,6 +1802,9 @@ SoGLRenderActionP::render(SoNode * node)
                                FALSE, !this->isDirectRendering(state));
   SoGLRenderPassElement::set(state, 0);
 
+  // start a new frame for the texture memory limit
+  SoGLImage::beginFrame(state);
+
   this->precblist.invokeCallbacks(static_cast<void *>(this->action));
 
   if (this->action->getNumPasses() > 1 && this->internal_multipass) {
@@ -1859,16 +1943,32 @@ SoGLRenderActionP::renderSingle(SoNode * node)
     return;
   }
 
+  if (this->transparencytype == SoGLRenderAction::WEIGHTED_BLENDED_OIT &&
+      !SoGLRenderActionP::canDoWeightedBlendedOIT(sogl_glue_instance(state))) {
+    SoDebugError::postWarning("renderSingle", "Weighted blended order independent "
+                              "transparency cannot be enabled due to missing OpenGL "
+                              "features. Rendering using SORTED_OBJECT_BLEND instead.");
+    this->transparencytype = SoGLRenderAction::SORTED_OBJECT_BLEND;
+    render(node); // Render again using the fallback transparency type.
+    return;
+  }
+
   this->action->beginTraversal(node);
 
   if ((this->transpobjpaths.getLength() || this->sorttranspobjpaths.getLength()) &&
       !this->action->hasTerminated()) {
 
+    // the transparent paths are blended into an offscreen buffer and
+    // composited on top of the opaque scene afterwards
+    const SbBool oit =
+      this->transparencytype == SoGLRenderAction::WEIGHTED_BLENDED_OIT &&
+      this->beginWeightedBlendedOIT(state);
+
     this->transparencyrender = TRUE;
     // disable writing into the z-buffer when rendering transparent
     // objects
 
-    if (!this->transpobjdepthwrite) {
+    if (!this->transpobjdepthwrite || oit) {
       SoDepthBufferElement::set(state, TRUE, FALSE,
                                 SoDepthBufferElement::LEQUAL,
                                 SbVec2f(0.0f, 1.0f));
@@ -1881,7 +1981,8 @@ SoGLRenderActionP::renderSingle(SoNode * node)
     default:
       break;
     case SoGLRenderAction::NONSOLID_SEPARATE_BACKFACE_PASS:
-      numtransppasses = 2;
+      // the back face pass is only needed to get the order right
+      if (!oit) numtransppasses = 2;
       break;
     }
 
@@ -1924,12 +2025,13 @@ SoGLRenderActionP::renderSingle(SoNode * node)
       this->action->apply(this->transpobjpaths, TRUE);
     }
     // enable writing again. FIXME: consider if it is OK to push/pop state instead
-    if (!this->transpobjdepthwrite) {
+    if (!this->transpobjdepthwrite || oit) {
       SoDepthBufferElement::set(state, TRUE, TRUE,
                                 SoDepthBufferElement::LEQUAL,
                                 SbVec2f(0.0f, 1.0f));
     }
     this->transparencyrender = FALSE;
+    if (oit) this->endWeightedBlendedOIT(state);
   }
 
   if (this->delayedpaths.getLength() && !this->action->hasTerminated()) {
@@ -1963,6 +2065,9 @@ SoGLRenderActionP::setupBlending(SoState * state, const SoGLRenderAction::Transp
   case SoGLRenderAction::SORTED_OBJECT_SORTED_TRIANGLE_ADD:
     SoLazyElement::enableBlending(state, GL_SRC_ALPHA, GL_ONE);
     break;
+  case SoGLRenderAction::WEIGHTED_BLENDED_OIT:
+    this->setupWeightedBlendedOITBlending(state);
+    break;
   default:
     assert(0 && "should not get here");
     break;
@@ -2040,6 +2145,284 @@ SoGLRenderAction::getTransparentDelayedObjectRenderType(void) const
   return PRIVATE(this)->transpdelayedrendertype;
 }
 
+// *************************************************************************
+
+namespace {
+
+  // Composites the averaged transparent color on top of the opaque
+  // scene. The first buffer holds (sum(rgb * a), sum(a)), the second
+  // the product of (1 - a), which is used as the alpha value so that
+  // the blend function (1 - alpha, alpha) gives the final color.
+  const char * oit_composite_program =
+    "uniform sampler2D accumtex;\n"
+    "uniform sampler2D revealtex;\n"
+    "uniform vec2 invsize;\n"
+    "void main(void)\n"
+    "{\n"
+    "  vec2 coord = gl_FragCoord.xy * invsize;\n"
+    "  float revealage = texture2D(revealtex, coord).r;\n"
+    "  if (revealage >= 1.0) discard;\n"
+    "  vec4 accum = texture2D(accumtex, coord);\n"
+    "  gl_FragColor = vec4(accum.rgb / max(accum.a, 0.00001), revealage);\n"
+    "}\n";
+
+  COIN_GLhandle
+  oit_create_program(const cc_glglue * glue)
+  {
+    COIN_GLhandle shader = glue->glCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB);
+    glue->glShaderSourceARB(shader, 1, &oit_composite_program, NULL);
+    glue->glCompileShaderARB(shader);
+    GLint ok = 0;
+    glue->glGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB, &ok);
+    if (!ok) {
+      glue->glDeleteObjectARB(shader);
+      return 0;
+    }
+    COIN_GLhandle program = glue->glCreateProgramObjectARB();
+    glue->glAttachObjectARB(program, shader);
+    glue->glLinkProgramARB(program);
+    // flagged for deletion, freed together with the program
+    glue->glDeleteObjectARB(shader);
+    glue->glGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB, &ok);
+    if (!ok) {
+      glue->glDeleteObjectARB(program);
+      return 0;
+    }
+    glue->glUseProgramObjectARB(program);
+    glue->glUniform1iARB(glue->glGetUniformLocationARB(program, "accumtex"), 0);
+    glue->glUniform1iARB(glue->glGetUniformLocationARB(program, "revealtex"), 1);
+    glue->glUseProgramObjectARB(0);
+    return program;
+  }
+
+} // namespace
+
+SbBool
+SoGLRenderActionP::canDoWeightedBlendedOIT(const cc_glglue * glue)
+{
+  return
+    cc_glglue_glversion_matches_at_least(glue, 2, 0, 0) &&
+    cc_glglue_has_framebuffer_objects(glue) &&
+    glue->has_arb_shader_objects &&
+    glue->has_depth_texture &&
+    glue->glDrawBuffers != NULL &&
+    glue->glBlendFunci != NULL &&
+    (cc_glglue_glversion_matches_at_least(glue, 3, 0, 0) ||
+     cc_glglue_glext_supported(glue, "GL_ARB_texture_float"));
+}
+
+//
+// Sets up the offscreen buffers and binds them for rendering the
+// transparent paths. Returns FALSE if this failed, in which case
+// the transparent paths are blended directly into the current
+// framebuffer.
+//
+SbBool
+SoGLRenderActionP::beginWeightedBlendedOIT(SoState * state)
+{
+  const cc_glglue * glue = sogl_glue_instance(state);
+  const uint32_t contextid = SoGLCacheContextElement::get(state);
+  if (contextid != this->oitcontext) {
+    this->freeWeightedBlendedOIT();
+    this->oitcontext = contextid;
+  }
+
+  // the buffers also cover the area below and to the left of the
+  // viewport, so that the transparent objects can be rendered without
+  // changing the viewport
+  const SbViewportRegion & vp = SoViewportRegionElement::get(state);
+  const SbVec2s origin = vp.getViewportOriginPixels();
+  const SbVec2s vpsize = vp.getViewportSizePixels();
+  const SbVec2s size(origin[0] + vpsize[0], origin[1] + vpsize[1]);
+  if (vpsize[0] <= 0 || vpsize[1] <= 0) return FALSE;
+
+  if (this->oit.program == 0) {
+    this->oit.program = oit_create_program(glue);
+    if (this->oit.program == 0) {
+      SoDebugError::postWarning("SoGLRenderActionP::beginWeightedBlendedOIT",
+                                "Unable to compile the compositing program. "
+                                "Rendering using SORTED_OBJECT_BLEND instead.");
+      this->transparencytype = SoGLRenderAction::SORTED_OBJECT_BLEND;
+      return FALSE;
+    }
+  }
+
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &this->oitprevframebuffer);
+  glPushAttrib(GL_TEXTURE_BIT);
+
+  if (this->oit.framebuffer == 0) {
+    cc_glglue_glGenFramebuffers(glue, 1, &this->oit.framebuffer);
+    glGenTextures(3, this->oit.textures);
+    this->oitsize.setValue(0, 0);
+  }
+  if (size != this->oitsize) {
+    for (int i = 0; i < 3; i++) {
+      glBindTexture(GL_TEXTURE_2D, this->oit.textures[i]);
+      if (i < 2) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, size[0], size[1],
+                     0, GL_RGBA, GL_FLOAT, NULL);
+      }
+      else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size[0], size[1],
+                     0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+      }
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    cc_glglue_glBindFramebuffer(glue, GL_FRAMEBUFFER_EXT, this->oit.framebuffer);
+    cc_glglue_glFramebufferTexture2D(glue, GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT,
+                                     GL_TEXTURE_2D, this->oit.textures[0], 0);
+    cc_glglue_glFramebufferTexture2D(glue, GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT1_EXT,
+                                     GL_TEXTURE_2D, this->oit.textures[1], 0);
+    cc_glglue_glFramebufferTexture2D(glue, GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT,
+                                     GL_TEXTURE_2D, this->oit.textures[2], 0);
+    const GLenum status = cc_glglue_glCheckFramebufferStatus(glue, GL_FRAMEBUFFER_EXT);
+    cc_glglue_glBindFramebuffer(glue, GL_FRAMEBUFFER_EXT, (GLuint) this->oitprevframebuffer);
+    if (status != GL_FRAMEBUFFER_COMPLETE_EXT) {
+      glPopAttrib();
+      SoDebugError::postWarning("SoGLRenderActionP::beginWeightedBlendedOIT",
+                                "Framebuffer incomplete (status 0x%x). Rendering "
+                                "using SORTED_OBJECT_BLEND instead.", status);
+      this->transparencytype = SoGLRenderAction::SORTED_OBJECT_BLEND;
+      this->freeWeightedBlendedOIT();
+      return FALSE;
+    }
+    this->oitsize = size;
+  }
+
+  // transparent fragments behind opaque objects must be discarded,
+  // so the opaque depth buffer is copied into the depth attachment
+  glBindTexture(GL_TEXTURE_2D, this->oit.textures[2]);
+  glCopyTexSubImage2D(GL_TEXTURE_2D, 0, origin[0], origin[1],
+                      origin[0], origin[1], vpsize[0], vpsize[1]);
+  glPopAttrib();
+
+  cc_glglue_glBindFramebuffer(glue, GL_FRAMEBUFFER_EXT, this->oit.framebuffer);
+
+  float clearcolor[4];
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, clearcolor);
+  glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glDrawBuffer(GL_COLOR_ATTACHMENT1_EXT);
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glClearColor(clearcolor[0], clearcolor[1], clearcolor[2], clearcolor[3]);
+
+  static const GLenum buffers[] = {
+    GL_COLOR_ATTACHMENT0_EXT, GL_COLOR_ATTACHMENT1_EXT
+  };
+  glue->glDrawBuffers(2, buffers);
+
+  this->oitactive = TRUE;
+  return TRUE;
+}
+
+//
+// Switches back to the previous framebuffer and composites the
+// transparent objects on top of it.
+//
+void
+SoGLRenderActionP::endWeightedBlendedOIT(SoState * state)
+{
+  const cc_glglue * glue = sogl_glue_instance(state);
+  this->oitactive = FALSE;
+
+  cc_glglue_glBindFramebuffer(glue, GL_FRAMEBUFFER_EXT, (GLuint) this->oitprevframebuffer);
+
+  glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT |
+               GL_TEXTURE_BIT | GL_TRANSFORM_BIT);
+  glDisable(GL_DEPTH_TEST);
+  glDepthMask(GL_FALSE);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_ALPHA_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+  cc_glglue_glActiveTexture(glue, GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, this->oit.textures[1]);
+  cc_glglue_glActiveTexture(glue, GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, this->oit.textures[0]);
+
+  glue->glUseProgramObjectARB(this->oit.program);
+  glue->glUniform2fARB(glue->glGetUniformLocationARB(this->oit.program, "invsize"),
+                       1.0f / float(this->oitsize[0]), 1.0f / float(this->oitsize[1]));
+
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+
+  glBegin(GL_QUADS);
+  glVertex2f(-1.0f, -1.0f);
+  glVertex2f(1.0f, -1.0f);
+  glVertex2f(1.0f, 1.0f);
+  glVertex2f(-1.0f, 1.0f);
+  glEnd();
+
+  glPopMatrix();
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+
+  glue->glUseProgramObjectARB(0);
+  glPopAttrib();
+
+  // the blend functions were changed behind the back of the lazy
+  // element
+  SoGLLazyElement::getInstance(state)->reset(state, SoLazyElement::BLENDING_MASK);
+}
+
+void
+SoGLRenderActionP::setupWeightedBlendedOITBlending(SoState * state)
+{
+  if (!this->oitactive) {
+    // falling back to plain blending, or rendering delayed paths
+    SoLazyElement::enableBlending(state, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return;
+  }
+  // (rgb * a, a) is accumulated in the first buffer ...
+  SoLazyElement::enableSeparateBlending(state, GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
+  SoGLLazyElement::getInstance(state)->send(state, SoLazyElement::BLENDING_MASK);
+  // ... and (1 - a) multiplied into the second. The lazy element only
+  // tracks a single blend function, so this is set for every shape.
+  sogl_glue_instance(state)->glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void
+SoGLRenderActionP::freeWeightedBlendedOIT(void)
+{
+  if (this->oit.framebuffer != 0 || this->oit.program != 0) {
+    SoGLRenderActionP::oitdata * data = new SoGLRenderActionP::oitdata(this->oit);
+    SoGLCacheContextElement::scheduleDeleteCallback(this->oitcontext,
+                                                    SoGLRenderActionP::deleteWeightedBlendedOIT,
+                                                    data);
+  }
+  this->oit.framebuffer = 0;
+  this->oit.textures[0] = this->oit.textures[1] = this->oit.textures[2] = 0;
+  this->oit.program = 0;
+  this->oitsize.setValue(0, 0);
+}
+
+void
+SoGLRenderActionP::deleteWeightedBlendedOIT(void * closure, uint32_t contextid)
+{
+  const cc_glglue * glue = cc_glglue_instance(contextid);
+  SoGLRenderActionP::oitdata * data = static_cast<SoGLRenderActionP::oitdata *>(closure);
+  if (data->framebuffer != 0) {
+    cc_glglue_glDeleteFramebuffers(glue, 1, &data->framebuffer);
+    glDeleteTextures(3, data->textures);
+  }
+  if (data->program != 0) {
+    glue->glDeleteObjectARB(data->program);
+  }
+  delete data;
+}
+
 void
 SoGLRenderActionP::doSortedLayersBlendRendering(const SoState * state, SoNode * node)
 {
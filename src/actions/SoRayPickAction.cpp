@@ -170,12 +170,16 @@
 class SoRayPickActionP {
 public:
   SoRayPickActionP(void) : owner(NULL) { }
+  ~SoRayPickActionP();
 
   // Hidden private methods.
 
   SbBool isBetweenPlanesWS(const SbVec3d & intersection,
                            const SoClipPlaneElement * planes) const;
   void cleanupPickedPoints(void);
+  void recyclePickedPoints(const int start);
+  SoPickedPoint * createPickedPoint(const SoPath * path, SoState * state,
+                                    const SbVec3f & objectspacepoint);
   void setFlag(const unsigned int flag);
   void clearFlag(const unsigned int flag);
   SbBool isFlagSet(const unsigned int flag) const;
@@ -210,6 +214,12 @@ public:
   SoPickedPointList pickedpointlist;
   SbList <double> ppdistance;
 
+  // Picked points which have been discarded, either because a closer
+  // intersection was found or because the action was applied again,
+  // are kept here and reused instead of being reallocated.
+  SbList <SoPickedPoint *> recycledpoints;
+  enum { MAX_RECYCLED_POINTS = 256 };
+
   unsigned int flags;
   SbBool objectspacevalid; // FIXME: why not a flag?
 
@@ -429,6 +439,11 @@ SoRayPickAction::isPickAll(void) const
 
 /*!
   Returns a list of the picked points.
+
+  The picked points are owned by the action, and are only valid until
+  the action is applied again, reset() is called or the action is
+  destructed. The instances are then reused for later picks, so use
+  SoPickedPoint::copy() on the points you want to keep.
 */
 const SoPickedPointList &
 SoRayPickAction::getPickedPointList(void) const
@@ -1023,13 +1038,14 @@ SoRayPickAction::addIntersection(const SbVec3f & objectspacepoint_in, SbBool fro
     // got to test if new candidate is closer than old one
     if (dist >= PRIVATE(this)->ppdistance[0]) return NULL; // farther
     // remove old point
-    PRIVATE(this)->pickedpointlist.truncate(0);
+    PRIVATE(this)->recyclePickedPoints(0);
     PRIVATE(this)->ppdistance.truncate(0);
   }
 
   // create the new picked point
-  SoPickedPoint * pp = new SoPickedPoint(this->getCurPath(),
-                                         this->state, objectspacepoint_in);
+  SoPickedPoint * pp = PRIVATE(this)->createPickedPoint(this->getCurPath(),
+                                                        this->state,
+                                                        objectspacepoint_in);
   PRIVATE(this)->pickedpointlist.append(pp);
   PRIVATE(this)->ppdistance.append(dist);
   PRIVATE(this)->clearFlag(SoRayPickActionP::PPLIST_IS_SORTED);
@@ -1086,14 +1102,55 @@ SoRayPickActionP::isBetweenPlanesWS(const SbVec3d & intersection,
   return TRUE;
 }
 
+SoRayPickActionP::~SoRayPickActionP()
+{
+  for (int i = 0; i < this->recycledpoints.getLength(); i++) {
+    delete this->recycledpoints[i];
+  }
+}
+
 void
 SoRayPickActionP::cleanupPickedPoints(void)
 {
-  this->pickedpointlist.truncate(0); // this will delete all SoPickedPoint instances in the list
+  this->recyclePickedPoints(0);
   this->ppdistance.truncate(0);
   this->clearFlag(PPLIST_IS_SORTED);
 }
 
+// Removes the picked points from index start and onwards from the
+// list, keeping them for reuse. The application can't hold on to
+// these pointers anyway, as the list would otherwise delete them
+// right here.
+void
+SoRayPickActionP::recyclePickedPoints(const int start)
+{
+  const int n = this->pickedpointlist.getLength();
+  for (int i = start; i < n; i++) {
+    SoPickedPoint * pp = this->pickedpointlist[i];
+    if (this->recycledpoints.getLength() < MAX_RECYCLED_POINTS) {
+      pp->clear();
+      this->recycledpoints.append(pp);
+    }
+    else {
+      delete pp;
+    }
+  }
+  // don't call SoPickedPointList::truncate(), which deletes the points
+  this->pickedpointlist.SbPList::truncate(start);
+}
+
+SoPickedPoint *
+SoRayPickActionP::createPickedPoint(const SoPath * path, SoState * state,
+                                    const SbVec3f & objectspacepoint)
+{
+  if (this->recycledpoints.getLength()) {
+    SoPickedPoint * pp = this->recycledpoints.pop();
+    pp->init(path, state, objectspacepoint);
+    return pp;
+  }
+  return new SoPickedPoint(path, state, objectspacepoint);
+}
+
 void
 SoRayPickActionP::setFlag(const unsigned int flag)
 {
@@ -1179,3 +1236,64 @@ SoRayPickActionP::setPickStyleFlags(SoState * state)
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoFullPath.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+// picked points are reused between applications of the action, so
+// check that the results are still right, and that a path the
+// application held on to isn't touched
+BOOST_AUTO_TEST_CASE(reusedPickedPoints)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  const int num = 10;
+  for (int i = 0; i < num; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * trans = new SoTranslation;
+    trans->translation.setValue(0.0f, 0.0f, float(i) * 3.0f);
+    sep->addChild(trans);
+    sep->addChild(new SoCube);
+    root->addChild(sep);
+  }
+
+  SoRayPickAction rp(SbViewportRegion(100, 100));
+  rp.setRay(SbVec3f(0.0f, 0.0f, 100.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rp.apply(root);
+  SoPickedPoint * pp = rp.getPickedPoint();
+  BOOST_REQUIRE(pp);
+  SoPath * kept = pp->getPath();
+  kept->ref();
+  const int keptlength = static_cast<SoFullPath *>(kept)->getLength();
+  BOOST_CHECK(static_cast<SoFullPath *>(kept)->getNode(1) == root->getChild(num - 1));
+
+  rp.setPickAll(TRUE);
+  for (int i = 0; i < 3; i++) {
+    rp.apply(root);
+    BOOST_CHECK_EQUAL(rp.getPickedPointList().getLength(), 2 * num);
+    pp = rp.getPickedPoint(0);
+    BOOST_REQUIRE(pp);
+    BOOST_CHECK(pp->getPath() != kept);
+    BOOST_CHECK_EQUAL(pp->getPoint()[2], float(num - 1) * 3.0f + 1.0f);
+  }
+
+  rp.setPickAll(FALSE);
+  rp.setRay(SbVec3f(0.0f, 0.0f, -100.0f), SbVec3f(0.0f, 0.0f, 1.0f));
+  rp.apply(root);
+  pp = rp.getPickedPoint();
+  BOOST_REQUIRE(pp);
+  BOOST_CHECK(static_cast<SoFullPath *>(pp->getPath())->getNode(1) == root->getChild(0));
+  BOOST_CHECK(pp->getDetail() != NULL);
+
+  BOOST_CHECK_EQUAL(static_cast<SoFullPath *>(kept)->getLength(), keptlength);
+  BOOST_CHECK(static_cast<SoFullPath *>(kept)->getNode(1) == root->getChild(num - 1));
+  kept->unref();
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
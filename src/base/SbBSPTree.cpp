@@ -30,19 +30,21 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
 #include <Inventor/SbBSPTree.h>
 #include <Inventor/SbSphere.h>
+#include <Inventor/C/tidbits.h>
 #include <cassert>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <cfloat>
 
 #include "coindefs.h"
-
-// define this to do a sorted split (slower, but more efficient?)
-//#define BSP_SORTED_SPLIT
-
-
+#include "base/SbKdTree.h"
 
 /*!
   \class SbBSPTree SbBSPTree.h Inventor/SbBSPTree.h
@@ -53,321 +55,205 @@
   This class can be used to organize searches for 3D points or normals
   in a set in O(log(n)) time.
 
+  Points are found by their exact coordinates through a hash table,
+  so adding points and looking them up does not depend on the spatial
+  layout of the points. The range and closest point queries use a
+  balanced k-d tree, which is built the first time it's needed after
+  points have been added or removed. Since the queries may rebuild
+  the k-d tree, you should not query the same SbBSPTree from several
+  threads at the same time.
+
+  The COIN_BSPTREE_THREADS environment variable can be set to the
+  number of threads to use when building the k-d tree for large point
+  sets.
+
   Note: SbBSPTree is an extension to the original Open Inventor API.
 */
 
+// *************************************************************************
 
-class coin_bspnode
-{
-public:
-  coin_bspnode(SbList <SbVec3f> *array);
-  ~coin_bspnode();
-
-  int addPoint(const SbVec3f &pt, const int maxpts);
-  int findPoint(const SbVec3f &pt) const;
-  void findPoints(const SbSphere &sphere, SbList <int> &array);
-  void findPoints(const SbSphere &sphere, SbIntList & array);
-  int removePoint(const SbVec3f &pt);
-  void updateIndex(const SbVec3f & pt, int previdx, int newidx);
-
-private:
-  void sort();
-  void split();
-  int leftOf(const SbVec3f &pt) const;
-
-  enum {
-    // do not change these values!
-    DIM_YZ = 0,
-    DIM_XZ = 1,
-    DIM_XY = 2,
-    DIM_NONE
-  };
-
-  coin_bspnode *left;
-  coin_bspnode *right;
-  int dimension;   // which dimension?
-  double position;  // position in dimension (double to avoid floating point precision problems)
-  SbList <int> indices;
-  SbList <SbVec3f> *pointsArray;
-};
+// Points added or removed after the k-d tree was built are handled
+// separately until there are this many of them, and at least 1/8 of
+// the number of points in the tree.
+#define BSPTREE_MIN_REBUILD 32
 
-coin_bspnode::coin_bspnode(SbList <SbVec3f> *ptsarray)
-  : indices(4)
-{
-  this->left = this->right = NULL;
-  this->pointsArray = ptsarray;
-  this->dimension = DIM_NONE;
-}
+// the largest number of points in a leaf of the k-d tree
+#define BSPTREE_MAX_LEAFSIZE 8
 
-coin_bspnode::~coin_bspnode()
-{
-  delete left;
-  delete right;
-}
+static int bsptree_numthreads = -1;
 
-inline int
-coin_bspnode::leftOf(const SbVec3f &pt) const
+static int
+bsptree_get_num_threads(void)
 {
-  return double(pt[this->dimension]) < this->position;
+  if (bsptree_numthreads < 0) {
+    const char * env = coin_getenv("COIN_BSPTREE_THREADS");
+    const int num = env ? atoi(env) : 1;
+    bsptree_numthreads = (num > 1) ? num : 1;
+  }
+  return bsptree_numthreads;
 }
 
-int
-coin_bspnode::addPoint(const SbVec3f &pt, const int maxpts)
-{
-  if (this->left) { // node has been split
-    if (this->leftOf(pt)) return this->left->addPoint(pt, maxpts);
-    else return this->right->addPoint(pt, maxpts);
-  }
-  else if (this->indices.getLength() >= maxpts) {
-    split();
-    return this->addPoint(pt, maxpts);
-  }
-  else {
-    int n = this->indices.getLength();
-    int i;
-    SbVec3f tmp;
-    for (i = 0; i < n; i++) {
-      tmp = (*pointsArray)[this->indices[i]];
-      if (pt == tmp) break;
-    }
-    if (i == n) {
-      int idx = this->pointsArray->getLength();
-      this->pointsArray->append(pt);
-      this->indices.append(idx);
-      return idx;
-    }
-    return this->indices[i];
+// Hash function for the point table. Equal points must give the same
+// hash value, also 0.0 and -0.0.
+static inline uint32_t
+bsptree_hash(const SbVec3f & v)
+{
+  uint32_t h = 0x9e3779b9;
+  for (int i = 0; i < 3; i++) {
+    const float f = v[i] + 0.0f; // -0.0 + 0.0 == 0.0
+    uint32_t k;
+    (void) memcpy(&k, &f, sizeof(k));
+    k *= 0xcc9e2d51;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593;
+    h ^= k;
+    h = (h << 13) | (h >> 19);
+    h = h * 5 + 0xe6546b64;
   }
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
 }
 
+class SbBSPTreeP {
+public:
+  SbBSPTreeP(void) : numbuilt(0), numdead(0) { }
+
+  int lookup(const SbVec3f * points, const SbVec3f & pt, int & pos) const;
+  void resizeTable(const SbVec3f * points, const int numpoints, const int size);
+  void removeEntry(const SbVec3f * points, int pos);
+  void updateTree(const SbVec3f * points, const int numpoints, const int leafsize);
+  void clear(void);
+
+  // open addressing hash table with the indices of all points
+  SbList <int> table;
+
+  // The k-d tree contains slot numbers instead of point indices, so
+  // that points can be removed without rebuilding the tree. slotindex
+  // maps slots to point indices (-1 for removed points), indexslot
+  // maps point indices to slots. Slots below numbuilt are in the
+  // tree, the rest are searched linearly.
+  SbKdTree kdtree;
+  SbList <int> slotindex;
+  SbList <int> indexslot;
+  int numbuilt;
+  int numdead;
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+//
+// Returns the index of the point equal to pt, and sets pos to its
+// table entry. If there is no such point, -1 is returned, and pos is
+// set to the table entry where the point should be inserted.
+//
 int
-coin_bspnode::findPoint(const SbVec3f &pt) const
+SbBSPTreeP::lookup(const SbVec3f * points, const SbVec3f & pt, int & pos) const
 {
-  if (this->left) {
-    if (this->leftOf(pt)) return this->left->findPoint(pt);
-    else return this->right->findPoint(pt);
+  const int size = this->table.getLength();
+  if (size == 0) {
+    pos = -1;
+    return -1;
   }
-  else {
-    int i, n = this->indices.getLength();
-    for (i = 0; i < n; i++) {
-      SbVec3f arrpt = (*pointsArray)[this->indices[i]];
-      if (pt == arrpt) return this->indices[i];
+  const uint32_t mask = uint32_t(size - 1);
+  const int * t = this->table.getArrayPtr();
+  uint32_t i = bsptree_hash(pt) & mask;
+  while (t[i] >= 0) {
+    if (points[t[i]] == pt) {
+      pos = int(i);
+      return t[i];
     }
+    i = (i + 1) & mask;
   }
+  pos = int(i);
   return -1;
 }
 
+//
+// Rebuilds the hash table with size entries for the first numpoints
+// points. size must be a power of two.
+//
 void
-coin_bspnode::findPoints(const SbSphere &sphere, SbList <int> &array)
-{
-  if (this->left) {
-    SbVec3f min, max;
-    min = max = sphere.getCenter();
-    min[this->dimension] -= sphere.getRadius();
-    max[this->dimension] += sphere.getRadius();
-
-    if (this->leftOf(min)) this->left->findPoints(sphere, array);
-    if (!this->leftOf(max)) this->right->findPoints(sphere, array);
-  }
-  else {
-    int i, n = this->indices.getLength();
-    for (i = 0; i < n; i++) {
-      SbVec3f pt = (*pointsArray)[this->indices[i]];
-      if (sphere.pointInside(pt)) array.append(this->indices[i]);
-    }
+SbBSPTreeP::resizeTable(const SbVec3f * points, const int numpoints, const int size)
+{
+  assert((size & (size - 1)) == 0);
+  this->table.truncate(0);
+  this->table.ensureCapacity(size);
+  int i;
+  for (i = 0; i < size; i++) this->table.append(-1);
+
+  const uint32_t mask = uint32_t(size - 1);
+  for (i = 0; i < numpoints; i++) {
+    uint32_t j = bsptree_hash(points[i]) & mask;
+    while (this->table[j] >= 0) j = (j + 1) & mask;
+    this->table[j] = i;
   }
 }
 
+//
+// Removes the hash table entry at pos, moving entries after it back
+// to keep the probe sequences unbroken.
+//
 void
-coin_bspnode::findPoints(const SbSphere &sphere, SbIntList & array)
-{
-  if (this->left) {
-    SbVec3f min, max;
-    min = max = sphere.getCenter();
-    min[this->dimension] -= sphere.getRadius();
-    max[this->dimension] += sphere.getRadius();
-
-    if (this->leftOf(min)) this->left->findPoints(sphere, array);
-    if (!this->leftOf(max)) this->right->findPoints(sphere, array);
-  }
-  else {
-    int i, n = this->indices.getLength();
-    for (i = 0; i < n; i++) {
-      SbVec3f pt = (*pointsArray)[this->indices[i]];
-      if (sphere.pointInside(pt)) array.append(this->indices[i]);
+SbBSPTreeP::removeEntry(const SbVec3f * points, int pos)
+{
+  const int mask = this->table.getLength() - 1;
+  this->table[pos] = -1;
+  int i = (pos + 1) & mask;
+  while (this->table[i] >= 0) {
+    const int home = int(bsptree_hash(points[this->table[i]]) & uint32_t(mask));
+    // move the entry if its home position is not in (pos, i]
+    const SbBool keep = (pos <= i) ?
+      (home > pos && home <= i) : (home > pos || home <= i);
+    if (!keep) {
+      this->table[pos] = this->table[i];
+      this->table[i] = -1;
+      pos = i;
     }
+    i = (i + 1) & mask;
   }
 }
 
-/*
-  Used to update index after a point is removed.
-*/
+//
+// Rebuilds the k-d tree if enough points have been added or removed
+// since the last time it was built.
+//
 void
-coin_bspnode::updateIndex(const SbVec3f & pt, int previdx, int newidx)
-{
-  if (this->left) {
-    if (this->leftOf(pt)) this->left->updateIndex(pt, previdx, newidx);
-    else this->right->updateIndex(pt, previdx, newidx);
-  }
-  else {
-    int i, n = this->indices.getLength();
-    for (i = 0; i < n; i++) {
-      if (this->indices[i] == previdx) {
-        this->indices[i] = newidx;
-        return;
-      }
-    }
+SbBSPTreeP::updateTree(const SbVec3f * points, const int numpoints, const int leafsize)
+{
+  const int numnew = this->slotindex.getLength() - this->numbuilt;
+  if ((numnew <= BSPTREE_MIN_REBUILD || numnew <= this->numbuilt / 8) &&
+      this->numdead <= this->numbuilt / 2) return;
+
+  this->slotindex.truncate(0);
+  this->indexslot.truncate(0);
+  this->slotindex.ensureCapacity(numpoints);
+  this->indexslot.ensureCapacity(numpoints);
+  for (int i = 0; i < numpoints; i++) {
+    this->slotindex.append(i);
+    this->indexslot.append(i);
   }
-}
-
-int
-coin_bspnode::removePoint(const SbVec3f &pt)
-{
-  if (this->left) {
-    if (this->leftOf(pt)) return this->left->removePoint(pt);
-    else return this->right->removePoint(pt);
-  }
-  else {
-    int i, n = this->indices.getLength();
-    for (i = 0; i < n; i++) {
-      SbVec3f arrpt = (*pointsArray)[this->indices[i]];
-      if (pt == arrpt) {
-        int idx = this->indices[i];
-        // just remove point from index array here. The invoker will
-        // remove the point from the pointsArray
-        this->indices.removeFast(i);
-        return idx;
-      }
-    }
-  }
-  return -1;
+  this->kdtree.build(points, this->slotindex.getArrayPtr(), numpoints,
+                     leafsize, bsptree_get_num_threads());
+  this->numbuilt = numpoints;
+  this->numdead = 0;
 }
 
 void
-coin_bspnode::split()
-{
-  assert(this->left == NULL && this->right == NULL);
-  this->left = new coin_bspnode(this->pointsArray);
-  this->right = new coin_bspnode(this->pointsArray);
-
-  SbBox3f box;
-  int i, n = this->indices.getLength();
-  for (i = 0; i < n; i++) {
-    box.extendBy((*pointsArray)[this->indices[i]]);
-  }
-  SbVec3f diag = box.getMax() - box.getMin();
-  int dim;
-  double pos;
-
-  if (diag[0] > diag[1]) {
-    if (diag[0] > diag[2]) dim = DIM_YZ;
-    else dim = DIM_XY;
-  }
-  else {
-    if (diag[1] > diag[2]) dim = DIM_XZ;
-    else dim = DIM_XY;
-  }
-
-  this->dimension = dim; // set the dimension
-
-  float mid = (box.getMin()[dim] + box.getMax()[dim]) / 2.0f;
-#ifdef BSP_SORTED_SPLIT
-  this->sort(); // sort vertices on ascending dimension values
-
-  int splitidx = n / 2;
-  pos = ((*pointsArray)[this->indices[splitidx-1]][dim]+
-    (*pointsArray)[this->indices[splitidx]][dim]) / 2.0f;
-
-  // got to check and adjust for special cases
-  if (pos == box.getMin()[dim] || pos == box.getMax()[dim]) {
-    pos = (pos + mid) / 2.0f;
-  }
-
-#else
-  pos = (double(box.getMin()[this->dimension])+double(box.getMax()[this->dimension])) / 2.0;
-#endif // BSP_SORTED_SPLIT
-
-  this->position = pos;
-
-  for (i = 0; i < n; i++) {
-    int idx = this->indices[i];
-    if (this->leftOf((*pointsArray)[idx]))
-      this->left->indices.append(idx);
-    else
-      this->right->indices.append(idx);
-  }
-
-//   fprintf(stderr,"bsp split: %.3f %.3f %.3f, %.3f %.3f %.3f "
-//        "==> (%d %d) %d %.3f\n",
-//        box.min[0], box.min[1], box.min[2],
-//        box.max[0], box.max[1], box.max[2],
-//        this->left->indices.getLength(), this->right->indices.getLength(),
-//        this->dimension, this->position);
-
-//   for (i = 0; i < n; i++) {
-//     SbVec3f p;
-//     this->pointsArray->getElem(this->indices[i], p);
-//     fprintf(stderr, "pt %d: %.3f %.3f %.3f\n", i, p[0], p[1], p[2]);
-//   }
-
-
-#if COIN_DEBUG
-  if (!this->left->indices.getLength() ||
-      !this->right->indices.getLength()) {
-    fprintf(stderr,"Left:\n");
-    n = this->indices.getLength();
-    const SbVec3f * pts = this->pointsArray->getArrayPtr();
-    for (i = 0; i < n; i++) {
-      SbVec3f vec = pts[this->indices[i]];
-      fprintf(stderr,"pt: %f %f %f\n",
-              vec[0], vec[1], vec[2]);
-    }
-    fprintf(stderr,"pos: %f\n",
-            pos);
-    fprintf(stderr,"mid: %f\n",
-            mid);
-    fprintf(stderr,"dim: %d\n", dim);
-    fprintf(stderr,"diag: %f %f %f\n",
-            diag[0], diag[1], diag[2]);
-
-#ifdef BSP_SORTED_SPLIT
-    fprintf(stderr,"splitidx: %d\n", splitidx);
-#endif
-  }
-
-#endif
-  assert(this->left->indices.getLength() && this->right->indices.getLength());
-
-
-  // will never be used anymore
-  this->indices.truncate(0, TRUE);
+SbBSPTreeP::clear(void)
+{
+  this->table.truncate(0, TRUE);
+  this->kdtree.clear();
+  this->slotindex.truncate(0, TRUE);
+  this->indexslot.truncate(0, TRUE);
+  this->numbuilt = 0;
+  this->numdead = 0;
 }
 
-//
-// an implementation of the shellsort algorithm
-//
-void
-coin_bspnode::sort()
-{
-  int num = this->indices.getLength();
-  int dim = this->dimension;
-  const SbVec3f * points = this->pointsArray->getArrayPtr();
-  int i, j, distance;
-  int idx;
-  for (distance = 1; distance <= num/9; distance = 3*distance + 1) ;
-  for (; distance > 0; distance /= 3) {
-    for (i = distance; i < num; i++) {
-      idx = this->indices[i];
-      j = i;
-      while (j >= distance &&
-             points[this->indices[j-distance]][dim] > points[idx][dim]) {
-        this->indices[j] = this->indices[j-distance];
-        j -= distance;
-      }
-      this->indices[j] = idx;
-    }
-  }
-}
+// *************************************************************************
 
 /*!
   Constructor with \a maxnodepts specifying the maximum number of
@@ -376,12 +262,15 @@ coin_bspnode::sort()
   points array. If you know approximately the number of points
   which will be added to the tree, it will help the performance
   if you supply this in \a initsize.
+
+  Nodes are split into nodes with at most 8 points, even if \a
+  maxnodepts is larger.
  */
 SbBSPTree::SbBSPTree(const int maxnodepts, const int initsize)
   : pointsArray(initsize),
     userdataArray(initsize)
 {
-  this->topnode = new coin_bspnode(&this->pointsArray);
+  PRIVATE(this) = new SbBSPTreeP;
   this->maxnodepoints = maxnodepts;
 }
 
@@ -390,7 +279,7 @@ SbBSPTree::SbBSPTree(const int maxnodepts, const int initsize)
 */
 SbBSPTree::~SbBSPTree()
 {
-  delete this->topnode;
+  delete PRIVATE(this);
 }
 
 /*!
@@ -461,11 +350,23 @@ int
 SbBSPTree::addPoint(const SbVec3f &pt, void * const data)
 {
   this->boundingBox.extendBy(pt);
-  int ret = this->topnode->addPoint(pt, this->maxnodepoints);
-  if (ret == this->userdataArray.getLength()) {
-    this->userdataArray.append(data);
+
+  const int n = this->pointsArray.getLength();
+  // keep the hash table at most half full
+  if (2 * (n + 1) > PRIVATE(this)->table.getLength()) {
+    PRIVATE(this)->resizeTable(this->pointsArray.getArrayPtr(), n,
+                               SbMax(PRIVATE(this)->table.getLength() * 2, 256));
   }
-  return ret;
+  int pos;
+  const int idx = PRIVATE(this)->lookup(this->pointsArray.getArrayPtr(), pt, pos);
+  if (idx >= 0) return idx;
+
+  PRIVATE(this)->table[pos] = n;
+  this->pointsArray.append(pt);
+  this->userdataArray.append(data);
+  PRIVATE(this)->indexslot.append(PRIVATE(this)->slotindex.getLength());
+  PRIVATE(this)->slotindex.append(n);
+  return n;
 }
 
 /*!
@@ -476,20 +377,35 @@ SbBSPTree::addPoint(const SbVec3f &pt, void * const data)
 int
 SbBSPTree::removePoint(const SbVec3f &pt)
 {
-  int idx = this->topnode->removePoint(pt);
-  if (idx >= 0) {
-    // SbList::removeFast() will move the last item onto the removed item
-    // to avoid copying/moving all the data. We need to notify the node that
-    // has that last point that the index has changed.
-    int lastidx = this->pointsArray.getLength() - 1;
-    if (lastidx != idx) {
-      // update index
-      this->topnode->updateIndex(this->pointsArray[lastidx], lastidx, idx);
-    }
-    // actually remove the point (copy lastidx onto idx, decrement size)
-    this->pointsArray.removeFast(idx);
-    this->userdataArray.removeFast(idx);
+  const SbVec3f * points = this->pointsArray.getArrayPtr();
+  int pos;
+  const int idx = PRIVATE(this)->lookup(points, pt, pos);
+  if (idx < 0) return -1;
+
+  PRIVATE(this)->removeEntry(points, pos);
+
+  // SbList::removeFast() will move the last item onto the removed
+  // item to avoid copying/moving all the data, so the index of the
+  // last point changes.
+  const int lastidx = this->pointsArray.getLength() - 1;
+  const int slot = PRIVATE(this)->indexslot[idx];
+  PRIVATE(this)->slotindex[slot] = -1;
+  if (slot < PRIVATE(this)->numbuilt) PRIVATE(this)->numdead++;
+  if (lastidx != idx) {
+    const uint32_t mask = uint32_t(PRIVATE(this)->table.getLength() - 1);
+    pos = int(bsptree_hash(points[lastidx]) & mask);
+    while (PRIVATE(this)->table[pos] != lastidx) pos = int((pos + 1) & mask);
+    PRIVATE(this)->table[pos] = idx;
+
+    const int lastslot = PRIVATE(this)->indexslot[lastidx];
+    PRIVATE(this)->slotindex[lastslot] = idx;
+    PRIVATE(this)->indexslot[idx] = lastslot;
   }
+  PRIVATE(this)->indexslot.truncate(lastidx);
+
+  // actually remove the point (copy lastidx onto idx, decrement size)
+  this->pointsArray.removeFast(idx);
+  this->userdataArray.removeFast(idx);
   return idx;
 }
 
@@ -512,7 +428,8 @@ SbBSPTree::removePoint(const int idx)
 int
 SbBSPTree::findPoint(const SbVec3f &pos) const
 {
-  return topnode->findPoint(pos);
+  int tablepos;
+  return PRIVATE(this)->lookup(this->pointsArray.getArrayPtr(), pos, tablepos);
 }
 
 /*!
@@ -521,11 +438,9 @@ SbBSPTree::findPoint(const SbVec3f &pos) const
 void
 SbBSPTree::clear(const int COIN_UNUSED_ARG(initsize))
 {
-  delete this->topnode;
-  this->topnode = NULL;
+  PRIVATE(this)->clear();
   this->pointsArray.truncate(0, TRUE);
   this->userdataArray.truncate(0, TRUE);
-  this->topnode = new coin_bspnode(&this->pointsArray);
   this->boundingBox.makeEmpty();
 }
 
@@ -540,49 +455,49 @@ SbBSPTree::getBBox() const
 
 /*!
   \overload
+
+  If several points are equally close to \a pos, the one with the
+  lowest index is returned. -1 is returned if the tree is empty.
 */
 int
 SbBSPTree::findClosest(const SbVec3f &pos) const
 {
-  int n = this->pointsArray.getLength();
-  if (n < 32) { // points are very scattered when few are inserted
-    SbVec3f tmp;
-    int smallidx = -1;
-    float smalldist = FLT_MAX;
-    for (int i = 0; i < n; i++) {
-      tmp = this->pointsArray[i];
-      float dist = (tmp-pos).sqrLength();
-      if (dist < smalldist) {
-        smalldist = dist;
-        smallidx = i;
+  int idx;
+  this->findClosest(&pos, 1, &idx);
+  return idx;
+}
+
+/*!
+  Finds the closest point for each of the \a num points in \a pos,
+  and stores their indices in \a indices. This is faster than calling
+  findClosest() for each point.
+
+  \since Coin 4.0
+*/
+void
+SbBSPTree::findClosest(const SbVec3f * pos, const int num, int * indices) const
+{
+  const SbVec3f * points = this->pointsArray.getArrayPtr();
+  PRIVATE(this)->updateTree(points, this->pointsArray.getLength(),
+                            SbClamp(this->maxnodepoints, 1, BSPTREE_MAX_LEAFSIZE));
+  const int * slotindex = PRIVATE(this)->slotindex.getArrayPtr();
+  const int numslots = PRIVATE(this)->slotindex.getLength();
+
+  for (int i = 0; i < num; i++) {
+    float dist = FLT_MAX;
+    int best = PRIVATE(this)->kdtree.findClosest(pos[i], dist, slotindex);
+    for (int slot = PRIVATE(this)->numbuilt; slot < numslots; slot++) {
+      const int idx = slotindex[slot];
+      if (idx < 0) continue;
+      const float tmp = (points[idx] - pos[i]).sqrLength();
+      if (!(tmp <= dist)) continue;
+      if (tmp < dist || best < 0 || idx < best) {
+        best = idx;
+        dist = tmp;
       }
     }
-    return smallidx;
-  }
-  SbVec3f center =
-    (this->boundingBox.getMin() +
-     this->boundingBox.getMax()) * 0.5f;
-  center -= pos;
-
-  float siz = center.length() * 2 +
-    (this->boundingBox.getMax()-this->boundingBox.getMin()).length();
-
-  float currsize = siz / 65536.0f;  // max 16 iterations (too much?).
-
-  SbSphere sphere(pos, currsize);
-  SbList <int> tmparray; // use only one array to avoid reallocs
-  int idx = -1;
-
-  // double size of sphere until a vertex is found
-  while (currsize < siz) {
-    sphere.setRadius(currsize);
-    tmparray.truncate(0);
-    idx = this->findClosest(sphere, tmparray);
-    if (idx >= 0) return idx;
-    currsize *= 2;
+    indices[i] = best;
   }
-  assert(0);
-  return -1; // this should not happen!
 }
 
 /*!
@@ -594,6 +509,23 @@ SbBSPTree::getPointsArrayPtr(void) const
   return this->pointsArray.getArrayPtr();
 }
 
+//
+// Appends the indices of the points inside sphere to array.
+//
+static void
+bsptree_find_points(SbBSPTreeP * pimpl, const SbVec3f * points,
+                    const SbSphere & sphere, SbList <int> & array)
+{
+  const int * slotindex = pimpl->slotindex.getArrayPtr();
+  pimpl->kdtree.findPoints(sphere.getCenter(), sphere.getRadius(),
+                           array, slotindex);
+  const int numslots = pimpl->slotindex.getLength();
+  for (int slot = pimpl->numbuilt; slot < numslots; slot++) {
+    const int idx = slotindex[slot];
+    if (idx >= 0 && sphere.pointInside(points[idx])) array.append(idx);
+  }
+}
+
 /*!
   Will return indices to all points inside \a sphere.
 
@@ -602,7 +534,13 @@ SbBSPTree::getPointsArrayPtr(void) const
 void
 SbBSPTree::findPoints(const SbSphere & sphere, SbIntList & array) const
 {
-  this->topnode->findPoints(sphere, array);
+  PRIVATE(this)->updateTree(this->pointsArray.getArrayPtr(), this->pointsArray.getLength(),
+                            SbClamp(this->maxnodepoints, 1, BSPTREE_MAX_LEAFSIZE));
+  SbList <int> tmparray;
+  bsptree_find_points(PRIVATE(this), this->pointsArray.getArrayPtr(),
+                      sphere, tmparray);
+  const int n = tmparray.getLength();
+  for (int i = 0; i < n; i++) array.append(tmparray[i]);
 }
 
 /*!
@@ -673,11 +611,19 @@ void
 SbBSPTree::findPoints(const SbSphere &sphere,
                       SbList <int> &array) const
 {
-  this->topnode->findPoints(sphere, array);
+  PRIVATE(this)->updateTree(this->pointsArray.getArrayPtr(), this->pointsArray.getLength(),
+                            SbClamp(this->maxnodepoints, 1, BSPTREE_MAX_LEAFSIZE));
+  bsptree_find_points(PRIVATE(this), this->pointsArray.getArrayPtr(),
+                      sphere, array);
 }
 
+#undef PRIVATE
+
 #ifdef COIN_TEST_SUITE
 
+#include <Inventor/SbSphere.h>
+#include <cfloat>
+
 BOOST_AUTO_TEST_CASE(initialized)
 {
   SbBSPTree bsp;
@@ -719,4 +665,52 @@ BOOST_AUTO_TEST_CASE(initialized)
 
 }
 
+BOOST_AUTO_TEST_CASE(queries)
+{
+  // compare the range and closest point queries against a linear
+  // search, with points added and removed between the queries, and
+  // enough points for the k-d tree to be used
+  SbBSPTree bsp;
+  SbList <SbVec3f> points;
+  int i, j;
+  for (i = 0; i < 2000; i++) {
+    const SbVec3f p(float(i % 17), float((i * 7) % 23), float((i * 13) % 5));
+    if (bsp.addPoint(p) == points.getLength()) points.append(p);
+  }
+  BOOST_CHECK_MESSAGE(bsp.numPoints() == points.getLength(), "wrong number of points in the tree");
+
+  for (i = 0; i < 200; i++) {
+    if (i % 3 == 0) {
+      const int idx = (i * 31) % points.getLength();
+      BOOST_CHECK_MESSAGE(bsp.removePoint(points[idx]) == idx, "unable to remove point");
+      points.removeFast(idx);
+    }
+    const SbVec3f pos(float(i % 19) - 1.0f, float(i % 7) * 3.5f, float(i % 4) + 0.25f);
+
+    const int closest = bsp.findClosest(pos);
+    int expected = -1;
+    float mindist = FLT_MAX;
+    for (j = 0; j < points.getLength(); j++) {
+      const float dist = (points[j] - pos).sqrLength();
+      if (dist < mindist) {
+        mindist = dist;
+        expected = j;
+      }
+    }
+    BOOST_CHECK_MESSAGE(closest == expected, "wrong closest point");
+
+    const SbSphere sphere(pos, 2.5f);
+    SbList <int> found;
+    bsp.findPoints(sphere, found);
+    int numinside = 0;
+    for (j = 0; j < points.getLength(); j++) {
+      if (sphere.pointInside(points[j])) {
+        numinside++;
+        BOOST_CHECK_MESSAGE(found.find(j) >= 0, "point inside sphere not found");
+      }
+    }
+    BOOST_CHECK_MESSAGE(found.getLength() == numinside, "wrong number of points inside sphere");
+  }
+}
+
 #endif // COIN_TEST_SUITE
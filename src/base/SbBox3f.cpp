@@ -250,6 +250,42 @@ SbBox3f::extendBy(const SbVec3f & point)
   }
 }
 
+/*!
+  \overload
+
+  Extend the boundaries of the box so all \a num points in the \a
+  points array are included. This is faster than calling
+  extendBy() once for each point.
+
+  \since Coin 4.0
+*/
+void
+SbBox3f::extendBy(const SbVec3f * points, const int num)
+{
+  if (num <= 0) return;
+
+  float xmin, ymin, zmin, xmax, ymax, zmax;
+  if (this->isEmpty()) {
+    points[0].getValue(xmin, ymin, zmin);
+    points[0].getValue(xmax, ymax, zmax);
+  }
+  else {
+    this->getBounds(xmin, ymin, zmin, xmax, ymax, zmax);
+  }
+
+  for (int i = 0; i < num; i++) {
+    const float * p = points[i].getValue();
+    if (p[0] < xmin) xmin = p[0];
+    if (p[0] > xmax) xmax = p[0];
+    if (p[1] < ymin) ymin = p[1];
+    if (p[1] > ymax) ymax = p[1];
+    if (p[2] < zmin) zmin = p[2];
+    if (p[2] > zmax) zmax = p[2];
+  }
+  this->minpt.setValue(xmin, ymin, zmin);
+  this->maxpt.setValue(xmax, ymax, zmax);
+}
+
 /*!
   Extend the boundaries of the box by the given \a box parameter. This
   is equal to calling extendBy() twice with the corner points.
@@ -437,18 +473,17 @@ SbBox3f::transform(const SbMatrix & matrix)
   }
 #endif // COIN_DEBUG
 
-  SbVec3f dst;
   SbVec3f points[2] = {this->minpt, this->maxpt};
-  SbVec3f corner;
-  SbBox3f newbox;
+  SbVec3f corners[8];
 
-  //transform all the corners and include them into the new box.
+  //Find all corners the "binary" way :-)
   for (int i=0;i<8;i++) {
-    //Find all corners the "binary" way :-)
-    corner.setValue(points[(i&4)>>2][0], points[(i&2)>>1][1], points[i&1][2]);
-    matrix.multVecMatrix(corner, dst);
-    newbox.extendBy(dst);
+    corners[i].setValue(points[(i&4)>>2][0], points[(i&2)>>1][1], points[i&1][2]);
   }
+  //transform all the corners and include them into the new box.
+  matrix.multVecMatrix(corners, corners, 8);
+  SbBox3f newbox;
+  newbox.extendBy(corners, 8);
   this->setBounds(newbox.minpt, newbox.maxpt);
 }
 
@@ -608,4 +643,25 @@ BOOST_AUTO_TEST_CASE(checkGetClosestPoint) {
   BOOST_CHECK_MESSAGE(box.getClosestPoint(box.getCenter()) == expectedCenterQuery,
                       "Closest point for center query does not fit");
 }
+
+BOOST_AUTO_TEST_CASE(extendByArray) {
+  SbVec3f points[4] = {
+    SbVec3f(1.0f, 2.0f, 3.0f), SbVec3f(-1.0f, 5.0f, 0.0f),
+    SbVec3f(4.0f, -2.0f, 1.0f), SbVec3f(0.0f, 0.0f, 9.0f)
+  };
+  SbBox3f single, array;
+  for (int i = 0; i < 4; i++) single.extendBy(points[i]);
+  array.extendBy(points, 4);
+  BOOST_CHECK_MESSAGE(single == array,
+                      "Array extendBy() differs from single point extendBy()");
+
+  SbBox3f box(SbVec3f(-10.0f, 0.0f, 0.0f), SbVec3f(-9.0f, 1.0f, 1.0f));
+  box.extendBy(points, 4);
+  BOOST_CHECK_MESSAGE(box == SbBox3f(SbVec3f(-10.0f, -2.0f, 0.0f), SbVec3f(4.0f, 5.0f, 9.0f)),
+                      "Array extendBy() of non-empty box failed");
+
+  SbBox3f empty;
+  empty.extendBy(points, 0);
+  BOOST_CHECK_MESSAGE(empty.isEmpty(), "extendBy() with no points should keep box empty");
+}
 #endif //COIN_TEST_SUITE
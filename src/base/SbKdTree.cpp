@@ -0,0 +1,379 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// SbKdTree is a k-d tree for 3D points, built in one go from an
+// array of points. It is used by SbBSPTree for its range and
+// closest point queries.
+//
+// The nodes are kept in one array in depth first order, with the
+// left child of a node right after the node itself, and the points
+// are copied into a second array in leaf order, so a query only
+// walks through two contiguous blocks of memory. Each node splits its
+// points in two equally sized halves along the longest axis of their
+// bounding box, which gives a balanced tree and O(n log n)
+// construction. The two halves can be built by separate threads.
+//
+// Each point has an integer id, which is what the queries return.
+// Queries can translate the ids through a remap array. Points with a
+// negative remapped id are ignored, so points can be renumbered or
+// removed without rebuilding the tree.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "SbKdTree.h"
+
+#include <cassert>
+#include <cstddef>
+
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/thread.h>
+#endif // HAVE_THREADS
+
+// *************************************************************************
+
+// a subtree needs at least this many points to be built by a
+// separate thread
+#define KDTREE_MIN_PARALLEL 32768
+
+// deep enough for any tree with less than 2^31 points
+#define KDTREE_STACK_SIZE 64
+
+typedef struct {
+  SbKdTree::Node * nodes;
+  SbKdTree::Point * points;
+  int leafsize;
+} kdtree_build_data;
+
+typedef struct {
+  const kdtree_build_data * data;
+  int nodeidx;
+  int start;
+  int num;
+  int numthreads;
+} kdtree_build_job;
+
+//
+// Stores the number of nodes in a tree with n points in count[0], and
+// the number of nodes in a tree with n+1 points in count[1].
+//
+static void
+kdtree_count_nodes(const int n, const int leafsize, int count[2])
+{
+  if (n <= leafsize) {
+    count[0] = 1;
+    count[1] = (n + 1 <= leafsize) ? 1 : 3;
+    return;
+  }
+  int half[2];
+  kdtree_count_nodes(n / 2, leafsize, half);
+  if (n % 2 == 0) {
+    count[0] = 1 + 2 * half[0];
+    count[1] = 1 + half[0] + half[1];
+  }
+  else {
+    count[0] = 1 + half[0] + half[1];
+    count[1] = 1 + 2 * half[1];
+  }
+}
+
+static inline void
+kdtree_swap(SbKdTree::Point & p0, SbKdTree::Point & p1)
+{
+  SbKdTree::Point tmp = p0;
+  p0 = p1;
+  p1 = tmp;
+}
+
+//
+// Reorders pts so that pts[k] has the value it would have if pts was
+// sorted on dimension dim, all points before it have smaller or equal
+// values, and all points after it have larger or equal values.
+//
+static void
+kdtree_select(SbKdTree::Point * pts, const int num, const int k, const int dim)
+{
+  int lo = 0;
+  int hi = num - 1;
+  while (hi > lo) {
+    // median of three, which also gives sentinels for the loops below
+    const int mid = lo + (hi - lo) / 2;
+    if (pts[mid].pt[dim] < pts[lo].pt[dim]) kdtree_swap(pts[mid], pts[lo]);
+    if (pts[hi].pt[dim] < pts[lo].pt[dim]) kdtree_swap(pts[hi], pts[lo]);
+    if (pts[hi].pt[dim] < pts[mid].pt[dim]) kdtree_swap(pts[hi], pts[mid]);
+    const float pivot = pts[mid].pt[dim];
+
+    int i = lo;
+    int j = hi;
+    while (i <= j) {
+      while (pts[i].pt[dim] < pivot) i++;
+      while (pts[j].pt[dim] > pivot) j--;
+      if (i <= j) {
+        kdtree_swap(pts[i], pts[j]);
+        i++;
+        j--;
+      }
+    }
+    if (k <= j) hi = j;
+    else if (k >= i) lo = i;
+    else break;
+  }
+}
+
+static void kdtree_build_node(const kdtree_build_data * data, const int nodeidx,
+                              const int start, const int num, const int numthreads);
+
+#ifdef HAVE_THREADS
+static void *
+kdtree_build_thread(void * closure)
+{
+  const kdtree_build_job * job = (const kdtree_build_job *) closure;
+  kdtree_build_node(job->data, job->nodeidx, job->start, job->num, job->numthreads);
+  return NULL;
+}
+#endif // HAVE_THREADS
+
+static void
+kdtree_build_node(const kdtree_build_data * data, const int nodeidx,
+                  const int start, const int num, const int numthreads)
+{
+  SbKdTree::Node & node = data->nodes[nodeidx];
+  if (num <= data->leafsize) {
+    node.split = 0.0f;
+    node.dim = 0;
+    node.child = start;
+    node.num = num;
+    return;
+  }
+
+  SbKdTree::Point * pts = data->points + start;
+  SbVec3f min = pts[0].pt;
+  SbVec3f max = pts[0].pt;
+  int i, dim;
+  for (i = 1; i < num; i++) {
+    const SbVec3f & p = pts[i].pt;
+    for (dim = 0; dim < 3; dim++) {
+      if (p[dim] < min[dim]) min[dim] = p[dim];
+      if (p[dim] > max[dim]) max[dim] = p[dim];
+    }
+  }
+  const SbVec3f diag = max - min;
+  dim = (diag[0] > diag[1]) ? (diag[0] > diag[2] ? 0 : 2) : (diag[1] > diag[2] ? 1 : 2);
+
+  const int half = num / 2;
+  kdtree_select(pts, num, half, dim);
+
+  int count[2];
+  kdtree_count_nodes(half, data->leafsize, count);
+  node.split = pts[half].pt[dim];
+  node.dim = dim;
+  node.child = nodeidx + 1 + count[0];
+  node.num = 0;
+
+#ifdef HAVE_THREADS
+  if (numthreads > 1 && num >= KDTREE_MIN_PARALLEL) {
+    kdtree_build_job job;
+    job.data = data;
+    job.nodeidx = nodeidx + 1;
+    job.start = start;
+    job.num = half;
+    job.numthreads = numthreads / 2;
+    cc_thread * thread = cc_thread_construct(kdtree_build_thread, &job);
+    if (thread) {
+      kdtree_build_node(data, node.child, start + half, num - half,
+                        numthreads - numthreads / 2);
+      (void) cc_thread_join(thread, NULL);
+      cc_thread_destruct(thread);
+      return;
+    }
+  }
+#endif // HAVE_THREADS
+
+  kdtree_build_node(data, nodeidx + 1, start, half, 1);
+  kdtree_build_node(data, node.child, start + half, num - half, 1);
+}
+
+// *************************************************************************
+
+SbKdTree::SbKdTree(void)
+  : nodes(NULL),
+    points(NULL),
+    numpoints(0)
+{
+}
+
+SbKdTree::~SbKdTree()
+{
+  this->clear();
+}
+
+//
+// Builds the tree from numpoints points, with ids[i] being the id of
+// points[i]. Leaves have at most leafsize points. If numthreads is
+// larger than one, subtrees are built by up to numthreads threads.
+//
+void
+SbKdTree::build(const SbVec3f * pts, const int * ids, const int num,
+                const int leafsize, const int numthreads)
+{
+  assert(leafsize > 0);
+  this->clear();
+  if (num == 0) return;
+
+  int count[2];
+  kdtree_count_nodes(num, leafsize, count);
+  this->nodes = new Node[count[0]];
+  this->points = new Point[num];
+  this->numpoints = num;
+  for (int i = 0; i < num; i++) {
+    this->points[i].pt = pts[i];
+    this->points[i].id = ids[i];
+  }
+
+  kdtree_build_data data;
+  data.nodes = this->nodes;
+  data.points = this->points;
+  data.leafsize = leafsize;
+  kdtree_build_node(&data, 0, 0, num, numthreads);
+}
+
+//
+// Frees all memory used by the tree.
+//
+void
+SbKdTree::clear(void)
+{
+  delete[] this->nodes;
+  delete[] this->points;
+  this->nodes = NULL;
+  this->points = NULL;
+  this->numpoints = 0;
+}
+
+int
+SbKdTree::getNumPoints(void) const
+{
+  return this->numpoints;
+}
+
+//
+// Appends the ids of all points inside the sphere to ids. A point
+// is inside if SbSphere::pointInside() would return TRUE for it.
+//
+void
+SbKdTree::findPoints(const SbVec3f & center, const float radius,
+                     SbList <int> & ids, const int * remap) const
+{
+  if (this->numpoints == 0) return;
+
+  int stack[KDTREE_STACK_SIZE];
+  int sp = 0;
+  stack[sp++] = 0;
+  while (sp > 0) {
+    const int nodeidx = stack[--sp];
+    const Node & node = this->nodes[nodeidx];
+    if (node.num > 0) {
+      const Point * pts = this->points + node.child;
+      for (int i = 0; i < node.num; i++) {
+        if ((pts[i].pt - center).length() < radius) {
+          int id = pts[i].id;
+          if (remap && (id = remap[id]) < 0) continue;
+          ids.append(id);
+        }
+      }
+      continue;
+    }
+    // compare in double precision, so that no point which could be
+    // inside the sphere is skipped because of rounding
+    const double c = double(center[node.dim]);
+    if (c + double(radius) >= double(node.split)) stack[sp++] = node.child;
+    if (c - double(radius) <= double(node.split)) stack[sp++] = nodeidx + 1;
+    assert(sp < KDTREE_STACK_SIZE);
+  }
+}
+
+//
+// Returns the id of the point closest to pos, or -1 if no point is
+// closer than sqrt(sqrdist). sqrdist is updated to the squared
+// distance to the point found. If several points are at the same
+// distance, the one with the lowest id is returned.
+//
+int
+SbKdTree::findClosest(const SbVec3f & pos, float & sqrdist,
+                      const int * remap) const
+{
+  if (this->numpoints == 0) return -1;
+
+  struct { int node; float dist; } stack[KDTREE_STACK_SIZE];
+  int sp = 0;
+  stack[sp].node = 0;
+  stack[sp].dist = 0.0f;
+  sp++;
+
+  int best = -1;
+  float bestdist = sqrdist;
+  while (sp > 0) {
+    sp--;
+    if (stack[sp].dist > bestdist) continue;
+    const int nodeidx = stack[sp].node;
+    const Node & node = this->nodes[nodeidx];
+    if (node.num > 0) {
+      const Point * pts = this->points + node.child;
+      for (int i = 0; i < node.num; i++) {
+        const float dist = (pts[i].pt - pos).sqrLength();
+        if (!(dist <= bestdist)) continue; // also skips NaN points
+        int id = pts[i].id;
+        if (remap && (id = remap[id]) < 0) continue;
+        if (dist < bestdist || best < 0 || id < best) {
+          best = id;
+          bestdist = dist;
+        }
+      }
+      continue;
+    }
+    // visit the side pos is on first, and the other side only if
+    // it can contain points closer than the best one found so far
+    const float diff = pos[node.dim] - node.split;
+    const int nearchild = (diff < 0.0f) ? nodeidx + 1 : node.child;
+    const int farchild = (diff < 0.0f) ? node.child : nodeidx + 1;
+    stack[sp].node = farchild;
+    stack[sp].dist = diff * diff;
+    sp++;
+    stack[sp].node = nearchild;
+    stack[sp].dist = 0.0f;
+    sp++;
+    assert(sp < KDTREE_STACK_SIZE);
+  }
+  sqrdist = bestdist;
+  return best;
+}
@@ -1474,6 +1474,57 @@ SbMatrix::multVecMatrix(const SbVec3f & src, SbVec3f & dst) const
   dst[2] = (s[0]*t0[2] + s[1]*t1[2] + s[2]*t2[2] + t3[2])/W;
 }
 
+/*!
+  \overload
+
+  Multiply the \a num vectors in the \a src array with this matrix,
+  and store the results in the \a dst array. This gives the same
+  result as calling multVecMatrix() for each vector, but is faster
+  when transforming many points, since the matrix is only inspected
+  once and the perspective divide is skipped for affine matrices.
+
+  It is safe to let \a src and \a dst be the same array.
+
+  \since Coin 4.0
+*/
+void
+SbMatrix::multVecMatrix(const SbVec3f * src, SbVec3f * dst, const int num) const
+{
+  if (SbMatrixP::isIdentity(this->matrix)) {
+    if (src != dst) {
+      for (int i = 0; i < num; i++) { dst[i] = src[i]; }
+    }
+    return;
+  }
+
+  const float * t0 = this->matrix[0];
+  const float * t1 = this->matrix[1];
+  const float * t2 = this->matrix[2];
+  const float * t3 = this->matrix[3];
+
+  if (t0[3] == 0.0f && t1[3] == 0.0f && t2[3] == 0.0f && t3[3] == 1.0f) {
+    for (int i = 0; i < num; i++) {
+      const float x = src[i][0];
+      const float y = src[i][1];
+      const float z = src[i][2];
+      dst[i][0] = x*t0[0] + y*t1[0] + z*t2[0] + t3[0];
+      dst[i][1] = x*t0[1] + y*t1[1] + z*t2[1] + t3[1];
+      dst[i][2] = x*t0[2] + y*t1[2] + z*t2[2] + t3[2];
+    }
+  }
+  else {
+    for (int i = 0; i < num; i++) {
+      const float x = src[i][0];
+      const float y = src[i][1];
+      const float z = src[i][2];
+      const float W = x*t0[3] + y*t1[3] + z*t2[3] + t3[3];
+      dst[i][0] = (x*t0[0] + y*t1[0] + z*t2[0] + t3[0])/W;
+      dst[i][1] = (x*t0[1] + y*t1[1] + z*t2[1] + t3[1])/W;
+      dst[i][2] = (x*t0[2] + y*t1[2] + z*t2[2] + t3[2])/W;
+    }
+  }
+}
+
 /*!
   \overload
 */
@@ -2053,6 +2104,8 @@ SbMatrixP::decomp_affine(SbMatrixP::HMatrix A, SbMatrixP::AffineParts * parts)
 
 #ifdef COIN_TEST_SUITE
 #include <Inventor/SbDPMatrix.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/SbVec3f.h>
 
 BOOST_AUTO_TEST_CASE(constructFromSbDPMatrix) {
   SbMatrixd a(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
@@ -2063,4 +2116,31 @@ BOOST_AUTO_TEST_CASE(constructFromSbDPMatrix) {
   BOOST_CHECK_MESSAGE(b == d,
                       "Equality comparrison failed!");
 }
+
+BOOST_AUTO_TEST_CASE(multVecMatrixArray) {
+  SbMatrix affine;
+  affine.setTransform(SbVec3f(1.0f, -2.0f, 3.0f),
+                      SbRotation(SbVec3f(0.0f, 1.0f, 1.0f), 0.7f),
+                      SbVec3f(2.0f, 0.5f, 1.5f));
+  SbMatrix projective = affine;
+  projective[0][3] = 0.1f;
+  projective[3][3] = 2.0f;
+
+  SbVec3f src[4] = {
+    SbVec3f(0.0f, 0.0f, 0.0f), SbVec3f(1.0f, 2.0f, 3.0f),
+    SbVec3f(-4.0f, 5.0f, -6.0f), SbVec3f(0.5f, -0.25f, 8.0f)
+  };
+  SbMatrix identity = SbMatrix::identity();
+  const SbMatrix * matrices[3] = { &affine, &projective, &identity };
+  for (int m = 0; m < 3; m++) {
+    SbVec3f dst[4];
+    matrices[m]->multVecMatrix(src, dst, 4);
+    for (int i = 0; i < 4; i++) {
+      SbVec3f expected;
+      matrices[m]->multVecMatrix(src[i], expected);
+      BOOST_CHECK_MESSAGE(dst[i].equals(expected, 1e-5f),
+                          "Array transform differs from single vector transform");
+    }
+  }
+}
 #endif //COIN_TEST_SUITE
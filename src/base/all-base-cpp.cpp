@@ -49,6 +49,7 @@
 #include "SbDict.cpp"
 #include "SbHeap.cpp"
 #include "SbImage.cpp"
+#include "SbKdTree.cpp"
 #include "SbLine.cpp"
 #include "SbDPLine.cpp"
 #include "SbMatrix.cpp"
@@ -33,9 +33,12 @@
 #include "base/namemap.h"
 
 #include <cstdlib>
+#include <cstdio>
 #include <cassert>
 #include <cstring>
 
+#include <Inventor/C/tidbits.h>
+
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
 #include "coindefs.h"
@@ -43,8 +46,7 @@
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
 using std::malloc;
 using std::free;
-using std::strcpy;
-using std::strlen;
+using std::memcpy;
 using std::strcmp;
 #endif // !COIN_WORKAROUND_NO_USING_STD_FUNCS
 
@@ -63,16 +65,28 @@ using std::strcmp;
   mortene.
 */
 
+/*
+  The table is split into a fixed number of shards, selected from the
+  low bits of the string hash. Each shard has its own mutex, string
+  memory chunks and bucket array, so threads interning different
+  names (typically while parsing several files in parallel) rarely
+  contend for the same lock. The bucket array of a shard is doubled
+  whenever the number of entries exceeds the number of buckets, to
+  keep the chains short also after millions of names have been added.
+*/
+
 /* ************************************************************************* */
 
 #define CHUNK_SIZE (65536-32)
-static const unsigned int NAME_TABLE_SIZE = 1999;
+#define NAMEMAP_NUM_SHARDS 16 /* must be a power of two */
+#define NAMEMAP_SHARD_BITS 4
+#define NAMEMAP_INITIAL_BUCKETS 128 /* must be a power of two */
 
 struct NamemapMemChunk {
-  char mem[CHUNK_SIZE];
   char * curbyte;
   size_t bytesleft;
   struct NamemapMemChunk * next;
+  /* string memory follows the struct */
 };
 
 struct NamemapBucketEntry {
@@ -81,9 +95,15 @@ struct NamemapBucketEntry {
   struct NamemapBucketEntry * next;
 };
 
-static void * access_mutex = NULL;
-static struct NamemapBucketEntry ** nametable = NULL;
-static struct NamemapMemChunk * headchunk = NULL;
+struct NamemapShard {
+  void * mutex;
+  struct NamemapBucketEntry ** buckets;
+  unsigned int numbuckets;
+  unsigned int numentries;
+  struct NamemapMemChunk * headchunk;
+};
+
+static struct NamemapShard * shards = NULL;
 
 /* ************************************************************************* */
 
@@ -93,90 +113,170 @@ extern "C" {
 static void
 namemap_cleanup(void)
 {
-  unsigned int i;
-
-  struct NamemapMemChunk * chunkptr = headchunk;
-  while (chunkptr) {
-    struct NamemapMemChunk * next = chunkptr->next;
-    free(chunkptr);
-    chunkptr = next;
-  }
-  
-  for (i = 0; i < NAME_TABLE_SIZE; i++) {
-    struct NamemapBucketEntry * entry = nametable[i];
-    while (entry) {
-      struct NamemapBucketEntry * next = entry->next;
-      free(entry);
-      entry = next;
+  unsigned int i, j;
+
+  { /* debugging */
+    const char * env = coin_getenv("COIN_DEBUG_NAMEMAP");
+    if (env && (atoi(env) > 0)) {
+      unsigned int numstrings, numbuckets, numcollisions, maxchain;
+      cc_namemap_get_statistics(&numstrings, &numbuckets, &numcollisions, &maxchain);
+      (void)fprintf(stderr, "DEBUG: namemap: %u strings in %u buckets, "
+                    "%u collisions, longest chain %u\n",
+                    numstrings, numbuckets, numcollisions, maxchain);
     }
   }
-  free(nametable);
-  nametable = static_cast<struct NamemapBucketEntry **>(NULL);
 
-  CC_MUTEX_DESTRUCT(access_mutex);
+  for (i = 0; i < NAMEMAP_NUM_SHARDS; i++) {
+    struct NamemapShard * shard = &shards[i];
+    struct NamemapMemChunk * chunkptr = shard->headchunk;
+    while (chunkptr) {
+      struct NamemapMemChunk * next = chunkptr->next;
+      free(chunkptr);
+      chunkptr = next;
+    }
+
+    for (j = 0; j < shard->numbuckets; j++) {
+      struct NamemapBucketEntry * entry = shard->buckets[j];
+      while (entry) {
+        struct NamemapBucketEntry * next = entry->next;
+        free(entry);
+        entry = next;
+      }
+    }
+    free(shard->buckets);
+    CC_MUTEX_DESTRUCT(shard->mutex);
+  }
+  free(shards);
+  shards = static_cast<struct NamemapShard *>(NULL);
 }
 
 } // extern "C"
 
-/* Initializes static data. */
+/* Initializes static data. Assumes the global lock is held. */
 static void
 namemap_init(void)
 {
-  unsigned int i;
-
-  nametable = static_cast<struct NamemapBucketEntry **>(
-    malloc(sizeof(struct NamemapBucketEntry *) * NAME_TABLE_SIZE));
-  for (i = 0; i < NAME_TABLE_SIZE; i++) { nametable[i] = NULL; }
-
-  headchunk = NULL;
+  unsigned int i, j;
+
+  struct NamemapShard * newshards = static_cast<struct NamemapShard *>(
+    malloc(sizeof(struct NamemapShard) * NAMEMAP_NUM_SHARDS));
+  for (i = 0; i < NAMEMAP_NUM_SHARDS; i++) {
+    struct NamemapShard * shard = &newshards[i];
+    shard->mutex = NULL;
+#ifdef HAVE_THREADS
+    shard->mutex = static_cast<void *>(cc_mutex_construct());
+#endif /* HAVE_THREADS */
+    shard->numbuckets = NAMEMAP_INITIAL_BUCKETS;
+    shard->numentries = 0;
+    shard->buckets = static_cast<struct NamemapBucketEntry **>(
+      malloc(sizeof(struct NamemapBucketEntry *) * shard->numbuckets));
+    for (j = 0; j < shard->numbuckets; j++) { shard->buckets[j] = NULL; }
+    shard->headchunk = NULL;
+  }
+  shards = newshards;
 
   coin_atexit(static_cast<coin_atexit_f *>(namemap_cleanup), CC_ATEXIT_SBNAME);
 }
 
-static const char *
-find_string_address(const char * s)
+/* FNV-1a, which spreads the low bits well enough to select both the
+   shard and the bucket from the same hash value. Also returns the
+   string length, to avoid another strlen() when the string is
+   added. */
+static unsigned long
+namemap_hash(const char * str, size_t * len)
 {
-  size_t len = strlen(s) + 1;
-
-  /* FIXME: this is an unacceptable limitation. 20030608 mortene. */
-  assert(len < CHUNK_SIZE);
+  const unsigned char * s = reinterpret_cast<const unsigned char *>(str);
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h ^= *s++;
+    h *= 16777619u;
+  }
+  *len = static_cast<size_t>(reinterpret_cast<const char *>(s) - str);
+  return static_cast<unsigned long>(h);
+}
 
-  if (headchunk == NULL || headchunk->bytesleft < len) {
-    struct NamemapMemChunk * newchunk = static_cast<struct NamemapMemChunk *>(
-      malloc(sizeof(struct NamemapMemChunk))
+static const char *
+find_string_address(struct NamemapShard * shard, const char * s, size_t len)
+{
+  len += 1; /* terminating zero */
+
+  struct NamemapMemChunk * chunk = shard->headchunk;
+  if (chunk == NULL || chunk->bytesleft < len) {
+    /* very long strings get a chunk of their own */
+    const size_t size = (len > CHUNK_SIZE) ? len : CHUNK_SIZE;
+    chunk = static_cast<struct NamemapMemChunk *>(
+      malloc(sizeof(struct NamemapMemChunk) + size)
       );
 
-    newchunk->curbyte = newchunk->mem;
-    newchunk->bytesleft = CHUNK_SIZE;
-    newchunk->next = headchunk;
-
-    headchunk = newchunk;
+    chunk->curbyte = reinterpret_cast<char *>(chunk + 1);
+    chunk->bytesleft = size;
+    if (shard->headchunk && (size > CHUNK_SIZE)) {
+      /* keep filling the current chunk with regular strings */
+      chunk->next = shard->headchunk->next;
+      shard->headchunk->next = chunk;
+    }
+    else {
+      chunk->next = shard->headchunk;
+      shard->headchunk = chunk;
+    }
   }
 
-  (void)strcpy(headchunk->curbyte, s);
-  s = headchunk->curbyte;
+  (void)memcpy(chunk->curbyte, s, len);
+  s = chunk->curbyte;
 
-  headchunk->curbyte += len;
-  headchunk->bytesleft -= len;
+  chunk->curbyte += len;
+  chunk->bytesleft -= len;
 
   return s;
 }
 
+/* Doubles the number of buckets in a shard. Assumes the shard is locked. */
+static void
+namemap_grow_shard(struct NamemapShard * shard)
+{
+  unsigned int i;
+  const unsigned int newsize = shard->numbuckets * 2;
+  struct NamemapBucketEntry ** newbuckets = static_cast<struct NamemapBucketEntry **>(
+    malloc(sizeof(struct NamemapBucketEntry *) * newsize));
+  for (i = 0; i < newsize; i++) { newbuckets[i] = NULL; }
+
+  for (i = 0; i < shard->numbuckets; i++) {
+    struct NamemapBucketEntry * entry = shard->buckets[i];
+    while (entry) {
+      struct NamemapBucketEntry * next = entry->next;
+      const unsigned long idx = (entry->hashvalue >> NAMEMAP_SHARD_BITS) & (newsize - 1);
+      entry->next = newbuckets[idx];
+      newbuckets[idx] = entry;
+      entry = next;
+    }
+  }
+  free(shard->buckets);
+  shard->buckets = newbuckets;
+  shard->numbuckets = newsize;
+}
+
 static const char *
 namemap_find_or_add_string(const char * str, SbBool addifnotfound)
 {
   unsigned long h, i;
+  size_t len;
   struct NamemapBucketEntry * entry;
+  struct NamemapShard * shard;
+
+  if (shards == NULL) {
+    CC_GLOBAL_LOCK;
+    if (shards == NULL) { namemap_init(); }
+    CC_GLOBAL_UNLOCK;
+  }
+  assert(shards != static_cast<struct NamemapShard *>(NULL) && "name hash dead");
 
-  if (access_mutex == NULL) { CC_MUTEX_CONSTRUCT(access_mutex); }
-  CC_MUTEX_LOCK(access_mutex);
+  h = namemap_hash(str, &len);
+  shard = &shards[h & (NAMEMAP_NUM_SHARDS - 1)];
 
-  if (nametable == NULL) { namemap_init(); }
-  assert(nametable != static_cast<struct NamemapBucketEntry **>(NULL) && "name hash dead");
+  CC_MUTEX_LOCK(shard->mutex);
 
-  h = cc_string_hash_text(str);
-  i = h % NAME_TABLE_SIZE;
-  entry = nametable[i];
+  i = (h >> NAMEMAP_SHARD_BITS) & (shard->numbuckets - 1);
+  entry = shard->buckets[i];
 
   while (entry != NULL) {
     if (entry->hashvalue == h && strcmp(entry->str, str) == 0) { break; }
@@ -185,14 +285,17 @@ namemap_find_or_add_string(const char * str, SbBool addifnotfound)
 
   if ((entry == NULL) && addifnotfound) {
     entry = static_cast<struct NamemapBucketEntry *>(malloc(sizeof(struct NamemapBucketEntry)));
-    entry->str = find_string_address(str);
+    entry->str = find_string_address(shard, str, len);
     entry->hashvalue = h;
-    entry->next = nametable[i];
+    entry->next = shard->buckets[i];
 
-    nametable[i] = entry;
+    shard->buckets[i] = entry;
+    if (++shard->numentries > shard->numbuckets) {
+      namemap_grow_shard(shard);
+    }
   }
 
-  CC_MUTEX_UNLOCK(access_mutex);
+  CC_MUTEX_UNLOCK(shard->mutex);
   return entry ? entry->str : NULL;
 }
 
@@ -221,4 +324,38 @@ cc_namemap_peek_string(const char * str)
   return namemap_find_or_add_string(str, FALSE);
 }
 
+/*!
+  Collects statistics about the name hash: the total number of
+  strings stored, the total number of buckets, the number of strings
+  which share a bucket with another string, and the length of the
+  longest bucket chain. Used for tuning and debugging.
+*/
+void
+cc_namemap_get_statistics(unsigned int * numstrings, unsigned int * numbuckets,
+                          unsigned int * numcollisions, unsigned int * maxchain)
+{
+  unsigned int i, j;
+
+  *numstrings = *numbuckets = *numcollisions = *maxchain = 0;
+  if (shards == NULL) return;
+
+  for (i = 0; i < NAMEMAP_NUM_SHARDS; i++) {
+    struct NamemapShard * shard = &shards[i];
+    CC_MUTEX_LOCK(shard->mutex);
+    *numstrings += shard->numentries;
+    *numbuckets += shard->numbuckets;
+    for (j = 0; j < shard->numbuckets; j++) {
+      unsigned int chain = 0;
+      const struct NamemapBucketEntry * entry = shard->buckets[j];
+      while (entry) { chain++; entry = entry->next; }
+      if (chain > 1) *numcollisions += chain - 1;
+      if (chain > *maxchain) *maxchain = chain;
+    }
+    CC_MUTEX_UNLOCK(shard->mutex);
+  }
+}
+
 #undef CHUNK_SIZE
+#undef NAMEMAP_NUM_SHARDS
+#undef NAMEMAP_SHARD_BITS
+#undef NAMEMAP_INITIAL_BUCKETS
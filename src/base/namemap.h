@@ -53,6 +53,8 @@ extern "C" {
 
   const char * cc_namemap_get_address(const char * str);
   const char * cc_namemap_peek_string(const char * str);
+  void cc_namemap_get_statistics(unsigned int * numstrings, unsigned int * numbuckets,
+                                 unsigned int * numcollisions, unsigned int * maxchain);
 
 /* ********************************************************************** */
 
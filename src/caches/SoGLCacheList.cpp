@@ -58,6 +58,7 @@
 #include "tidbitsp.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "profiler/SoProfilerTrace.h"
 
 // *************************************************************************
 
@@ -88,6 +89,7 @@ public:
   SoElement * invalidelement;
   int numframesok;
   int numshapes;
+  SbBool tracedcache; // a trace begin event was recorded for opencache
 
   //
   // Callback from SoContextHandler
@@ -127,6 +129,7 @@ SoGLCacheList::SoGLCacheList(int numcaches)
   PRIVATE(this)->invalidelement = NULL;
   PRIVATE(this)->numframesok = 0;
   PRIVATE(this)->numshapes = 0;
+  PRIVATE(this)->tracedcache = FALSE;
 
   // auto caching must be enabled using an environment variable
   if (COIN_AUTO_CACHING < 0) {
@@ -537,6 +540,8 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
       PRIVATE(this)->itemlist.remove(0);
       PRIVATE(this)->numdiscarded++;
     }
+    PRIVATE(this)->tracedcache = SoProfilerTrace::isActive();
+    if (PRIVATE(this)->tracedcache) SoProfilerTrace::begin("cache", "SoGLRenderCache");
     PRIVATE(this)->opencache = new SoGLRenderCache(state);
     PRIVATE(this)->opencache->ref();
     SoCacheElement::set(state, PRIVATE(this)->opencache);
@@ -577,6 +582,12 @@ SoGLCacheList::close(SoGLRenderAction * action)
     PRIVATE(this)->opencache->close();
     SoGLLazyElement::endCaching(state);
   }
+  // only end the event if it was begun, also when the trace was
+  // started after open()
+  if (PRIVATE(this)->tracedcache) {
+    SoProfilerTrace::end("cache", "SoGLRenderCache");
+    PRIVATE(this)->tracedcache = FALSE;
+  }
   if (SoCacheElement::setInvalid(PRIVATE(this)->savedinvalid)) {
     // notify parent caches
     SoCacheElement::setInvalid(TRUE);
@@ -77,7 +77,6 @@
 #include <Inventor/misc/SoGLDriverDatabase.h>
 
 #include "tidbitsp.h"
-#include "misc/SbHash.h"
 #include "rendering/SoGL.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoVertexArrayIndexer.h"
@@ -94,7 +93,9 @@ public:
       bumpcoordlist(256),
       rgbalist(256),
       tangentlist(256),
-      vhash(1024),
+      vtable(NULL),
+      vtablesize(0),
+      vtableused(0),
       deptharray(NULL),
       triangleindexer(NULL),
       lineindexer(NULL),
@@ -115,12 +116,16 @@ public:
     uint8_t rgba[4];
     int texcoordidx;
 
-    // needed for SbHash
-    operator unsigned long(void) const;
+    uint32_t hash(void) const;
+  };
 
-    // needed, since if we don't add this the unsigned long operator
-    // will be used when comparing two vertices.
-    int operator==(const Vertex & v);
+  // Open addressing (linear probing) table used to find duplicate
+  // vertices while the cache is built. Stores the vertex hash next
+  // to the index, so that most mismatches are rejected without
+  // looking at the vertex arrays.
+  struct VertexTableEntry {
+    uint32_t hash;
+    int32_t idx;
   };
 
   SbList <Vertex> vertices;
@@ -131,7 +136,10 @@ public:
   SbList <SbVec2f> bumpcoordlist;
   SbList <uint8_t> rgbalist;
   SbList <SbVec3f> tangentlist;
-  SbHash<Vertex, int32_t> vhash;
+  SbList <int32_t> texcoordidxlist;
+  VertexTableEntry * vtable;
+  unsigned int vtablesize;
+  unsigned int vtableused;
 
   const SbVec2f * bumpcoords;
   int numbumpcoords;
@@ -169,6 +177,9 @@ public:
   SoGLLazyElement::GLState poststate;
 
   void addVertex(const Vertex & v);
+  int32_t getVertexIndex(const Vertex & v, SbBool & isnew);
+  SbBool isEqual(const int32_t idx, const Vertex & v) const;
+  void resizeVertexTable(const unsigned int size);
 
   void renderImmediate(const cc_glglue * glue,
                        const GLint * indices,
@@ -320,6 +331,7 @@ SoPrimitiveVertexCache::~SoPrimitiveVertexCache()
     delete[] PRIVATE(this)->multitexcoords;
   }
   delete [] PRIVATE(this)->deptharray;
+  delete [] PRIVATE(this)->vtable;
 }
 
 SbBool 
@@ -538,12 +550,10 @@ SoPrimitiveVertexCache::addTriangle(const SoPrimitiveVertex * v0,
         v.bumpcoord = PRIVATE(this)->bumpcoords[SbClamp(tidx, 0, PRIVATE(this)->numbumpcoords-1)];
       }
     }
-    int32_t idx;
-    if (!PRIVATE(this)->vhash.get(v, idx)) {
-      idx = PRIVATE(this)->vertexlist.getLength();
-      PRIVATE(this)->vhash.put(v, idx);
-      PRIVATE(this)->addVertex(v);
-      triangleindices[i] = idx;
+    SbBool isnew;
+    const int32_t idx = PRIVATE(this)->getVertexIndex(v, isnew);
+    triangleindices[i] = idx;
+    if (isnew) {
 
       // update texture coordinates for unit 1-n
       for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
@@ -559,9 +569,6 @@ SoPrimitiveVertexCache::addTriangle(const SoPrimitiveVertex * v0,
         }
       }
     }
-    else {
-      triangleindices[i] = idx;
-    }
   }
   if (PRIVATE(this)->triangleindexer == NULL) {
     PRIVATE(this)->triangleindexer = new SoVertexArrayIndexer;
@@ -622,12 +629,10 @@ SoPrimitiveVertexCache::addLine(const SoPrimitiveVertex * v0,
         v.bumpcoord = PRIVATE(this)->bumpcoords[SbClamp(tidx, 0, PRIVATE(this)->numbumpcoords-1)];
       }
     }
-    int32_t idx;
-    if (!PRIVATE(this)->vhash.get(v, idx)) {
-      idx = PRIVATE(this)->vertexlist.getLength();
-      PRIVATE(this)->vhash.put(v, idx);
-      PRIVATE(this)->addVertex(v);
-      lineindices[i] = idx;
+    SbBool isnew;
+    const int32_t idx = PRIVATE(this)->getVertexIndex(v, isnew);
+    lineindices[i] = idx;
+    if (isnew) {
 
       // update texture coordinates for unit 1-n
       for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
@@ -643,9 +648,6 @@ SoPrimitiveVertexCache::addLine(const SoPrimitiveVertex * v0,
         }
       }
     }
-    else {
-      lineindices[i] = idx;
-    }
   }
   if (PRIVATE(this)->lineindexer == NULL) {
     PRIVATE(this)->lineindexer = new SoVertexArrayIndexer;
@@ -699,13 +701,10 @@ SoPrimitiveVertexCache::addPoint(const SoPrimitiveVertex * v0)
     PRIVATE(this)->pointindexer = new SoVertexArrayIndexer;
   }
 
-  int32_t idx;
-  if (!PRIVATE(this)->vhash.get(v, idx)) {
-    idx = PRIVATE(this)->vertexlist.getLength();
-    PRIVATE(this)->vhash.put(v, idx);
-    PRIVATE(this)->addVertex(v);
-    PRIVATE(this)->pointindexer->addPoint(idx);
-
+  SbBool isnew;
+  const int32_t idx = PRIVATE(this)->getVertexIndex(v, isnew);
+  PRIVATE(this)->pointindexer->addPoint(idx);
+  if (isnew) {
     // update texture coordinates for unit 1-n
     for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
       if (v.texcoordidx >= 0 &&
@@ -720,9 +719,6 @@ SoPrimitiveVertexCache::addPoint(const SoPrimitiveVertex * v0)
       }
     }
   }
-  else {
-    PRIVATE(this)->pointindexer->addPoint(idx);
-  }
 }
 
 int
@@ -821,6 +817,27 @@ SoPrimitiveVertexCache::getPointIndices(void) const
   return PRIVATE(this)->pointindexer->getIndices();
 }
 
+/*!
+  Preallocates room for \a numvertices unique vertices, to avoid
+  growing the vertex arrays while primitives are added. Should be
+  called before the first primitive is added.
+*/
+void
+SoPrimitiveVertexCache::reserve(const int numvertices)
+{
+  if (numvertices <= 0) return;
+  PRIVATE(this)->vertexlist.ensureCapacity(numvertices);
+  PRIVATE(this)->normallist.ensureCapacity(numvertices);
+  PRIVATE(this)->texcoordlist.ensureCapacity(numvertices);
+  PRIVATE(this)->bumpcoordlist.ensureCapacity(numvertices);
+  PRIVATE(this)->rgbalist.ensureCapacity(numvertices * 4);
+  PRIVATE(this)->texcoordidxlist.ensureCapacity(numvertices);
+
+  unsigned int size = 256;
+  while (size < static_cast<unsigned int>(numvertices) * 2) size <<= 1;
+  if (size > PRIVATE(this)->vtablesize) PRIVATE(this)->resizeVertexTable(size);
+}
+
 void
 SoPrimitiveVertexCache::fit(void)
 {
@@ -829,13 +846,118 @@ SoPrimitiveVertexCache::fit(void)
   PRIVATE(this)->texcoordlist.fit();
   PRIVATE(this)->bumpcoordlist.fit();
   PRIVATE(this)->rgbalist.fit();
-  PRIVATE(this)->vhash.clear();
+  PRIVATE(this)->texcoordidxlist.truncate(0, TRUE);
+  delete [] PRIVATE(this)->vtable;
+  PRIVATE(this)->vtable = NULL;
+  PRIVATE(this)->vtablesize = 0;
+  PRIVATE(this)->vtableused = 0;
 
   if (PRIVATE(this)->triangleindexer) PRIVATE(this)->triangleindexer->close();
   if (PRIVATE(this)->lineindexer) PRIVATE(this)->lineindexer->close();
   if (PRIVATE(this)->pointindexer) PRIVATE(this)->pointindexer->close();
 }
 
+// Sorts the triangles in iptr (three indices per triangle) on the
+// depth values in darray, in ascending order. Gives up and returns
+// FALSE when more than maxmoves triangles have been moved, leaving
+// the arrays in a partially sorted (but consistent) state.
+static SbBool
+sopvcache_insertion_sort(float * darray, GLint * iptr, const int numtri,
+                         const int maxmoves)
+{
+  int moves = 0;
+  for (int i = 1; i < numtri; i++) {
+    if (darray[i-1] <= darray[i]) continue;
+
+    const float dtmp = darray[i];
+    const GLint itmp[3] = { iptr[i*3], iptr[i*3+1], iptr[i*3+2] };
+    int j = i;
+    while (j > 0 && darray[j-1] > dtmp) {
+      darray[j] = darray[j-1];
+      iptr[j*3] = iptr[(j-1)*3];
+      iptr[j*3+1] = iptr[(j-1)*3+1];
+      iptr[j*3+2] = iptr[(j-1)*3+2];
+      j--;
+      moves++;
+    }
+    darray[j] = dtmp;
+    iptr[j*3] = itmp[0];
+    iptr[j*3+1] = itmp[1];
+    iptr[j*3+2] = itmp[2];
+    if (moves > maxmoves) return FALSE;
+  }
+  return TRUE;
+}
+
+// Maps a float to an unsigned integer with the same ordering.
+static inline uint32_t
+sopvcache_float_key(const float f)
+{
+  uint32_t u;
+  (void)memcpy(&u, &f, sizeof(uint32_t));
+  return (u & 0x80000000) ? ~u : (u | 0x80000000);
+}
+
+// Sorts the triangles in iptr (three indices per triangle) on the
+// depth values in darray, in ascending order, with an LSD radix sort
+// on the bit patterns of the depth values. O(n), as opposed to the
+// O(n log(n)) of comparison based sorting.
+static void
+sopvcache_radix_sort(float * darray, GLint * iptr, const int numtri)
+{
+  uint32_t * keys = new uint32_t[numtri * 2];
+  int * perm = new int[numtri * 2];
+  uint32_t * srckeys = keys;
+  uint32_t * dstkeys = keys + numtri;
+  int * srcperm = perm;
+  int * dstperm = perm + numtri;
+
+  int i;
+  for (i = 0; i < numtri; i++) {
+    srckeys[i] = sopvcache_float_key(darray[i]);
+    srcperm[i] = i;
+  }
+
+  for (int shift = 0; shift < 32; shift += 8) {
+    int count[256];
+    (void)memset(count, 0, sizeof(count));
+    for (i = 0; i < numtri; i++) count[(srckeys[i] >> shift) & 0xff]++;
+    // all keys have the same value for this byte
+    if (count[(srckeys[0] >> shift) & 0xff] == numtri) continue;
+
+    int sum = 0;
+    for (i = 0; i < 256; i++) {
+      const int tmp = count[i];
+      count[i] = sum;
+      sum += tmp;
+    }
+    for (i = 0; i < numtri; i++) {
+      const int pos = count[(srckeys[i] >> shift) & 0xff]++;
+      dstkeys[pos] = srckeys[i];
+      dstperm[pos] = srcperm[i];
+    }
+    uint32_t * tmpkeys = srckeys; srckeys = dstkeys; dstkeys = tmpkeys;
+    int * tmpperm = srcperm; srcperm = dstperm; dstperm = tmpperm;
+  }
+
+  float * sorteddepth = new float[numtri];
+  GLint * sortedidx = new GLint[numtri * 3];
+  for (i = 0; i < numtri; i++) {
+    const int src = srcperm[i];
+    sorteddepth[i] = darray[src];
+    sortedidx[i*3] = iptr[src*3];
+    sortedidx[i*3+1] = iptr[src*3+1];
+    sortedidx[i*3+2] = iptr[src*3+2];
+  }
+  (void)memcpy(darray, sorteddepth, numtri * sizeof(float));
+  (void)memcpy(iptr, sortedidx, numtri * 3 * sizeof(GLint));
+
+  delete[] sortedidx;
+  delete[] sorteddepth;
+  delete[] perm;
+  delete[] keys;
+}
+
 void
 SoPrimitiveVertexCache::depthSortTriangles(SoState * state)
 {
@@ -864,65 +986,126 @@ SoPrimitiveVertexCache::depthSortTriangles(SoState * state)
       }
       darray[i] = acc / 3.0f;
     }
-    int distance;
-    float dtmp;
-    int itmp[3];
-
-    // shell sort algorithm (O(nlog(n))
-    for (distance = 1; distance <= numtri/9; distance = 3*distance + 1) ;
-    for (; distance > 0; distance /= 3) {
-      for (i = distance; i < numtri; i++) {
-        dtmp = darray[i];
-        itmp[0] = iptr[i*3];
-        itmp[1] = iptr[i*3+1];
-        itmp[2] = iptr[i*3+2];
-        j = i;
-        while (j >= distance && darray[j-distance] > dtmp) {
-          darray[j] = darray[j-distance];
-          iptr[j*3] = iptr[(j-distance)*3];
-          iptr[j*3+1] = iptr[(j-distance)*3+1];
-          iptr[j*3+2] = iptr[(j-distance)*3+2];
-          j -= distance;
-        }
-        darray[j] = dtmp;
-        iptr[j*3] = itmp[0];
-        iptr[j*3+1] = itmp[1];
-        iptr[j*3+2] = itmp[2];
-      }
+    // The triangles are still in the order from the previous sort,
+    // which is nearly sorted when the camera has moved only a
+    // little. Insertion sort is linear for such input, so try that
+    // first, and fall back to a radix sort if too many triangles
+    // need to be moved.
+    if (!sopvcache_insertion_sort(darray, iptr, numtri, numtri)) {
+      sopvcache_radix_sort(darray, iptr, numtri);
     }
   }
 }
 
-SoPrimitiveVertexCacheP::Vertex::operator unsigned long(void) const
+// Murmur3 style mixing of one 32-bit word into a hash value.
+static inline uint32_t
+sopvcache_mix(uint32_t h, uint32_t k)
 {
-  unsigned long key = 0;
-  // create an xor key based on coordinates, normal and texcoords
-  const unsigned char * ptr = reinterpret_cast<const unsigned char *>(this);
-
-  // a bit hackish. Stop xor'ing at bumpcoord
-  const unsigned char * stop = reinterpret_cast<const unsigned char *>(&this->bumpcoord);
-  const ptrdiff_t size = stop-ptr;
+  k *= 0xcc9e2d51;
+  k = (k << 15) | (k >> 17);
+  k *= 0x1b873593;
+  h ^= k;
+  h = (h << 13) | (h >> 19);
+  return h * 5 + 0xe6546b64;
+}
 
-  for (int i = 0; i < size; i++) {
-    int shift = (i%4) * 8;
-    key ^= (ptr[i]<<shift);
+uint32_t
+SoPrimitiveVertexCacheP::Vertex::hash(void) const
+{
+  // Copy all the vertex data into 16 words, and hash them in four
+  // independent lanes, which the compiler can vectorize.
+  uint32_t words[16];
+  (void) memcpy(&words[0], this->vertex.getValue(), sizeof(float) * 3);
+  (void) memcpy(&words[3], this->normal.getValue(), sizeof(float) * 3);
+  (void) memcpy(&words[6], this->texcoord0.getValue(), sizeof(float) * 4);
+  (void) memcpy(&words[10], this->bumpcoord.getValue(), sizeof(float) * 2);
+  (void) memcpy(&words[12], this->rgba, 4);
+  (void) memcpy(&words[13], &this->texcoordidx, sizeof(int32_t));
+  words[14] = words[15] = 0;
+
+  uint32_t lane[4] = { 0x9747b28c, 0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f };
+  for (int i = 0; i < 16; i += 4) {
+    for (int j = 0; j < 4; j++) {
+      lane[j] = sopvcache_mix(lane[j], words[i+j]);
+    }
   }
-  return key;
+  uint32_t h = lane[0] ^ ((lane[1] << 7) | (lane[1] >> 25)) ^
+    ((lane[2] << 14) | (lane[2] >> 18)) ^ ((lane[3] << 21) | (lane[3] >> 11));
+
+  // final avalanche
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
 }
 
-int
-SoPrimitiveVertexCacheP::Vertex::operator==(const Vertex & v)
+SbBool
+SoPrimitiveVertexCacheP::isEqual(const int32_t idx, const Vertex & v) const
 {
+  const uint8_t * rgba = this->rgbalist.getArrayPtr() + idx * 4;
   return
-    (this->vertex == v.vertex) &&
-    (this->normal == v.normal) &&
-    (this->texcoord0 == v.texcoord0) &&
-    (this->bumpcoord == v.bumpcoord) &&
-    (this->texcoordidx == v.texcoordidx) &&
-    (this->rgba[0] == v.rgba[0]) &&
-    (this->rgba[1] == v.rgba[1]) &&
-    (this->rgba[2] == v.rgba[2]) &&
-    (this->rgba[3] == v.rgba[3]);
+    (this->vertexlist[idx] == v.vertex) &&
+    (this->normallist[idx] == v.normal) &&
+    (this->texcoordlist[idx] == v.texcoord0) &&
+    (this->bumpcoordlist[idx] == v.bumpcoord) &&
+    (this->texcoordidxlist[idx] == v.texcoordidx) &&
+    (rgba[0] == v.rgba[0]) &&
+    (rgba[1] == v.rgba[1]) &&
+    (rgba[2] == v.rgba[2]) &&
+    (rgba[3] == v.rgba[3]);
+}
+
+void
+SoPrimitiveVertexCacheP::resizeVertexTable(const unsigned int size)
+{
+  assert((size & (size - 1)) == 0 && "size must be a power of two");
+  VertexTableEntry * oldtable = this->vtable;
+  const unsigned int oldsize = this->vtablesize;
+
+  this->vtable = new VertexTableEntry[size];
+  this->vtablesize = size;
+  for (unsigned int i = 0; i < size; i++) {
+    this->vtable[i].idx = -1;
+  }
+  const unsigned int mask = size - 1;
+  for (unsigned int i = 0; i < oldsize; i++) {
+    if (oldtable[i].idx < 0) continue;
+    unsigned int slot = oldtable[i].hash & mask;
+    while (this->vtable[slot].idx >= 0) slot = (slot + 1) & mask;
+    this->vtable[slot] = oldtable[i];
+  }
+  delete [] oldtable;
+}
+
+// Returns the index of a vertex equal to \a v, adding \a v to the
+// vertex arrays if there is no such vertex yet.
+int32_t
+SoPrimitiveVertexCacheP::getVertexIndex(const Vertex & v, SbBool & isnew)
+{
+  // keep the load factor below 0.5, so probe sequences stay short
+  if ((this->vtableused + 1) * 2 > this->vtablesize) {
+    this->resizeVertexTable(this->vtablesize ? this->vtablesize * 2 : 256);
+  }
+  const uint32_t hash = v.hash();
+  const unsigned int mask = this->vtablesize - 1;
+  unsigned int slot = hash & mask;
+  while (this->vtable[slot].idx >= 0) {
+    if (this->vtable[slot].hash == hash &&
+        this->isEqual(this->vtable[slot].idx, v)) {
+      isnew = FALSE;
+      return this->vtable[slot].idx;
+    }
+    slot = (slot + 1) & mask;
+  }
+  const int32_t idx = this->vertexlist.getLength();
+  this->vtable[slot].hash = hash;
+  this->vtable[slot].idx = idx;
+  this->vtableused++;
+  this->addVertex(v);
+  isnew = TRUE;
+  return idx;
 }
 
 void
@@ -935,6 +1118,7 @@ SoPrimitiveVertexCacheP::addVertex(const Vertex & v)
   for (int c = 0; c < 4; c++) {
     this->rgbalist.append(v.rgba[c]);
   }
+  this->texcoordidxlist.append(v.texcoordidx);
 }
 
 void
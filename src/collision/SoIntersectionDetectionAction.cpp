@@ -120,11 +120,6 @@
 // intersection testing code in SoExtSelection. Check if that could be
 // used.
 
-// FIXME: I just noticed that there's an O(n^2) algorithm for removing
-// duplicates from SbOctTree::findItems() results in SbOctTree.cpp
-// (see the add_to_array() helper function). This may very well be a
-// serious bottleneck, should investigate. 20050512 mortene.
-
 // *************************************************************************
 
 /*! \file SoIntersectionDetectionAction.h */
@@ -181,6 +176,7 @@
 
 #include "SbBasicP.h"
 
+#include <cstdlib>
 #include <list>
 #include <vector>
 
@@ -744,6 +740,7 @@ public:
   {
     this->path = NULL;
     this->octtree = NULL;
+    this->currentstamp = 0;
   }
 
   ~PrimitiveData()
@@ -784,14 +781,50 @@ public:
                                "made new octtree for PrimitiveData %p", this);
       }
 
+      // The items in the octtree are pointers into the triangle
+      // list, so the index of a triangle found in the octtree is
+      // known without a lookup.
+      SbTri3f * const * items = this->triangles.getArrayPtr();
       for (unsigned int k = 0; k < this->numTriangles(); k++) {
-        SbTri3f * t = this->getTriangle(k);
-        this->octtree->addItem(t);
+        this->octtree->addItem(const_cast<SbTri3f **>(&items[k]));
       }
     }
     return this->octtree;
   }
 
+  // Finds the indices of all triangles with bounding boxes
+  // intersecting \a box, in the order SbOctTree::findItems() finds
+  // them. Duplicates are removed with a stamp per triangle instead of
+  // through SbOctTree::findItems(), as the latter is O(n^2) in the
+  // number of items found.
+  void findTriangles(const SbBox3f & box, SbList<int> & indices)
+  {
+    const SbOctTree * tree = this->getOctTree();
+    const int numtri = this->triangles.getLength();
+    if (this->stamps.getLength() != numtri) {
+      this->stamps.truncate(0);
+      for (int i = 0; i < numtri; i++) { this->stamps.append(0); }
+      this->currentstamp = 0;
+    }
+    if (++this->currentstamp == 0) {
+      for (int i = 0; i < numtri; i++) { this->stamps[i] = 0; }
+      this->currentstamp = 1;
+    }
+
+    this->founditems.truncate(0);
+    tree->findItems(box, this->founditems, FALSE);
+
+    indices.truncate(0);
+    SbTri3f * const * items = this->triangles.getArrayPtr();
+    for (int i = 0; i < this->founditems.getLength(); i++) {
+      const int idx = static_cast<int>(static_cast<SbTri3f **>(this->founditems[i]) - items);
+      if (this->stamps[idx] != this->currentstamp) {
+        this->stamps[idx] = this->currentstamp;
+        indices.append(idx);
+      }
+    }
+  }
+
 
   void setPath(SoPath * p) { this->path = p; }
   SoPath * getPath(void) const { return this->path; }
@@ -818,12 +851,15 @@ private:
   SbList<SbTri3f*> triangles;
   SbBox3f bbox;
   SbOctTree * octtree;
+  SbList<void*> founditems;
+  SbList<unsigned int> stamps;
+  unsigned int currentstamp;
 };
 
 SbBool
 PrimitiveData::insideboxfunc(void * const item, const SbBox3f & box)
 {
-  SbTri3f * tri = static_cast<SbTri3f *>(item);
+  SbTri3f * tri = *static_cast<SbTri3f **>(item);
   return box.intersect(tri->getBoundingBox());
 }
 
@@ -1345,11 +1381,11 @@ SoIntersectionDetectionAction::PImpl::doPrimitiveIntersectionTesting(PrimitiveDa
     iterationprims = primitives1;
   }
 
-  const SbOctTree * octtree = octtreeprims->getOctTree();
-
   const float theepsilon = this->getEpsilon();
   const SbVec3f e(theepsilon, theepsilon, theepsilon);
 
+  SbList<int> candidatetris;
+
   for (unsigned int i = 0; i < iterationprims->numTriangles(); i++) {
     SbTri3f * t1 = static_cast<SbTri3f *>(iterationprims->getTriangle(i));
 
@@ -1360,11 +1396,10 @@ SoIntersectionDetectionAction::PImpl::doPrimitiveIntersectionTesting(PrimitiveDa
       tribbox.getMax() += e;
     }
 
-    SbList<void*> candidatetris;
-    octtree->findItems(tribbox, candidatetris);
+    octtreeprims->findTriangles(tribbox, candidatetris);
 
     for (int j = 0; j < candidatetris.getLength(); j++) {
-      SbTri3f * t2 = static_cast<SbTri3f *>(candidatetris[j]);
+      SbTri3f * t2 = octtreeprims->getTriangle(candidatetris[j]);
 
       nrisectchks++;
 
@@ -1425,6 +1460,15 @@ done:
   }
 }
 
+// qsort() callback for sorting triangle indices.
+static int
+compare_indices(const void * a, const void * b)
+{
+  const int ia = *static_cast<const int *>(a);
+  const int ib = *static_cast<const int *>(b);
+  return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
+}
+
 // Does intersection testing internally within the same
 // shape. Triangles are not tested against themselves.
 //
@@ -1441,17 +1485,31 @@ SoIntersectionDetectionAction::PImpl::doInternalPrimitiveIntersectionTesting(Pri
   }
   unsigned int nrisectchks = 0;
 
-  // FIXME: use the SbOctTree optimization, as above. Should refactor
-  // doPrimitiveIntersectionTesting() and
+  // FIXME: should refactor doPrimitiveIntersectionTesting() and
   // doInternalPrimitiveIntersectionTesting() into common
   // code. 20030328 mortene.
 
   cont = TRUE;
   const int numprimitives = primitives->numTriangles();
+  SbList<int> candidatetris;
   for (int i = 0; i < numprimitives; i++ ) {
     SbTri3f * t1 = static_cast<SbTri3f *>(primitives->getTriangle(i));
-    for (int j = i + 1; j < numprimitives; j++ ) {
-      SbTri3f * t2 = static_cast<SbTri3f *>(primitives->getTriangle(j));
+
+    // Only triangles with overlapping bounding boxes can intersect,
+    // so find those in the octtree instead of testing against all
+    // other triangles. The candidates are tested in index order, so
+    // callbacks are invoked in the same order as when testing all
+    // pairs.
+    primitives->findTriangles(t1->getBoundingBox(), candidatetris);
+    int numcandidates = 0;
+    for (int k = 0; k < candidatetris.getLength(); k++) {
+      if (candidatetris[k] > i) { candidatetris[numcandidates++] = candidatetris[k]; }
+    }
+    candidatetris.truncate(numcandidates);
+    qsort((void*) candidatetris.getArrayPtr(), numcandidates, sizeof(int), compare_indices);
+
+    for (int k = 0; k < numcandidates; k++ ) {
+      SbTri3f * t2 = static_cast<SbTri3f *>(primitives->getTriangle(candidatetris[k]));
       nrisectchks++;
       if ( t1->intersect(*t2) ) {
         SoIntersectingPrimitive p1;
@@ -237,6 +237,14 @@ SoGLDisplayList::unref(SoState * state)
   }
 }
 
+// Returns the reference count. Used by SoGLImage to find out if a
+// texture object is deleted when it is unreferenced.
+int
+SoGLDisplayList::getRefCount(void) const
+{
+  return PRIVATE(this)->refcount;
+}
+
 /*!
   Open this display list/texture object.
 */
@@ -231,6 +231,7 @@ SoGLMultiTextureImageElement::set(SoState * const state, SoNode * const node,
                    model,
                    blendColor);
     ud.glimage = image;
+    sogl_glimage_set_owner_node(image, node);
     // make sure image isn't changed while this is the active texture
     // FIXME: buggy. Find some solution to handle this. pederb, 2003-11-12
     // if (image->getImage()) image->getImage()->readLock();
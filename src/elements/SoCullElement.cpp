@@ -87,6 +87,7 @@
 #include <Inventor/SbViewVolume.h>
 #include <cstring>
 #include <cassert>
+#include <cmath>
 
 #include "coindefs.h"
 #include "SbBasicP.h"
@@ -284,14 +285,16 @@ SoCullElement::docull(SoState * state, const SbBox3f & box, const SbBool transfo
 
   if (!elem) return FALSE;
 
+  const int n = elem->numplanes;
+  unsigned int flags = elem->flags;
+  const SbPlane * planes = elem->plane;
+  unsigned int mask = 0x0001;
   int i, j;
-  SbVec3f min, max;
-  min = box.getMin();
-  max = box.getMax();
-  SbVec3f pts[8];
+
+  const SbVec3f & min = box.getMin();
+  const SbVec3f & max = box.getMax();
 
   SbMatrix mm;
-  SbBool identity = ! transform;
   if (transform) {
     SbBool wasopen = state->isCacheOpen();
     // close the cache, since we don't create a cache dependency on
@@ -301,32 +304,64 @@ SoCullElement::docull(SoState * state, const SbBox3f & box, const SbBool transfo
     state->setCacheOpen(wasopen);
   }
 
-  // create the 8 box corner points
-  for (i = 0; i < 8; i++) {
-    pts[i][0] = i & 1 ? min[0] : max[0];
-    pts[i][1] = i & 2 ? min[1] : max[1];
-    pts[i][2] = i & 4 ? min[2] : max[2];
-    if (!identity) mm.multVecMatrix(pts[i], pts[i]);
+  if (!transform ||
+      (mm[0][3] == 0.0f && mm[1][3] == 0.0f &&
+       mm[2][3] == 0.0f && mm[3][3] == 1.0f)) {
+    // Affine (or no) transform. Test the box center against each
+    // plane, using the projected radius of the box along the plane
+    // normal. This gives the same result as testing all eight
+    // corners, but only needs a single vector transform.
+    SbVec3f center = (min + max) * 0.5f;
+    SbVec3f halfsize = (max - min) * 0.5f;
+    SbVec3f axis[3];
+    for (i = 0; i < 3; i++) {
+      if (transform) axis[i].setValue(mm[i][0], mm[i][1], mm[i][2]);
+      else axis[i].setValue(i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f);
+      axis[i] *= halfsize[i];
+    }
+    if (transform) mm.multVecMatrix(center, center);
+
+    for (i = 0; i < n; i++, mask<<=1) {
+      if (!(flags & mask)) {
+        const SbVec3f & normal = planes[i].getNormal();
+        const float dist = planes[i].getDistance(center);
+        const float radius =
+          static_cast<float>(fabs(normal.dot(axis[0]))) +
+          static_cast<float>(fabs(normal.dot(axis[1]))) +
+          static_cast<float>(fabs(normal.dot(axis[2])));
+        if (dist - radius >= 0.0f) {
+          flags |= mask;
+        }
+        else if (dist + radius < 0.0f) {
+          return TRUE;
+        }
+      }
+    }
   }
+  else {
+    // projective model matrix, transform all eight box corners
+    SbVec3f pts[8];
+    for (i = 0; i < 8; i++) {
+      pts[i][0] = i & 1 ? min[0] : max[0];
+      pts[i][1] = i & 2 ? min[1] : max[1];
+      pts[i][2] = i & 4 ? min[2] : max[2];
+      mm.multVecMatrix(pts[i], pts[i]);
+    }
 
-  const int n = elem->numplanes;
-  unsigned int flags = elem->flags;
-  const SbPlane * planes = elem->plane;
-  unsigned int mask = 0x0001;
-
-  for (i = 0; i < n; i++, mask<<=1) {
-    if (!(flags & mask)) {
-      int in = 0;
-      int out = 0;
-      for (j = 0; j < 8; j++) {
-        if (planes[i].isInHalfSpace(pts[j])) in++;
-        else out++;
-      }
-      if (in == 8) {
-        flags |= mask;
-      }
-      else if (out == 8) {
-        return TRUE;
+    for (i = 0; i < n; i++, mask<<=1) {
+      if (!(flags & mask)) {
+        int in = 0;
+        int out = 0;
+        for (j = 0; j < 8; j++) {
+          if (planes[i].isInHalfSpace(pts[j])) in++;
+          else out++;
+        }
+        if (in == 8) {
+          flags |= mask;
+        }
+        else if (out == 8) {
+          return TRUE;
+        }
       }
     }
   }
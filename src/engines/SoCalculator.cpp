@@ -209,7 +209,13 @@
 #include "SbBasicP.h"
 
 #include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
+#include <Inventor/SbBasic.h>
+#include <Inventor/C/tidbits.h>
 #include <Inventor/lists/SoEngineOutputList.h>
 
 #if COIN_DEBUG
@@ -320,6 +326,584 @@
   (SoMFVec3f) Output value with result from the calculations.
 */
 
+// *************************************************************************
+
+// The expressions are compiled into a simple register based bytecode
+// which is executed on blocks of array elements at a time. Each
+// register holds one float value for each element in the block, and
+// the instructions are run as tight loops over the block, so that
+// the compiler can vectorize them. This avoids walking the
+// expression tree and looking up registers by name for each element.
+
+namespace {
+
+enum {
+  CALC_BLOCKSIZE = 64,
+
+  // fixed registers. vectors use three consecutive registers
+  CALC_REG_IN_FLT = 0,   // a-h
+  CALC_REG_IN_VEC = 8,   // A-H
+  CALC_REG_TMP_FLT = 32, // ta-th
+  CALC_REG_TMP_VEC = 40, // tA-tH
+  CALC_REG_OUT_FLT = 64, // oa-od
+  CALC_REG_OUT_VEC = 68, // oA-oD
+  CALC_REG_SCRATCH = 80  // intermediate results
+};
+
+enum {
+  CALC_OP_CONST,
+  CALC_OP_MOV,
+  CALC_OP_ADD,
+  CALC_OP_SUB,
+  CALC_OP_MUL,
+  CALC_OP_DIV,
+  CALC_OP_NEG,
+  CALC_OP_AND,
+  CALC_OP_OR,
+  CALC_OP_NOT,
+  CALC_OP_LEQ,
+  CALC_OP_GEQ,
+  CALC_OP_EQ,
+  CALC_OP_NEQ,
+  CALC_OP_LT,
+  CALC_OP_GT,
+  CALC_OP_TEST_FLT,
+  CALC_OP_TEST_VEC,
+  CALC_OP_SELECT,
+  CALC_OP_FUNC1,
+  CALC_OP_FUNC2,
+  CALC_OP_RAND,
+  CALC_OP_CROSS,
+  CALC_OP_DOT,
+  CALC_OP_LEN,
+  CALC_OP_NORMALIZE
+};
+
+typedef float calc_func1(float);
+typedef float calc_func2(float, float);
+
+struct calc_instruction {
+  int op;
+  int dst, a, b, c;
+  float value;
+  calc_func1 * func1;
+  calc_func2 * func2;
+};
+
+// these must give the exact same results as so_eval_traverse(), so
+// the calculations are done in double precision
+
+float calc_cos(float x) { return static_cast<float>(cos(double(x))); }
+float calc_sin(float x) { return static_cast<float>(sin(double(x))); }
+float calc_tan(float x) { return static_cast<float>(tan(double(x))); }
+float calc_acos(float x) { return static_cast<float>(acos(double(SbClamp(x, -1.0f, 1.0f)))); }
+float calc_asin(float x) { return static_cast<float>(asin(double(SbClamp(x, -1.0f, 1.0f)))); }
+float calc_atan(float x) { return static_cast<float>(atan(double(x))); }
+float calc_cosh(float x) { return static_cast<float>(cosh(double(x))); }
+float calc_sinh(float x) { return static_cast<float>(sinh(double(x))); }
+float calc_tanh(float x) { return static_cast<float>(tanh(double(x))); }
+float calc_sqrt(float x) { return x > 0.0f ? static_cast<float>(sqrt(double(x))) : 0.0f; }
+float calc_exp(float x) { return static_cast<float>(exp(double(x))); }
+float calc_log(float x) { return x <= 0.0f ? -128.0f : static_cast<float>(log(double(x))); }
+float calc_log10(float x) { return x <= 0.0f ? -38.0f : static_cast<float>(log10(double(x))); }
+float calc_ceil(float x) { return static_cast<float>(ceil(double(x))); }
+float calc_floor(float x) { return static_cast<float>(floor(double(x))); }
+float calc_fabs(float x) { return static_cast<float>(fabs(double(x))); }
+
+float
+calc_fmod(float x, float y)
+{
+  return y != 0.0f ? static_cast<float>(fmod(double(x), double(y))) : 0.0f;
+}
+
+float
+calc_atan2(float y, float x)
+{
+  if (x == 0.0) return static_cast<float>(y >= 0.0f ? M_PI * 0.5 : - M_PI * 0.5);
+  return static_cast<float>(atan2(double(y), double(x)));
+}
+
+float
+calc_pow(float x, float y)
+{
+  if (x == 0.0f) return 0.0f;
+  if (x > 0.0f) return static_cast<float>(pow(double(x), double(y)));
+  return static_cast<float>(pow(double(x), floor(y + 0.5)));
+}
+
+class SoCalculatorProgram {
+public:
+  SoCalculatorProgram(void) : regs(NULL) { }
+  ~SoCalculatorProgram() { delete[] this->regs; }
+
+  SbBool compile(const SbList<so_eval_node *> & expressions);
+  void clear(void);
+
+  // 0-7 => a-h, 8-15 => A-H
+  SbBool inused[16];
+  // 0-3 => oa-od, 4-7 => oA-oD
+  SbBool outused[8];
+  // 0-7 => ta-th, 8-15 => tA-tH
+  SbBool tmpused[16];
+  // elements must be evaluated one by one
+  SbBool serial;
+
+  SbList<calc_instruction> code;
+  float * regs;
+
+  float * reg(const int idx) { return this->regs + idx * CALC_BLOCKSIZE; }
+  void execute(const int num);
+
+private:
+  int compileNode(const so_eval_node * node);
+  int regIndex(const char * regname);
+  int newScratch(const int num);
+  void read(const int reg, const int num);
+  void write(const int reg, const int num);
+  void emit(const int op, const int dst, const int a = -1, const int b = -1, const int c = -1);
+  void emitFunc1(calc_func1 * func, const int dst, const int a);
+  void emitFunc2(calc_func2 * func, const int dst, const int a, const int b);
+
+  int numregs;
+  int branchdepth;
+  SbBool failed;
+  SbBool written[CALC_REG_SCRATCH];
+};
+
+void
+SoCalculatorProgram::clear(void)
+{
+  this->code.truncate(0);
+  delete[] this->regs;
+  this->regs = NULL;
+}
+
+// Returns FALSE if the expressions can't be compiled, and must be
+// evaluated by so_eval_evaluate() instead.
+SbBool
+SoCalculatorProgram::compile(const SbList<so_eval_node *> & expressions)
+{
+  int i;
+  this->clear();
+  for (i = 0; i < 16; i++) this->inused[i] = this->tmpused[i] = FALSE;
+  for (i = 0; i < 8; i++) this->outused[i] = FALSE;
+  for (i = 0; i < CALC_REG_SCRATCH; i++) this->written[i] = FALSE;
+  this->serial = FALSE;
+  this->failed = FALSE;
+  this->branchdepth = 0;
+  this->numregs = CALC_REG_SCRATCH;
+
+  for (i = 0; i < expressions.getLength() && !this->failed; i++) {
+    if (expressions[i]) (void) this->compileNode(expressions[i]);
+  }
+  if (this->failed) {
+    this->code.truncate(0);
+    return FALSE;
+  }
+  this->regs = new float[this->numregs * CALC_BLOCKSIZE];
+  return TRUE;
+}
+
+int
+SoCalculatorProgram::regIndex(const char * regname)
+{
+  if (regname[0] == 'o') {
+    if (regname[1] >= 'A' && regname[1] <= 'D') {
+      return CALC_REG_OUT_VEC + 3 * (regname[1] - 'A');
+    }
+    assert(regname[1] >= 'a' && regname[1] <= 'd');
+    return CALC_REG_OUT_FLT + (regname[1] - 'a');
+  }
+  if (regname[0] == 't') {
+    if (regname[1] >= 'A' && regname[1] <= 'H') {
+      this->tmpused[regname[1] - 'A' + 8] = TRUE;
+      return CALC_REG_TMP_VEC + 3 * (regname[1] - 'A');
+    }
+    assert(regname[1] >= 'a' && regname[1] <= 'h');
+    this->tmpused[regname[1] - 'a'] = TRUE;
+    return CALC_REG_TMP_FLT + (regname[1] - 'a');
+  }
+  if (regname[0] >= 'A' && regname[0] <= 'H') {
+    this->inused[regname[0] - 'A' + 8] = TRUE;
+    return CALC_REG_IN_VEC + 3 * (regname[0] - 'A');
+  }
+  assert(regname[0] >= 'a' && regname[0] <= 'h');
+  this->inused[regname[0] - 'a'] = TRUE;
+  return CALC_REG_IN_FLT + (regname[0] - 'a');
+}
+
+int
+SoCalculatorProgram::newScratch(const int num)
+{
+  const int reg = this->numregs;
+  this->numregs += num;
+  return reg;
+}
+
+// A temporary register read before it is written in the expressions
+// carries its value over from the previous array element.
+void
+SoCalculatorProgram::read(const int reg, const int num)
+{
+  for (int i = reg; i < reg + num; i++) {
+    if (i >= CALC_REG_TMP_FLT && i < CALC_REG_OUT_FLT && !this->written[i]) {
+      this->serial = TRUE;
+    }
+  }
+}
+
+// Marks registers as assigned to. Only outputs assigned to are
+// written to the engine outputs.
+void
+SoCalculatorProgram::write(const int reg, const int num)
+{
+  for (int i = reg; i < reg + num; i++) this->written[i] = TRUE;
+  if (reg >= CALC_REG_OUT_VEC) this->outused[4 + (reg - CALC_REG_OUT_VEC) / 3] = TRUE;
+  else if (reg >= CALC_REG_OUT_FLT) this->outused[reg - CALC_REG_OUT_FLT] = TRUE;
+}
+
+void
+SoCalculatorProgram::emit(const int op, const int dst, const int a, const int b, const int c)
+{
+  calc_instruction instr;
+  instr.op = op;
+  instr.dst = dst;
+  instr.a = a;
+  instr.b = b;
+  instr.c = c;
+  instr.value = 0.0f;
+  instr.func1 = NULL;
+  instr.func2 = NULL;
+  this->code.append(instr);
+}
+
+void
+SoCalculatorProgram::emitFunc1(calc_func1 * func, const int dst, const int a)
+{
+  this->emit(CALC_OP_FUNC1, dst, a);
+  this->code[this->code.getLength() - 1].func1 = func;
+}
+
+void
+SoCalculatorProgram::emitFunc2(calc_func2 * func, const int dst, const int a, const int b)
+{
+  this->emit(CALC_OP_FUNC2, dst, a, b);
+  this->code[this->code.getLength() - 1].func2 = func;
+}
+
+// Emits code for the node, and returns the register holding the
+// result. Vector results are held in three consecutive registers.
+int
+SoCalculatorProgram::compileNode(const so_eval_node * node)
+{
+  int a, b, c, dst, i;
+
+  switch (node->id) {
+  case ID_FLT_REG:
+    dst = this->regIndex(node->regname);
+    this->read(dst, 1);
+    return dst;
+  case ID_VEC_REG:
+    dst = this->regIndex(node->regname);
+    this->read(dst, 3);
+    return dst;
+  case ID_VEC_REG_COMP:
+    assert(node->regidx >= 0 && node->regidx <= 2);
+    dst = this->regIndex(node->regname) + node->regidx;
+    this->read(dst, 1);
+    return dst;
+  case ID_VALUE:
+    dst = this->newScratch(1);
+    this->emit(CALC_OP_CONST, dst);
+    this->code[this->code.getLength() - 1].value = node->value;
+    return dst;
+
+  case ID_ASSIGN_FLT:
+    a = this->compileNode(node->child2);
+    dst = this->regIndex(node->child1->regname);
+    if (node->child1->regidx >= 0) dst += node->child1->regidx;
+    this->emit(CALC_OP_MOV, dst, a);
+    this->write(dst, 1);
+    return -1;
+  case ID_ASSIGN_VEC:
+    a = this->compileNode(node->child2);
+    dst = this->regIndex(node->child1->regname);
+    for (i = 0; i < 3; i++) this->emit(CALC_OP_MOV, dst + i, a + i);
+    this->write(dst, 3);
+    return -1;
+  case ID_SEPARATOR:
+    // a trailing ';' gives a separator with only one child
+    if (node->child1) (void) this->compileNode(node->child1);
+    if (node->child2) (void) this->compileNode(node->child2);
+    return -1;
+
+  case ID_FLT_COND:
+  case ID_VEC_COND:
+    // both branches are evaluated, and the result selected per
+    // element afterwards
+    c = this->compileNode(node->child1);
+    this->branchdepth++;
+    a = this->compileNode(node->child2);
+    b = this->compileNode(node->child3);
+    this->branchdepth--;
+    if (node->id == ID_FLT_COND) {
+      dst = this->newScratch(1);
+      this->emit(CALC_OP_SELECT, dst, a, b, c);
+    }
+    else {
+      dst = this->newScratch(3);
+      for (i = 0; i < 3; i++) this->emit(CALC_OP_SELECT, dst + i, a + i, b + i, c);
+    }
+    return dst;
+
+  case ID_RAND:
+    // a random number in a branch not taken would change the
+    // sequence of random numbers
+    if (this->branchdepth > 0) this->failed = TRUE;
+    // keep the order of random numbers
+    this->serial = TRUE;
+    a = this->compileNode(node->child1);
+    dst = this->newScratch(1);
+    this->emit(CALC_OP_RAND, dst, a);
+    return dst;
+
+  default:
+    break;
+  }
+
+  a = node->child1 ? this->compileNode(node->child1) : -1;
+  b = node->child2 ? this->compileNode(node->child2) : -1;
+  c = node->child3 ? this->compileNode(node->child3) : -1;
+
+  switch (node->id) {
+  case ID_ADD_VEC:
+  case ID_SUB_VEC:
+    dst = this->newScratch(3);
+    for (i = 0; i < 3; i++) {
+      this->emit(node->id == ID_ADD_VEC ? CALC_OP_ADD : CALC_OP_SUB, dst + i, a + i, b + i);
+    }
+    return dst;
+  case ID_NEG_VEC:
+    dst = this->newScratch(3);
+    for (i = 0; i < 3; i++) this->emit(CALC_OP_NEG, dst + i, a + i);
+    return dst;
+  case ID_MUL_VEC_FLT:
+  case ID_DIV_VEC_FLT:
+    dst = this->newScratch(3);
+    for (i = 0; i < 3; i++) {
+      this->emit(node->id == ID_MUL_VEC_FLT ? CALC_OP_MUL : CALC_OP_DIV, dst + i, a + i, b);
+    }
+    return dst;
+  case ID_VEC3F:
+    dst = this->newScratch(3);
+    this->emit(CALC_OP_MOV, dst, a);
+    this->emit(CALC_OP_MOV, dst + 1, b);
+    this->emit(CALC_OP_MOV, dst + 2, c);
+    return dst;
+  case ID_CROSS:
+  case ID_NORMALIZE:
+    dst = this->newScratch(3);
+    this->emit(node->id == ID_CROSS ? CALC_OP_CROSS : CALC_OP_NORMALIZE, dst, a, b);
+    return dst;
+  default:
+    break;
+  }
+
+  dst = this->newScratch(1);
+  switch (node->id) {
+  case ID_ADD: this->emit(CALC_OP_ADD, dst, a, b); break;
+  case ID_SUB: this->emit(CALC_OP_SUB, dst, a, b); break;
+  case ID_MUL: this->emit(CALC_OP_MUL, dst, a, b); break;
+  case ID_DIV: this->emit(CALC_OP_DIV, dst, a, b); break;
+  case ID_NEG: this->emit(CALC_OP_NEG, dst, a); break;
+  case ID_AND: this->emit(CALC_OP_AND, dst, a, b); break;
+  case ID_OR: this->emit(CALC_OP_OR, dst, a, b); break;
+  case ID_NOT: this->emit(CALC_OP_NOT, dst, a); break;
+  case ID_LEQ: this->emit(CALC_OP_LEQ, dst, a, b); break;
+  case ID_GEQ: this->emit(CALC_OP_GEQ, dst, a, b); break;
+  case ID_EQ: this->emit(CALC_OP_EQ, dst, a, b); break;
+  case ID_NEQ: this->emit(CALC_OP_NEQ, dst, a, b); break;
+  case ID_LT: this->emit(CALC_OP_LT, dst, a, b); break;
+  case ID_GT: this->emit(CALC_OP_GT, dst, a, b); break;
+  case ID_TEST_FLT: this->emit(CALC_OP_TEST_FLT, dst, a); break;
+  case ID_TEST_VEC: this->emit(CALC_OP_TEST_VEC, dst, a); break;
+  case ID_DOT: this->emit(CALC_OP_DOT, dst, a, b); break;
+  case ID_LEN: this->emit(CALC_OP_LEN, dst, a); break;
+  case ID_COS: this->emitFunc1(calc_cos, dst, a); break;
+  case ID_SIN: this->emitFunc1(calc_sin, dst, a); break;
+  case ID_TAN: this->emitFunc1(calc_tan, dst, a); break;
+  case ID_ACOS: this->emitFunc1(calc_acos, dst, a); break;
+  case ID_ASIN: this->emitFunc1(calc_asin, dst, a); break;
+  case ID_ATAN: this->emitFunc1(calc_atan, dst, a); break;
+  case ID_COSH: this->emitFunc1(calc_cosh, dst, a); break;
+  case ID_SINH: this->emitFunc1(calc_sinh, dst, a); break;
+  case ID_TANH: this->emitFunc1(calc_tanh, dst, a); break;
+  case ID_SQRT: this->emitFunc1(calc_sqrt, dst, a); break;
+  case ID_EXP: this->emitFunc1(calc_exp, dst, a); break;
+  case ID_LOG: this->emitFunc1(calc_log, dst, a); break;
+  case ID_LOG10: this->emitFunc1(calc_log10, dst, a); break;
+  case ID_CEIL: this->emitFunc1(calc_ceil, dst, a); break;
+  case ID_FLOOR: this->emitFunc1(calc_floor, dst, a); break;
+  case ID_FABS: this->emitFunc1(calc_fabs, dst, a); break;
+  case ID_FMOD: this->emitFunc2(calc_fmod, dst, a, b); break;
+  case ID_ATAN2: this->emitFunc2(calc_atan2, dst, a, b); break;
+  case ID_POW: this->emitFunc2(calc_pow, dst, a, b); break;
+  default:
+    assert(0 && "unknown node id");
+    this->failed = TRUE;
+    break;
+  }
+  return dst;
+}
+
+// Runs the program on the first num elements of the registers.
+void
+SoCalculatorProgram::execute(const int num)
+{
+  const int numinstr = this->code.getLength();
+  const calc_instruction * instr = this->code.getArrayPtr();
+  for (int pc = 0; pc < numinstr; pc++, instr++) {
+    float * d = this->reg(instr->dst);
+    const float * a = instr->a >= 0 ? this->reg(instr->a) : NULL;
+    const float * b = instr->b >= 0 ? this->reg(instr->b) : NULL;
+    const float * c = instr->c >= 0 ? this->reg(instr->c) : NULL;
+    int i;
+
+    switch (instr->op) {
+    case CALC_OP_CONST:
+      for (i = 0; i < num; i++) d[i] = instr->value;
+      break;
+    case CALC_OP_MOV:
+      for (i = 0; i < num; i++) d[i] = a[i];
+      break;
+    case CALC_OP_ADD:
+      for (i = 0; i < num; i++) d[i] = a[i] + b[i];
+      break;
+    case CALC_OP_SUB:
+      for (i = 0; i < num; i++) d[i] = a[i] - b[i];
+      break;
+    case CALC_OP_MUL:
+      for (i = 0; i < num; i++) d[i] = a[i] * b[i];
+      break;
+    case CALC_OP_DIV:
+      for (i = 0; i < num; i++) d[i] = a[i] / (b[i] == 0.0f ? FLT_EPSILON : b[i]);
+      break;
+    case CALC_OP_NEG:
+      for (i = 0; i < num; i++) d[i] = - a[i];
+      break;
+    case CALC_OP_AND:
+      for (i = 0; i < num; i++) d[i] = (a[i] != 0.0f && b[i] != 0.0f) ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_OR:
+      for (i = 0; i < num; i++) d[i] = (a[i] != 0.0f || b[i] != 0.0f) ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_NOT:
+      for (i = 0; i < num; i++) d[i] = a[i] == 0.0f ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_LEQ:
+      for (i = 0; i < num; i++) d[i] = a[i] <= b[i] ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_GEQ:
+      for (i = 0; i < num; i++) d[i] = a[i] >= b[i] ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_EQ:
+      for (i = 0; i < num; i++) d[i] = a[i] == b[i] ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_NEQ:
+      for (i = 0; i < num; i++) d[i] = a[i] != b[i] ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_LT:
+      for (i = 0; i < num; i++) d[i] = a[i] < b[i] ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_GT:
+      for (i = 0; i < num; i++) d[i] = a[i] > b[i] ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_TEST_FLT:
+      for (i = 0; i < num; i++) d[i] = a[i] != 0.0f ? 1.0f : 0.0f;
+      break;
+    case CALC_OP_TEST_VEC:
+      {
+        const float * a1 = a + CALC_BLOCKSIZE;
+        const float * a2 = a1 + CALC_BLOCKSIZE;
+        for (i = 0; i < num; i++) {
+          d[i] = (a[i] != 0.0f || a1[i] != 0.0f || a2[i] != 0.0f) ? 1.0f : 0.0f;
+        }
+      }
+      break;
+    case CALC_OP_SELECT:
+      for (i = 0; i < num; i++) d[i] = c[i] != 0.0f ? a[i] : b[i];
+      break;
+    case CALC_OP_FUNC1:
+      for (i = 0; i < num; i++) d[i] = instr->func1(a[i]);
+      break;
+    case CALC_OP_FUNC2:
+      for (i = 0; i < num; i++) d[i] = instr->func2(a[i], b[i]);
+      break;
+    case CALC_OP_RAND:
+      for (i = 0; i < num; i++) {
+        d[i] = (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)) * a[i];
+      }
+      break;
+    case CALC_OP_DOT:
+    case CALC_OP_LEN:
+      {
+        const float * a1 = a + CALC_BLOCKSIZE;
+        const float * a2 = a1 + CALC_BLOCKSIZE;
+        if (instr->op == CALC_OP_LEN) b = a;
+        const float * b1 = b + CALC_BLOCKSIZE;
+        const float * b2 = b1 + CALC_BLOCKSIZE;
+        for (i = 0; i < num; i++) d[i] = a[i] * b[i] + a1[i] * b1[i] + a2[i] * b2[i];
+        if (instr->op == CALC_OP_LEN) {
+          for (i = 0; i < num; i++) d[i] = static_cast<float>(sqrt(double(d[i])));
+        }
+      }
+      break;
+    case CALC_OP_CROSS:
+      {
+        const float * a1 = a + CALC_BLOCKSIZE;
+        const float * a2 = a1 + CALC_BLOCKSIZE;
+        const float * b1 = b + CALC_BLOCKSIZE;
+        const float * b2 = b1 + CALC_BLOCKSIZE;
+        float * d1 = d + CALC_BLOCKSIZE;
+        float * d2 = d1 + CALC_BLOCKSIZE;
+        for (i = 0; i < num; i++) {
+          d[i] = a1[i] * b2[i] - a2[i] * b1[i];
+          d1[i] = a2[i] * b[i] - a[i] * b2[i];
+          d2[i] = a[i] * b1[i] - a1[i] * b[i];
+        }
+      }
+      break;
+    case CALC_OP_NORMALIZE:
+      {
+        const float * a1 = a + CALC_BLOCKSIZE;
+        const float * a2 = a1 + CALC_BLOCKSIZE;
+        float * d1 = d + CALC_BLOCKSIZE;
+        float * d2 = d1 + CALC_BLOCKSIZE;
+        for (i = 0; i < num; i++) {
+          const float len =
+            static_cast<float>(sqrt(double(a[i] * a[i] + a1[i] * a1[i] + a2[i] * a2[i])));
+          if (len > 0.0f) {
+            d[i] = a[i] / len;
+            d1[i] = a1[i] / len;
+            d2[i] = a2[i] / len;
+          }
+          else {
+            d[i] = d1[i] = d2[i] = 0.0f;
+          }
+        }
+      }
+      break;
+    default:
+      assert(0 && "unknown instruction");
+      break;
+    }
+  }
+}
+
+} // anonymous namespace
+
+// *************************************************************************
+
 class SoCalculatorP {
 public:
   float ta_th[8];
@@ -330,6 +914,10 @@ public:
   float oa_od[4];
   SbVec3f oA_oD[4];
   SbList <struct so_eval_node*> evaluatorList;
+
+  SoCalculatorProgram program;
+  SbBool compiled;
+  void evaluateProgram(SoCalculator * calc);
 };
 
 #define PRIVATE(thisp) (thisp->pimpl)
@@ -379,6 +967,7 @@ SoCalculator::SoCalculator(void)
     PRIVATE(this)->ta_th[i] = 0.0f;
     PRIVATE(this)->tA_tH[i].setValue(0.0f, 0.0f, 0.0f);
   }
+  PRIVATE(this)->compiled = FALSE;
 }
 
 /*!
@@ -424,8 +1013,17 @@ SoCalculator::evaluate(void)
       }
       else PRIVATE(this)->evaluatorList.append(NULL);
     }
+    // COIN_CALCULATOR_NO_COMPILE forces the tree evaluator, for
+    // debugging and for comparing the two.
+    const char * env = coin_getenv("COIN_CALCULATOR_NO_COMPILE");
+    PRIVATE(this)->compiled = (!env || atoi(env) == 0) &&
+      PRIVATE(this)->program.compile(PRIVATE(this)->evaluatorList);
   }
 
+  if (PRIVATE(this)->compiled) {
+    PRIVATE(this)->evaluateProgram(this);
+    return;
+  }
 
   // find all fields used in all expressions
   int maxnum = 0;
@@ -487,6 +1085,120 @@ SoCalculator::evaluate(void)
   }
 }
 
+// Evaluates the compiled expressions for all elements of the input
+// fields, a block of elements at a time.
+void
+SoCalculatorP::evaluateProgram(SoCalculator * calc)
+{
+  SoMFFloat * const fltin[8] = {
+    &calc->a, &calc->b, &calc->c, &calc->d, &calc->e, &calc->f, &calc->g, &calc->h
+  };
+  SoMFVec3f * const vecin[8] = {
+    &calc->A, &calc->B, &calc->C, &calc->D, &calc->E, &calc->F, &calc->G, &calc->H
+  };
+  SoEngineOutput * const fltout[4] = { &calc->oa, &calc->ob, &calc->oc, &calc->od };
+  SoEngineOutput * const vecout[4] = { &calc->oA, &calc->oB, &calc->oC, &calc->oD };
+  SoCalculatorProgram & prog = this->program;
+  int i, j, k;
+
+  // find max number of values in used input fields
+  int maxnum = 0;
+  for (i = 0; i < 8; i++) {
+    if (prog.inused[i]) maxnum = SbMax(maxnum, fltin[i]->getNum());
+    if (prog.inused[i+8]) maxnum = SbMax(maxnum, vecin[i]->getNum());
+  }
+  if (maxnum == 0) maxnum = 1; // in case only temporary registers were used
+
+  for (i = 0; i < 4; i++) {
+    if (prog.outused[i]) { SO_ENGINE_OUTPUT((*fltout[i]), SoMFFloat, setNum(maxnum)); }
+    if (prog.outused[i+4]) { SO_ENGINE_OUTPUT((*vecout[i]), SoMFVec3f, setNum(maxnum)); }
+  }
+
+  const int blocksize = prog.serial ? 1 : CALC_BLOCKSIZE;
+  SbVec3f vecbuf[CALC_BLOCKSIZE];
+
+  for (int start = 0; start < maxnum; start += blocksize) {
+    const int num = SbMin(blocksize, maxnum - start);
+
+    // copy values from input fields to registers. Fields with fewer
+    // values than maxnum repeat their last value.
+    for (i = 0; i < 8; i++) {
+      if (prog.inused[i]) {
+        const int fieldnum = fltin[i]->getNum();
+        const float * src = fltin[i]->getValues(0);
+        float * r = prog.reg(CALC_REG_IN_FLT + i);
+        if (start + num <= fieldnum) {
+          memcpy(r, src + start, num * sizeof(float));
+        }
+        else {
+          for (k = 0; k < num; k++) {
+            r[k] = fieldnum ? src[SbMin(start + k, fieldnum - 1)] : 0.0f;
+          }
+        }
+      }
+      if (prog.inused[i+8]) {
+        const int fieldnum = vecin[i]->getNum();
+        const SbVec3f * src = vecin[i]->getValues(0);
+        for (j = 0; j < 3; j++) {
+          float * r = prog.reg(CALC_REG_IN_VEC + 3 * i + j);
+          for (k = 0; k < num; k++) {
+            r[k] = fieldnum ? src[SbMin(start + k, fieldnum - 1)][j] : 0.0f;
+          }
+        }
+      }
+    }
+
+    // temporary registers keep their values from the previous element
+    for (i = 0; i < 8; i++) {
+      if (prog.tmpused[i]) {
+        float * r = prog.reg(CALC_REG_TMP_FLT + i);
+        for (k = 0; k < num; k++) r[k] = this->ta_th[i];
+      }
+      if (prog.tmpused[i+8]) {
+        for (j = 0; j < 3; j++) {
+          float * r = prog.reg(CALC_REG_TMP_VEC + 3 * i + j);
+          for (k = 0; k < num; k++) r[k] = this->tA_tH[i][j];
+        }
+      }
+    }
+
+    // output registers start out as zero for each element (in case an
+    // expression reads from an output before setting its value)
+    for (i = CALC_REG_OUT_FLT; i < CALC_REG_SCRATCH; i++) {
+      float * r = prog.reg(i);
+      for (k = 0; k < num; k++) r[k] = 0.0f;
+    }
+
+    prog.execute(num);
+
+    for (i = 0; i < 8; i++) {
+      if (prog.tmpused[i]) {
+        this->ta_th[i] = prog.reg(CALC_REG_TMP_FLT + i)[num - 1];
+      }
+      if (prog.tmpused[i+8]) {
+        for (j = 0; j < 3; j++) {
+          this->tA_tH[i][j] = prog.reg(CALC_REG_TMP_VEC + 3 * i + j)[num - 1];
+        }
+      }
+    }
+
+    // copy the output values from registers to engine outputs
+    for (i = 0; i < 4; i++) {
+      if (prog.outused[i]) {
+        const float * r = prog.reg(CALC_REG_OUT_FLT + i);
+        SO_ENGINE_OUTPUT((*fltout[i]), SoMFFloat, setValues(start, num, r));
+      }
+      if (prog.outused[i+4]) {
+        const float * r0 = prog.reg(CALC_REG_OUT_VEC + 3 * i);
+        const float * r1 = r0 + CALC_BLOCKSIZE;
+        const float * r2 = r1 + CALC_BLOCKSIZE;
+        for (k = 0; k < num; k++) vecbuf[k].setValue(r0[k], r1[k], r2[k]);
+        SO_ENGINE_OUTPUT((*vecout[i]), SoMFVec3f, setValues(start, num, vecbuf));
+      }
+    }
+  }
+}
+
 // "extern C" wrapper and C-function typedefs are needed with the
 // OSF1/cxx compiler (probably a bug in the compiler, but it doesn't
 // seem to hurt to do this anyway).
@@ -713,3 +1425,133 @@ SoCalculator::writefieldcb(const char *fieldname, float *data,
 
 #undef THISP
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <cstring>
+
+// Runs the expressions through an SoCalculator, and returns the
+// values of all the outputs.
+static void
+run_calculator(const char ** expressions, const int numexpressions,
+               const SbBool compile,
+               SoMFFloat fltout[4], SoMFVec3f vecout[4])
+{
+  if (compile) coin_unsetenv("COIN_CALCULATOR_NO_COMPILE");
+  else coin_setenv("COIN_CALCULATOR_NO_COMPILE", "1", TRUE);
+
+  SoCalculator * calc = new SoCalculator;
+  calc->ref();
+
+  // uneven input lengths, spanning several blocks of elements
+  int i;
+  for (i = 0; i < 150; i++) {
+    const float x = float(i) / 37.0f - 2.0f;
+    calc->a.set1Value(i, x);
+    if (i < 97) calc->b.set1Value(i, float(i % 11) * 0.25f - 1.0f);
+    if (i < 130) calc->A.set1Value(i, SbVec3f(x, 0.5f - x * x, float(i % 5)));
+  }
+  calc->c.setValue(0.75f);
+  calc->B.setValue(SbVec3f(1.0f, -2.0f, 0.5f));
+  calc->C.setValue(SbVec3f(0.0f, 0.0f, 0.0f));
+  calc->expression.setValues(0, numexpressions, expressions);
+
+  SoEngineOutput * const outputs[8] = {
+    &calc->oa, &calc->ob, &calc->oc, &calc->od,
+    &calc->oA, &calc->oB, &calc->oC, &calc->oD
+  };
+  for (i = 0; i < 4; i++) {
+    fltout[i].connectFrom(outputs[i]);
+    vecout[i].connectFrom(outputs[i + 4]);
+  }
+  for (i = 0; i < 4; i++) {
+    (void) fltout[i].getNum();
+    (void) vecout[i].getNum();
+    fltout[i].disconnect();
+    vecout[i].disconnect();
+  }
+  calc->unref();
+  coin_unsetenv("COIN_CALCULATOR_NO_COMPILE");
+}
+
+// Checks that the compiled expressions give the same output as the
+// expression tree evaluator, bit for bit.
+static void
+check_calculator(const char ** expressions, const int numexpressions)
+{
+  SoMFFloat fltcompiled[4], flttree[4];
+  SoMFVec3f veccompiled[4], vectree[4];
+  run_calculator(expressions, numexpressions, TRUE, fltcompiled, veccompiled);
+  run_calculator(expressions, numexpressions, FALSE, flttree, vectree);
+  BOOST_REQUIRE_EQUAL(fltcompiled[0].getNum(), 150);
+
+  for (int i = 0; i < 4; i++) {
+    BOOST_CHECK_EQUAL(fltcompiled[i].getNum(), flttree[i].getNum());
+    BOOST_CHECK_EQUAL(veccompiled[i].getNum(), vectree[i].getNum());
+    if (fltcompiled[i].getNum() == flttree[i].getNum()) {
+      BOOST_CHECK_MESSAGE(memcmp(fltcompiled[i].getValues(0), flttree[i].getValues(0),
+                                 flttree[i].getNum() * sizeof(float)) == 0,
+                          "float output " << i << " differs for \"" << expressions[0] << "\"");
+    }
+    if (veccompiled[i].getNum() == vectree[i].getNum()) {
+      BOOST_CHECK_MESSAGE(memcmp(veccompiled[i].getValues(0), vectree[i].getValues(0),
+                                 vectree[i].getNum() * sizeof(SbVec3f)) == 0,
+                          "vector output " << i << " differs for \"" << expressions[0] << "\"");
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compiledMatchesTree)
+{
+  static const char * scalar[] = {
+    "oa = a + b * c - a / b",
+    "ob = a > b ? sin(a) * b : cos(b) - a",
+    "oc = (a <= 0.5 && b != 0) || !(c == 1) ? fmod(a, b) : atan2(a, c)",
+    "od = a >= b ? (a < 0 ? -a : a) : (b > 1 ? MAXFLOAT : M_PI)"
+  };
+  check_calculator(scalar, 4);
+
+  static const char * functions[] = {
+    "oa = pow(fabs(a), b) + sqrt(a) + exp(-a) + log(b) + log10(a)",
+    "ob = tan(a) + acos(b) + asin(a) + atan(b) + cosh(a) + sinh(b) + tanh(a)",
+    "oc = ceil(a * 3) + floor(b * 3) + fmod(b, a) + atan2(b, a)",
+    "od = M_E * M_LOG2E + M_LOG10E + M_LN2 + M_SQRT2 - M_SQRT1_2 + MINFLOAT"
+  };
+  check_calculator(functions, 4);
+
+  static const char * vectors[] = {
+    "oA = cross(A, B) + normalize(C) * dot(A, B) + normalize(A) / a",
+    "oa = length(A - B); ob = A[0] + B[1] * C[2]",
+    "oB = vec3f(A[2], B[0], a); oB[1] = oA[0] * 2",
+    "oC = a > 0.5 ? A : -B; oc = (oC[1] > 0) ? length(oC) : dot(oC, A)",
+    "oD = A ? B * 2 : C; od = C ? 1 : 2"
+  };
+  check_calculator(vectors, 5);
+
+  // temporaries which are read before they are written carry their
+  // value over from the previous element
+  static const char * temporaries[] = {
+    "ta = a * 2; tb = tb + ta; tc = ta > 1 ? tb : -tb; td = tc - td",
+    "te = te * 0.5 + b; tf = sin(te); tg = tg + tf; th = th + 1",
+    "tA = A + vec3f(ta, tb, 0); tB = tB + tA; tC[1] = a; tC[2] = tC[2] + b",
+    "tD = cross(tA, B); tE = tE + tD * 0.125; tF = normalize(tE)",
+    "tG = a > 0 ? tG + A : tG - A; tH = tH + vec3f(th, tg, tf)",
+    "oa = ta + tb + tc + td; ob = te + tf + tg + th; oc = tA[0] + tC[1]",
+    "oA = tA + tB; oB = tC + tD; oC = tE + tF; oD = tG + tH"
+  };
+  check_calculator(temporaries, 7);
+
+  // outputs can be read, and are reset for each element
+  static const char * outputs[] = {
+    "ob = oa + a; oa = b",
+    "oc = oa * ob; od = od + 1",
+    "oB = oA + A; oA = B; oA[2] = oD[0]"
+  };
+  check_calculator(outputs, 3);
+}
+
+#endif // COIN_TEST_SUITE
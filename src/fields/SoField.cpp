@@ -143,6 +143,7 @@ inline unsigned int SbHashFunc(const void * key)
 {
   return SbHashFunc(reinterpret_cast<size_t>(key));
 }
+#include "misc/SoDBP.h"
 #include "coindefs.h" // COIN_STUB()
 
 #ifdef COIN_THREADSAFE
@@ -556,6 +557,9 @@ SoField::~SoField()
   // disconnecting connections.
   this->setStatusBits(FLAG_ISDESTRUCTING);
 
+  // Make sure a pending change in an SoDB transaction is dropped.
+  SoDBP::forgetFieldChange(this);
+
 #if COIN_DEBUG_EXTRA
   int wLevel =
     SoConfigSettings::getInstance()->settingAsInt("COIN_WARNING_LEVEL");
@@ -1434,10 +1438,17 @@ SoField::touch(void)
 
   At the end of a notification sequence, all "immediate" sensors
   (i.e. sensors set up with a zero priority) are triggered.
+
+  If an SoDB transaction is open, the notification is postponed until
+  the transaction is committed.
+
+  \sa SoDB::beginTransaction()
 */
 void
 SoField::startNotify(void)
 {
+  if (SoDBP::recordFieldChange(this)) return;
+
   SoNotList l;
 #if COIN_DEBUG_EXTRA
   int wLevel =
@@ -62,7 +62,7 @@
 
 // *************************************************************************
 
-SO_MFIELD_SOURCE(SoMFColor, SbColor, const SbColor &);
+SO_MFIELD_SOURCE_MALLOC(SoMFColor, SbColor, const SbColor &);
 
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFColor, SbColor, float);
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFColor, SbColor, SbColor);
@@ -107,6 +107,7 @@ SoMFColor::write1Value(SoOutput * out, int idx) const
 void
 SoMFColor::setValues(int start, int numarg, const float rgb[][3])
 {
+  this->unshareValues();
   if(start+numarg > this->maxNum) this->makeRoom(start+numarg);
   else if(start+numarg > this->num) this->num = start+numarg;
 
@@ -120,6 +121,7 @@ SoMFColor::setValues(int start, int numarg, const float rgb[][3])
 void
 SoMFColor::setHSVValues(int start, int numarg, const float hsv[][3])
 {
+  this->unshareValues();
   if(start+numarg > this->maxNum) this->makeRoom(start+numarg);
   else if(start+numarg > this->num) this->num = start+numarg;
 
@@ -93,6 +93,16 @@ SoMFFloat::write1Value(SoOutput * out, int idx) const
   sosffloat_write_value(out, (*this)[idx]);
 }
 
+// Read all values in one go instead of one value at a time through
+// read1Value(), as large binary files are dominated by these fields.
+SbBool
+SoMFFloat::readBinaryValues(SoInput * in, int numarg)
+{
+  assert(numarg <= this->maxNum);
+  if (numarg == 0) return TRUE;
+  return sosffloat_read_binary_values(in, this->values, numarg);
+}
+
 #endif // DOXYGEN_SKIP_THIS
 
 
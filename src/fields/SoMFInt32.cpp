@@ -96,6 +96,17 @@ SoMFInt32::write1Value(SoOutput * out, int idx) const
   sosfint32_write_value(out, (*this)[idx]);
 }
 
+// Read all values in one go instead of one value at a time through
+// read1Value(), as large binary files are dominated by these fields.
+SbBool
+SoMFInt32::readBinaryValues(SoInput * in, int numarg)
+{
+  assert(in->isBinary());
+  assert(numarg <= this->maxNum);
+  if (numarg == 0) return TRUE;
+  return in->readBinaryArray(this->values, numarg);
+}
+
 #endif // DOXYGEN_SKIP_THIS
 
 
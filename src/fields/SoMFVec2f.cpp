@@ -60,7 +60,7 @@
 
 // *************************************************************************
 
-SO_MFIELD_SOURCE(SoMFVec2f, SbVec2f, const SbVec2f &);
+SO_MFIELD_SOURCE_MALLOC(SoMFVec2f, SbVec2f, const SbVec2f &);
 
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFVec2f, SbVec2f, SbVec2f);
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFVec2f, SbVec2f, float);
@@ -98,6 +98,17 @@ SoMFVec2f::write1Value(SoOutput * out, int idx) const
   sosfvec2f_write_value(out, (*this)[idx]);
 }
 
+// Read all values in one go instead of one value at a time through
+// read1Value(), as large binary files are dominated by these fields.
+SbBool
+SoMFVec2f::readBinaryValues(SoInput * in, int numarg)
+{
+  assert(numarg <= this->maxNum);
+  assert(sizeof(SbVec2f) == 2 * sizeof(float));
+  if (numarg == 0) return TRUE;
+  return sosffloat_read_binary_values(in, &this->values[0][0], numarg * 2);
+}
+
 #endif // DOXYGEN_SKIP_THIS
 
 // *************************************************************************
@@ -109,6 +120,7 @@ SoMFVec2f::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec2f::setValues(int start, int numarg, const float xy[][2])
 {
+  this->unshareValues();
   if (start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if (start+numarg > this->num) this->num = start+numarg;
 
@@ -60,7 +60,7 @@
 
 // *************************************************************************
 
-SO_MFIELD_SOURCE(SoMFVec3f, SbVec3f, const SbVec3f &);
+SO_MFIELD_SOURCE_MALLOC(SoMFVec3f, SbVec3f, const SbVec3f &);
 
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFVec3f, SbVec3f, SbVec3f);
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFVec3f, SbVec3f, float);
@@ -104,6 +104,17 @@ SoMFVec3f::write1Value(SoOutput * out, int idx) const
   sosfvec3f_write_value(out, (*this)[idx]);
 }
 
+// Read all values in one go instead of one value at a time through
+// read1Value(), as large binary files are dominated by these fields.
+SbBool
+SoMFVec3f::readBinaryValues(SoInput * in, int numarg)
+{
+  assert(numarg <= this->maxNum);
+  assert(sizeof(SbVec3f) == 3 * sizeof(float));
+  if (numarg == 0) return TRUE;
+  return sosffloat_read_binary_values(in, &this->values[0][0], numarg * 3);
+}
+
 #endif // DOXYGEN_SKIP_THIS
 
 // *************************************************************************
@@ -120,6 +131,7 @@ SoMFVec3f::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec3f::setValues(int start, int numarg, const float xyz[][3])
 {
+  this->unshareValues();
   if (start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if (start+numarg > this->num) this->num = start+numarg;
 
@@ -178,4 +190,197 @@ BOOST_AUTO_TEST_CASE(initialized)
   BOOST_CHECK_EQUAL(field.getNum(), 0);
 }
 
+#include <cstdlib>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+// check that values survive a write/read cycle through the binary
+// file format, which reads all values of the field in one go
+BOOST_AUTO_TEST_CASE(binaryReadWrite)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  root->addChild(coords);
+  const int num = 1000;
+  for (int i = 0; i < num; i++) {
+    coords->point.set1Value(i, SbVec3f(float(i), -0.5f * i, 1.0f / (i + 1)));
+  }
+
+  SoOutput out;
+  out.setBinary(TRUE);
+  out.setBuffer(malloc(1024), 1024, realloc);
+  SoWriteAction wa(&out);
+  wa.apply(root);
+  void * buffer;
+  size_t size;
+  BOOST_REQUIRE(out.getBuffer(buffer, size));
+
+  SoInput in;
+  in.setBuffer(buffer, size);
+  SoSeparator * read = SoDB::readAll(&in);
+  BOOST_REQUIRE(read);
+  read->ref();
+  BOOST_REQUIRE(read->getNumChildren() == 1);
+  BOOST_REQUIRE(read->getChild(0)->isOfType(SoCoordinate3::getClassTypeId()));
+
+  const SoMFVec3f & points = static_cast<SoCoordinate3 *>(read->getChild(0))->point;
+  BOOST_CHECK_EQUAL(points.getNum(), num);
+  BOOST_CHECK_MESSAGE(points == coords->point,
+                      "values differ after binary write/read cycle");
+
+  read->unref();
+  root->unref();
+  free(buffer);
+}
+
+// check that copies don't share the value array unless sharing has
+// been enabled
+BOOST_AUTO_TEST_CASE(copyWithoutSharing)
+{
+  const SbBool sharing = SoMField::isValueSharing();
+  SoMField::setValueSharing(FALSE);
+
+  SoMFVec3f original;
+  original.set1Value(0, SbVec3f(1.0f, 2.0f, 3.0f));
+  SoMFVec3f copy;
+  copy = original;
+  BOOST_CHECK(copy.getValues(0) != original.getValues(0));
+  BOOST_CHECK(copy == original);
+
+  SoMField::setValueSharing(sharing);
+}
+
+// check that copies share the value array until one of them is
+// written to
+BOOST_AUTO_TEST_CASE(copyOnWrite)
+{
+  const SbBool sharing = SoMField::isValueSharing();
+  SoMField::setValueSharing(TRUE);
+
+  SoMFVec3f original;
+  const int num = 100;
+  for (int i = 0; i < num; i++) original.set1Value(i, SbVec3f(float(i), 0.0f, 0.0f));
+
+  SoMFVec3f copy, secondcopy;
+  copy = original;
+  secondcopy.copyFrom(copy);
+  BOOST_CHECK_EQUAL(copy.getNum(), num);
+  BOOST_CHECK(copy.getValues(0) == original.getValues(0));
+  BOOST_CHECK(secondcopy.getValues(0) == original.getValues(0));
+
+  copy.set1Value(10, SbVec3f(-1.0f, -1.0f, -1.0f));
+  BOOST_CHECK(copy.getValues(0) != original.getValues(0));
+  BOOST_CHECK(secondcopy.getValues(0) == original.getValues(0));
+  BOOST_CHECK(copy[10] == SbVec3f(-1.0f, -1.0f, -1.0f));
+  BOOST_CHECK(original[10] == SbVec3f(10.0f, 0.0f, 0.0f));
+  BOOST_CHECK(secondcopy[10] == SbVec3f(10.0f, 0.0f, 0.0f));
+
+  SbVec3f * values = original.startEditing();
+  values[20] = SbVec3f(2.0f, 2.0f, 2.0f);
+  original.finishEditing();
+  BOOST_CHECK(secondcopy[20] == SbVec3f(20.0f, 0.0f, 0.0f));
+
+  secondcopy.setNum(50);
+  BOOST_CHECK_EQUAL(secondcopy.getNum(), 50);
+  BOOST_CHECK_EQUAL(original.getNum(), num);
+  BOOST_CHECK(original[20] == SbVec3f(2.0f, 2.0f, 2.0f));
+  BOOST_CHECK(original[num - 1] == SbVec3f(float(num - 1), 0.0f, 0.0f));
+
+  SoMField::setValueSharing(sharing);
+}
+
+// check that destroying copies in any order leaves the others intact
+BOOST_AUTO_TEST_CASE(copyOnWriteDestruct)
+{
+  const SbBool sharing = SoMField::isValueSharing();
+  SoMField::setValueSharing(TRUE);
+
+  const int num = 100;
+  SoMFVec3f * original = new SoMFVec3f;
+  for (int i = 0; i < num; i++) original->set1Value(i, SbVec3f(float(i), 1.0f, 2.0f));
+  const SbVec3f * values = original->getValues(0);
+
+  SoMFVec3f * copies[3];
+  for (int i = 0; i < 3; i++) {
+    copies[i] = new SoMFVec3f;
+    *copies[i] = *original;
+    BOOST_CHECK(copies[i]->getValues(0) == values);
+  }
+
+  delete copies[1];
+  delete original;
+  BOOST_CHECK(copies[0]->getValues(0) == values);
+  BOOST_CHECK(copies[2]->getValues(0) == values);
+  BOOST_CHECK(copies[0]->getNum() == num);
+  BOOST_CHECK((*copies[0])[num - 1] == SbVec3f(float(num - 1), 1.0f, 2.0f));
+
+  delete copies[0];
+  // the last copy owns the array now, so writing to it should not
+  // copy it
+  copies[2]->set1Value(5, SbVec3f(-5.0f, 0.0f, 0.0f));
+  BOOST_CHECK(copies[2]->getValues(0) == values);
+  BOOST_CHECK((*copies[2])[5] == SbVec3f(-5.0f, 0.0f, 0.0f));
+  BOOST_CHECK((*copies[2])[6] == SbVec3f(6.0f, 1.0f, 2.0f));
+  delete copies[2];
+
+  SoMField::setValueSharing(sharing);
+}
+
+// check setNum() and deleteValues() on shared arrays
+BOOST_AUTO_TEST_CASE(copyOnWriteResize)
+{
+  const SbBool sharing = SoMField::isValueSharing();
+  SoMField::setValueSharing(TRUE);
+
+  const int num = 100;
+  SoMFVec3f original;
+  for (int i = 0; i < num; i++) original.set1Value(i, SbVec3f(float(i), 0.0f, 0.0f));
+  const SbVec3f * values = original.getValues(0);
+
+  SoMFVec3f copy, secondcopy, thirdcopy;
+  copy = original;
+  secondcopy = original;
+  thirdcopy = original;
+
+  // truncating should not copy the array
+  copy.setNum(10);
+  BOOST_CHECK_EQUAL(copy.getNum(), 10);
+  BOOST_CHECK(copy.getValues(0) == values);
+  secondcopy.deleteValues(40);
+  BOOST_CHECK_EQUAL(secondcopy.getNum(), 40);
+  BOOST_CHECK(secondcopy.getValues(0) == values);
+  BOOST_CHECK_EQUAL(original.getNum(), num);
+  BOOST_CHECK(original[num - 1] == SbVec3f(float(num - 1), 0.0f, 0.0f));
+
+  // growing a truncated copy must not touch the other fields
+  copy.setNum(20);
+  BOOST_CHECK(copy.getValues(0) != values);
+  BOOST_CHECK(copy[9] == SbVec3f(9.0f, 0.0f, 0.0f));
+  BOOST_CHECK(original[15] == SbVec3f(15.0f, 0.0f, 0.0f));
+
+  // deleting from the middle moves values, so the array is copied
+  secondcopy.deleteValues(0, 5);
+  BOOST_CHECK(secondcopy.getValues(0) != values);
+  BOOST_CHECK_EQUAL(secondcopy.getNum(), 35);
+  BOOST_CHECK(secondcopy[0] == SbVec3f(5.0f, 0.0f, 0.0f));
+  BOOST_CHECK(original[0] == SbVec3f(0.0f, 0.0f, 0.0f));
+
+  thirdcopy.setNum(0);
+  BOOST_CHECK_EQUAL(thirdcopy.getNum(), 0);
+  BOOST_CHECK(original.getValues(0) == values);
+  BOOST_CHECK_EQUAL(original.getNum(), num);
+  BOOST_CHECK(original[50] == SbVec3f(50.0f, 0.0f, 0.0f));
+
+  // the original is the last user of the array, and takes it over
+  original.set1Value(0, SbVec3f(1.0f, 1.0f, 1.0f));
+  BOOST_CHECK(original.getValues(0) == values);
+
+  SoMField::setValueSharing(sharing);
+}
+
 #endif // COIN_TEST_SUITE
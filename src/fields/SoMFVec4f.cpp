@@ -60,7 +60,7 @@
 
 // *************************************************************************
 
-SO_MFIELD_SOURCE(SoMFVec4f, SbVec4f, const SbVec4f &);
+SO_MFIELD_SOURCE_MALLOC(SoMFVec4f, SbVec4f, const SbVec4f &);
 
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFVec4f, SbVec4f, SbVec4f);
 SO_MFIELD_SETVALUESPOINTER_SOURCE(SoMFVec4f, SbVec4f, float);
@@ -111,6 +111,7 @@ SoMFVec4f::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec4f::setValues(int start, int numarg, const float xyzw[][4])
 {
+  this->unshareValues();
   if(start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if(start+numarg > this->num) this->num = start+numarg;
 
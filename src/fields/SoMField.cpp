@@ -256,6 +256,7 @@
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
 #include "coindefs.h" // COIN_WORKAROUND_*
+#include "misc/SbHash.h"
 
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
 using std::memcpy;
@@ -292,10 +293,71 @@ SoType SoMField::classTypeId STATIC_SOTYPE_INIT;
 // need one static mutex for field_buffer in SoMField::get1(SbString &)
 static void * somfield_mutex = NULL;
 
+// Value arrays shared between fields (see SoMField::shareValues())
+// are reference counted in somfield_sharedvalues, keyed on the array
+// address. The fields pointing to such an array are kept in
+// somfield_sharingfields, keyed on the field address, so the sharing
+// state doesn't show through SoMField::userDataIsUsed.
+static void * somfield_sharedmutex = NULL;
+static SbHash<size_t, int> * somfield_sharedvalues = NULL;
+static SbHash<size_t, void *> * somfield_sharingfields = NULL;
+static SbBool somfield_sharingenabled = FALSE;
+
 static void
 somfield_mutex_cleanup(void)
 {
   CC_MUTEX_DESTRUCT(somfield_mutex);
+  CC_MUTEX_DESTRUCT(somfield_sharedmutex);
+  delete somfield_sharedvalues;
+  somfield_sharedvalues = NULL;
+  delete somfield_sharingfields;
+  somfield_sharingfields = NULL;
+}
+
+// Returns TRUE if the field shares its value array with other
+// fields. Must be called with somfield_sharedmutex locked.
+static SbBool
+somfield_is_sharing(const SoMField * field)
+{
+  void * values;
+  return somfield_sharingfields->get(reinterpret_cast<size_t>(field), values);
+}
+
+// Cheap test for the common case of a field which can't be sharing
+// its values, to avoid taking the lock. Note that the number of
+// sharing fields is read without holding the lock while other threads
+// may be sharing or unsharing unrelated fields, so this is a benign
+// race: a stale non-zero count just costs us the lock, and the count
+// can't read as zero while this field itself is sharing, as it was
+// added to the table by shareValues(), which must have completed
+// before anyone writes to the field. This relies on
+// SbHash::getNumElements() being a plain read of an int.
+static SbBool
+somfield_may_be_sharing(const void * values, const SbBool userdataisused)
+{
+  return values != NULL && !userdataisused &&
+    somfield_sharingfields->getNumElements() > 0;
+}
+
+// Makes the field stop sharing its value array, and drops one
+// reference to the array. Returns TRUE if this was the last
+// reference, in which case the field now owns the array. Must be
+// called with somfield_sharedmutex locked.
+static SbBool
+somfield_release_values(const SoMField * field, void * values)
+{
+  const size_t key = reinterpret_cast<size_t>(values);
+  int refcount = 0;
+
+  (void)somfield_sharingfields->erase(reinterpret_cast<size_t>(field));
+  const SbBool found = somfield_sharedvalues->get(key, refcount);
+  assert(found && refcount > 0);
+  if (--refcount == 0) {
+    (void)somfield_sharedvalues->erase(key);
+    return TRUE;
+  }
+  (void)somfield_sharedvalues->put(key, refcount);
+  return FALSE;
 }
 
 // *************************************************************************
@@ -319,7 +381,47 @@ SoMField::initClass(void)
   PRIVATE_FIELD_INIT_CLASS(SoMField, "MField", inherited, NULL);
 
   CC_MUTEX_CONSTRUCT(somfield_mutex);
+  CC_MUTEX_CONSTRUCT(somfield_sharedmutex);
+  somfield_sharedvalues = new SbHash<size_t, int>;
+  somfield_sharingfields = new SbHash<size_t, void *>;
   coin_atexit(somfield_mutex_cleanup, CC_ATEXIT_NORMAL);
+
+  const char * env = coin_getenv("COIN_MFIELD_SHARE_VALUES");
+  somfield_sharingenabled = env && (atoi(env) > 0);
+}
+
+/*!
+  Enable or disable sharing of value arrays between fields through
+  shareValues(). Sharing is disabled by default, unless the
+  environment variable \c COIN_MFIELD_SHARE_VALUES is set to 1.
+
+  Only enable this if all code which writes to multiple-value fields
+  through startEditing() has been compiled against the headers of
+  this version of Coin. Earlier versions of startEditing() were
+  inlined in the application without the call to unshareValues(), and
+  would write straight into arrays shared with other fields.
+
+  Disabling sharing does not affect arrays which are already shared.
+
+  \since Coin 4.0
+  \sa isValueSharing()
+*/
+void
+SoMField::setValueSharing(const SbBool enable)
+{
+  somfield_sharingenabled = enable;
+}
+
+/*!
+  Returns \c TRUE if value arrays may be shared between fields.
+
+  \since Coin 4.0
+  \sa setValueSharing()
+*/
+SbBool
+SoMField::isValueSharing(void)
+{
+  return somfield_sharingenabled;
 }
 
 void
@@ -368,6 +470,7 @@ SoMField::makeRoom(int newnum)
 SbBool
 SoMField::set1(const int index, const char * const valuestring)
 {
+  this->unshareValues();
   int oldnum = this->num;
   // make sure the array has room for the new item
   if (index >= this->maxNum) this->allocValues(index+1);
@@ -470,6 +573,10 @@ SoMField::readValue(SoInput * in)
   // FIXME: temporary disable notification (if on) during reading the
   // field elements. 20000429 mortene.
 
+  // read1Value() and readBinaryValues() write straight into the
+  // value array.
+  this->unshareValues();
+
   // This macro is convenient for reading with error detection.
 #define READ_VAL(val) \
   if (!in->read(val)) { \
@@ -701,6 +808,10 @@ SoMField::deleteValues(int start, int numarg)
   }
 #endif // COIN_DEBUG
 
+  // When just truncating the array, allocValues() can skip copying
+  // a shared array.
+  if (end < oldnum) this->unshareValues();
+
   // Move elements downward to fill the gap.
   for (int i = 0; i < oldnum-(start+numarg); i++)
     this->copyValue(start+i, start+numarg+i);
@@ -795,6 +906,27 @@ SoMField::allocValues(int newnum)
 
   assert(newnum >= 0);
 
+  if (somfield_may_be_sharing(this->valuesPtr(), this->userDataIsUsed)) {
+    CC_MUTEX_LOCK(somfield_sharedmutex);
+    if (somfield_is_sharing(this)) {
+      if (newnum == 0) {
+        // Just let go of the array, the other fields still use it.
+        if (!somfield_release_values(this, this->valuesPtr())) {
+          this->setValuesPtr(NULL);
+          this->maxNum = 0;
+        }
+      }
+      else if (newnum <= this->num) {
+        // The array is truncated, so no values need to be written,
+        // and the array can still be shared.
+        CC_MUTEX_UNLOCK(somfield_sharedmutex);
+        this->num = newnum;
+        return;
+      }
+    }
+    CC_MUTEX_UNLOCK(somfield_sharedmutex);
+  }
+
   if (newnum == 0) {
     if (!this->userDataIsUsed) {
       delete[] static_cast<unsigned char *>(this->valuesPtr());
@@ -803,7 +935,12 @@ SoMField::allocValues(int newnum)
     this->userDataIsUsed = FALSE;
     this->maxNum = 0;
   }
-  else if (newnum > this->maxNum || newnum < this->num) {
+  else {
+    // The caller is about to write to the array.
+    this->unshareValues();
+  }
+
+  if (newnum != 0 && (newnum > this->maxNum || newnum < this->num)) {
     int fsize = this->fieldSizeof();
     if (this->valuesPtr()) {
 
@@ -884,3 +1021,94 @@ SoMField::setChangedIndices(const int chgidx, const int numchgind)
   this->changedIndex = chgidx;
   this->numChangedIndices = numchgind;
 }
+
+/*!
+  Makes this field use the same value array as \a field, instead of
+  copying the values over. The array is reference counted, and
+  either field will get a private copy of it as soon as it is
+  written to (see unshareValues()). This makes copying nodes with
+  large coordinate or index arrays cheap, as only the fields which
+  are subsequently modified will need memory of their own.
+
+  Only fields with plain-old-data values, allocated through
+  SoMField::allocValues(), can share arrays. Assignments between
+  fields declared with SO_MFIELD_SOURCE_MALLOC() use this method
+  automatically.
+
+  Returns \c FALSE if sharing is disabled (see setValueSharing()), or
+  if \a field holds no values or uses an array set through
+  setValuesPointer(). The caller should then copy the values the
+  usual way.
+
+  \since Coin 4.0
+*/
+SbBool
+SoMField::shareValues(const SoMField & field)
+{
+  if (!somfield_sharingenabled) return FALSE;
+
+  field.evaluate();
+
+  SoMField & source = const_cast<SoMField &>(field);
+  void * values = source.valuesPtr();
+  if (values == NULL || source.num == 0 || source.userDataIsUsed) {
+    return FALSE;
+  }
+
+  if (values != this->valuesPtr()) {
+    this->allocValues(0);
+
+    const size_t key = reinterpret_cast<size_t>(values);
+    int refcount = 1;
+    CC_MUTEX_LOCK(somfield_sharedmutex);
+    if (somfield_is_sharing(&source)) {
+      const SbBool found = somfield_sharedvalues->get(key, refcount);
+      assert(found);
+    }
+    else {
+      (void)somfield_sharingfields->put(reinterpret_cast<size_t>(&source), values);
+    }
+    (void)somfield_sharedvalues->put(key, refcount + 1);
+    (void)somfield_sharingfields->put(reinterpret_cast<size_t>(this), values);
+    CC_MUTEX_UNLOCK(somfield_sharedmutex);
+
+    this->setValuesPtr(values);
+    this->maxNum = source.maxNum;
+  }
+  this->num = source.num;
+
+  this->setChangedIndices(0, this->num);
+  this->valueChanged();
+  this->setChangedIndices();
+  return TRUE;
+}
+
+/*!
+  Gives this field a private copy of its value array, if the array is
+  currently shared with other fields through shareValues(). Must be
+  called before writing directly to the array.
+
+  \since Coin 4.0
+*/
+void
+SoMField::unshareValues(void)
+{
+  void * values = this->valuesPtr();
+  if (!somfield_may_be_sharing(values, this->userDataIsUsed)) return;
+
+  // The copy is made while holding the lock, so the last remaining
+  // owner can't take over the array and start writing to it before
+  // we're done reading.
+  CC_MUTEX_LOCK(somfield_sharedmutex);
+  // If we're the only user left, we just take over the array.
+  if (somfield_is_sharing(this) && !somfield_release_values(this, values)) {
+    const size_t fsize = size_t(this->fieldSizeof());
+    const size_t buffersize = size_t(this->maxNum) * fsize;
+    const size_t copysize = size_t(this->num) * fsize;
+    unsigned char * newblock = new unsigned char[buffersize];
+    (void)memcpy(newblock, values, copysize);
+    (void)memset(newblock + copysize, 0, buffersize - copysize);
+    this->setValuesPtr(newblock);
+  }
+  CC_MUTEX_UNLOCK(somfield_sharedmutex);
+}
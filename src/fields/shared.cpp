@@ -146,6 +146,28 @@ sosfbool_write_value(SoOutput * out, SbBool val)
 
 // *************************************************************************
 
+// Read a block of binary format floating point values from input
+// stream in one go. Used from the float-based multiple-value fields,
+// instead of reading each value through SoInput::read(float &). Does
+// the same sanity check on the values as SoInput::read(float &).
+SbBool
+sosffloat_read_binary_values(SoInput * in, float * f, int num)
+{
+  assert(in->isBinary());
+  if (num == 0) return TRUE;
+  if (!in->readBinaryArray(f, num)) return FALSE;
+
+  for (int i = 0; i < num; i++) {
+    if (!coin_finite((double)f[i])) {
+      SoReadError::post(in,
+                        "Detected non-valid floating point number, replacing "
+                        "with 0.0f");
+      f[i] = 0.0f;
+    }
+  }
+  return TRUE;
+}
+
 // Write floating point value to output stream. Used from SoSFFloat
 // and SoMFFloat.
 void
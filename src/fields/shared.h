@@ -67,6 +67,7 @@ class SoOutput;
 SbBool sosfbool_read_value(SoInput * in, SbBool & val);
 void sosfbool_write_value(SoOutput * out, SbBool val);
 
+SbBool sosffloat_read_binary_values(SoInput * in, float * f, int num);
 void sosffloat_write_value(SoOutput * out, float val);
 void sosfdouble_write_value(SoOutput * out, double val);
 
@@ -1943,6 +1943,27 @@ glglue_resolve_symbols(cc_glglue * w)
     }
   }
 
+  /* Multiple render targets with per buffer blend functions. Used
+     for weighted blended order independent transparency. */
+  w->glDrawBuffers = NULL;
+  if (cc_glglue_glversion_matches_at_least(w, 2, 0, 0)) {
+    w->glDrawBuffers = (COIN_PFNGLDRAWBUFFERSPROC)
+      cc_glglue_getprocaddress(w, "glDrawBuffers");
+  }
+  if (!w->glDrawBuffers && cc_glglue_glext_supported(w, "GL_ARB_draw_buffers")) {
+    w->glDrawBuffers = (COIN_PFNGLDRAWBUFFERSPROC)
+      cc_glglue_getprocaddress(w, "glDrawBuffersARB");
+  }
+  w->glBlendFunci = NULL;
+  if (cc_glglue_glversion_matches_at_least(w, 4, 0, 0)) {
+    w->glBlendFunci = (COIN_PFNGLBLENDFUNCIPROC)
+      cc_glglue_getprocaddress(w, "glBlendFunci");
+  }
+  if (!w->glBlendFunci && cc_glglue_glext_supported(w, "GL_ARB_draw_buffers_blend")) {
+    w->glBlendFunci = (COIN_PFNGLBLENDFUNCIPROC)
+      cc_glglue_getprocaddress(w, "glBlendFunciARB");
+  }
+
   /*
      Disable features based on known driver bugs  here.
      FIXME: move the driver workarounds to some other module. pederb, 2007-07-04
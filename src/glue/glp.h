@@ -227,6 +227,10 @@ typedef void *(APIENTRY * COIN_PFNGLBLENDEQUATIONPROC)(GLenum);
 /* Typedef for glBlendFuncSeparate */
 typedef void *(APIENTRY * COIN_PFNGLBLENDFUNCSEPARATEPROC)(GLenum, GLenum, GLenum, GLenum);
 
+/* Typedefs for glDrawBuffers and glBlendFunci[ARB] */
+typedef void (APIENTRY * COIN_PFNGLDRAWBUFFERSPROC)(GLsizei n, const GLenum * bufs);
+typedef void (APIENTRY * COIN_PFNGLBLENDFUNCIPROC)(GLuint buf, GLenum src, GLenum dst);
+
 /* typedefs for OpenGL vertex arrays */
 typedef void (APIENTRY * COIN_PFNGLVERTEXPOINTERPROC)(GLint size, GLenum type, GLsizei stride, const GLvoid * pointer);
 typedef void (APIENTRY * COIN_PFNGLTEXCOORDPOINTERPROC)(GLint size, GLenum type, GLsizei stride, const GLvoid * pointer);
@@ -646,6 +650,9 @@ struct cc_glglue {
 
   COIN_PFNGLBLENDFUNCSEPARATEPROC glBlendFuncSeparate;
 
+  COIN_PFNGLDRAWBUFFERSPROC glDrawBuffers;
+  COIN_PFNGLBLENDFUNCIPROC glBlendFunci;
+
   COIN_PFNGLVERTEXPOINTERPROC glVertexPointer;
   COIN_PFNGLTEXCOORDPOINTERPROC glTexCoordPointer;
   COIN_PFNGLNORMALPOINTERPROC glNormalPointer;
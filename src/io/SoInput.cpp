@@ -2339,6 +2339,33 @@ SoInput::convertDouble(char * from, double * d)
   *d = coin_ntoh_double_bytes(from);
 }
 
+// Converts \a len values of type \a Type at \a from from network byte
+// order to native byte order at \a to. \a from and \a to may point to
+// the same memory, which is how the readBinaryArray() methods use it.
+//
+// The value is assembled from the bytes in network order, which gives
+// the native representation on any host without checking the
+// endianness. Compilers turn the inner loop into byte swap (or plain
+// move) instructions, which is a lot faster than the function call per
+// value convertFloat() and friends need.
+template <typename Type, typename ValueType>
+static void
+soinput_ntoh_array(const char * from, ValueType * to, const int len)
+{
+  assert(sizeof(Type) == sizeof(ValueType));
+  const unsigned char * src = reinterpret_cast<const unsigned char *>(from);
+  unsigned char * dst = reinterpret_cast<unsigned char *>(to);
+  for (int i = 0; i < len; i++) {
+    Type v = 0;
+    for (unsigned int b = 0; b < sizeof(Type); b++) {
+      v = static_cast<Type>((v << 8) | src[b]);
+    }
+    (void)memcpy(dst, &v, sizeof(Type));
+    src += sizeof(Type);
+    dst += sizeof(Type);
+  }
+}
+
 /*!
   Convert a block of short numbers in network format to native format.
 
@@ -2347,11 +2374,7 @@ SoInput::convertDouble(char * from, double * d)
 void
 SoInput::convertShortArray(char * from, short * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertShort(from, to);
-    from += sizeof(short);
-    to++;
-  }
+  soinput_ntoh_array<uint16_t>(from, to, len);
 }
 
 /*!
@@ -2362,11 +2385,7 @@ SoInput::convertShortArray(char * from, short * to, int len)
 void
 SoInput::convertInt32Array(char * from, int32_t * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertInt32(from, to);
-    from += sizeof(int32_t);
-    to++;
-  }
+  soinput_ntoh_array<uint32_t>(from, to, len);
 }
 
 /*!
@@ -2378,11 +2397,7 @@ SoInput::convertInt32Array(char * from, int32_t * to, int len)
 void
 SoInput::convertFloatArray(char * from, float * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertFloat(from, to);
-    from += sizeof(float);
-    to++;
-  }
+  soinput_ntoh_array<uint32_t>(from, to, len);
 }
 
 /*!
@@ -2394,11 +2409,7 @@ SoInput::convertFloatArray(char * from, float * to, int len)
 void
 SoInput::convertDoubleArray(char * from, double * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertDouble(from, to);
-    from += sizeof(double);
-    to++;
-  }
+  soinput_ntoh_array<uint64_t>(from, to, len);
 }
 
 /*!
@@ -2611,6 +2622,35 @@ SoInput::findFile(const char * basename, SbString & fullname)
   return NULL;
 }
 
+#ifdef COIN_TEST_SUITE
+
+#include <cstring>
+#include <Inventor/SoInput.h>
+
+// check that a hexadecimal integer is read correctly when its "0x"
+// prefix ends exactly at the end of the internal read buffer, and
+// the digits only arrive with the next buffer fill
+BOOST_AUTO_TEST_CASE(hexIntegerAcrossReadBuffer)
+{
+  // must match READBUFSIZE in SoInput_FileInfo.cpp
+  const size_t readbufsize = 65536 * 2;
+  const size_t size = readbufsize + 16;
+  char * buffer = new char[size];
+  (void)memset(buffer, ' ', size);
+  (void)memcpy(buffer + readbufsize - 2, "0x1F 7", 6);
+
+  SoInput in;
+  in.setBuffer(buffer, size);
+  int32_t value = 0;
+  BOOST_CHECK(in.read(value));
+  BOOST_CHECK_EQUAL(value, 0x1F);
+  BOOST_CHECK(in.read(value));
+  BOOST_CHECK_EQUAL(value, 7);
+  delete[] buffer;
+}
+
+#endif // COIN_TEST_SUITE
+
 #undef READ_NUM
 #undef READ_INTEGER
 #undef READ_UNSIGNED_INTEGER
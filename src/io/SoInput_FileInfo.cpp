@@ -215,9 +215,13 @@ SoInput_FileInfo::getChunkOfBytes(unsigned char * ptr, size_t length)
 
   do {
     // Grab bytes from the buffer.
-    while ((this->readbufidx < this->readbuflen) && (length > 0)) {
-      *ptr++ = this->readbuf[this->readbufidx++];
-      --length;
+    if (this->readbufidx < this->readbuflen) {
+      size_t n = this->readbuflen - this->readbufidx;
+      if (n > length) n = length;
+      (void)memcpy(ptr, this->readbuf + this->readbufidx, n);
+      ptr += n;
+      this->readbufidx += n;
+      length -= n;
     }
 
     // Fetch more bytes if necessary. doBufferRead() sets the eof-flag
@@ -490,6 +494,154 @@ SoInput_FileInfo::getReader(void)
   return this->reader;
 }
 
+// Value of the \a n decimal digits in \a s.
+static double
+fileinfo_digits_value(const char * s, const int n)
+{
+  double number = 0.0;
+  double mul = 1.0;
+  for (int i = 0; i < n; i++) {
+    number += (s[(n-1)-i] - '0') * mul;
+    mul *= 10.0;
+  }
+  return number;
+}
+
+// Adds the value of the \a n decimal digits following the decimal
+// point to \a number.
+static double
+fileinfo_add_fraction(double number, const char * s, const int n)
+{
+  double mul = 0.1;
+  for (int i = 0; i < n; i++) {
+    number += (s[i]-'0') * mul;
+    mul *= 0.1;
+  }
+  return number;
+}
+
+// The read*FromBuffer() methods below parse numbers directly from the
+// read buffer, instead of going through get() and putBack() for
+// every character. They are only used when the complete number, and
+// the character terminating it, is available in the buffer, and
+// return NULL (or FALSE) without consuming anything otherwise, so the
+// caller can fall back to the character-by-character parser. That
+// also handles all error cases.
+
+// Returns the end of the integer in the read buffer, or NULL.
+const char *
+SoInput_FileInfo::findIntegerInBuffer(const SbBool allowsign) const
+{
+  if (this->backbuffer.getLength() > 0) return NULL;
+
+  const char * p = this->readbuf + this->readbufidx;
+  const char * end = this->readbuf + this->readbuflen;
+
+  if (allowsign && (p < end) && (*p == '-' || *p == '+')) p++;
+  const char * digits = p;
+  // a "0x" ending right at the buffer end must not be taken as a
+  // decimal 0, so let it through to the digit check below
+  if ((end - p >= 2) && (p[0] == '0') && (p[1] == 'x')) {
+    p += 2;
+    digits = p;
+    while ((p < end) && isxdigit(*p)) p++;
+  }
+  else {
+    while ((p < end) && isdigit(*p)) p++;
+  }
+  if ((p == digits) || (p >= end)) return NULL;
+  return p;
+}
+
+// Consumes the characters up to \a end from the read buffer.
+void
+SoInput_FileInfo::consumeFromBuffer(const char * end)
+{
+  assert(end > this->readbuf + this->readbufidx);
+  this->readbufidx = end - this->readbuf;
+  // digits, signs and the like never affect the line count
+  this->lastchar = end[-1];
+  this->lastputback = -1;
+}
+
+// Parses an integer directly from the read buffer, and converts it
+// with \a convert (strtol() or strtoul()).
+template <typename Type, typename ConvertType>
+static SbBool
+fileinfo_convert_integer(const char * start, const char * end,
+                         ConvertType (*convert)(const char *, char **, int),
+                         Type & l)
+{
+  // FIXME: fixed size buffer, same as the character-by-character
+  // path. 19990530 mortene.
+  char str[512];
+  const size_t len = end - start;
+  if (len >= sizeof(str)) return FALSE;
+  (void)memcpy(str, start, len);
+  str[len] = '\0';
+  l = static_cast<Type>(convert(str, NULL, 0));
+  return TRUE;
+}
+
+// Parses a real number directly from the read buffer.
+SbBool
+SoInput_FileInfo::readRealFromBuffer(double & d)
+{
+  if (this->backbuffer.getLength() > 0) return FALSE;
+
+  const char * start = this->readbuf + this->readbufidx;
+  const char * end = this->readbuf + this->readbuflen;
+  const char * p = start;
+
+  SbBool minus = FALSE;
+  if ((p < end) && (*p == '-' || *p == '+')) {
+    minus = (*p == '-');
+    p++;
+  }
+  const char * intpart = p;
+  while ((p < end) && isdigit(*p)) p++;
+  const int intlen = (int)(p - intpart);
+
+  const char * fracpart = p;
+  int fraclen = 0;
+  if ((p < end) && (*p == '.')) {
+    fracpart = ++p;
+    while ((p < end) && isdigit(*p)) p++;
+    fraclen = (int)(p - fracpart);
+  }
+  if ((intlen == 0) && (fraclen == 0)) return FALSE;
+
+  const char * exppart = NULL;
+  int explen = 0;
+  SbBool expminus = FALSE;
+  if ((p < end) && (*p == 'e' || *p == 'E')) {
+    p++;
+    if ((p < end) && (*p == '-' || *p == '+')) {
+      expminus = (*p == '-');
+      p++;
+    }
+    exppart = p;
+    while ((p < end) && isdigit(*p)) p++;
+    explen = (int)(p - exppart);
+    if (explen == 0) return FALSE;
+  }
+  // the number might continue in the next buffer
+  if (p >= end) return FALSE;
+
+  double number = fileinfo_digits_value(intpart, intlen);
+  number = fileinfo_add_fraction(number, fracpart, fraclen);
+  if (minus) number = -number;
+  if (exppart) {
+    double exponent = fileinfo_digits_value(exppart, explen);
+    if (expminus) exponent = -exponent;
+    number *= pow(10.0, exponent);
+  }
+
+  this->consumeFromBuffer(p);
+  d = number;
+  return TRUE;
+}
+
 SbBool
 SoInput_FileInfo::readUnsignedIntegerString(char * str)
 {
@@ -519,6 +671,12 @@ SbBool
 SoInput_FileInfo::readUnsignedInteger(uint32_t & l)
 {
   assert(!this->isBinary());
+  const char * end = this->findIntegerInBuffer(FALSE);
+  if (end && fileinfo_convert_integer(this->readbuf + this->readbufidx, end, strtoul, l)) {
+    this->consumeFromBuffer(end);
+    return TRUE;
+  }
+
   // FIXME: fixed size buffer for input of unknown
   // length. Ouch. 19990530 mortene.
   char str[512];
@@ -537,6 +695,12 @@ SbBool
 SoInput_FileInfo::readInteger(int32_t & l)
 {
   assert(!this->isBinary());
+  const char * end = this->findIntegerInBuffer(TRUE);
+  if (end && fileinfo_convert_integer(this->readbuf + this->readbufidx, end, strtol, l)) {
+    this->consumeFromBuffer(end);
+    return TRUE;
+  }
+
   // FIXME: fixed size buffer for input of unknown
   // length. Ouch. 19990530 mortene.
   char str[512];
@@ -594,10 +758,12 @@ SbBool
 SoInput_FileInfo::readReal(double & d)
 {
   assert(!this->isBinary());
+  if (this->readRealFromBuffer(d)) return TRUE;
+
   const int BUFSIZE = 2048;
   SbBool minus = FALSE;
   SbBool gotNum = FALSE;
-  int i, n;
+  int n;
   char str[BUFSIZE];
   char * s = str;
 
@@ -613,12 +779,7 @@ SoInput_FileInfo::readReal(double & d)
 
   if ((n = this->readDigits(s)) > 0) {
     gotNum = TRUE;
-    number = 0.0;
-    double mul = 1.0;
-    for (i = 0; i < n; i++) {
-      number += (s[(n-1)-i] - '0') * mul;
-      mul *= 10.0;
-    }
+    number = fileinfo_digits_value(s, n);
     s += n;
   }
   else {
@@ -629,11 +790,7 @@ SoInput_FileInfo::readReal(double & d)
 
     if ((n = this->readDigits(s)) > 0) {
       gotNum = TRUE;
-      double mul = 0.1;
-      for (i = 0; i < n; i++) {
-        number += (s[i]-'0') * mul;
-        mul *= 0.1;
-      }
+      number = fileinfo_add_fraction(number, s, n);
       s += n;
     }
   }
@@ -659,12 +816,7 @@ SoInput_FileInfo::readReal(double & d)
     s += n;
 
     if ((n = this->readDigits(s)) > 0) {
-      exponent = 0.0;
-      double mul = 1.0;
-      for (i = 0; i < n; i++) {
-        exponent += (s[(n-1)-i]-'0') * mul;
-        mul *= 10.0;
-      }
+      exponent = fileinfo_digits_value(s, n);
       if (minus) exponent = -exponent;
 
       number *= pow(10.0, exponent);
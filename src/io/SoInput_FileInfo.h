@@ -215,6 +215,10 @@ public:
   }
 private:
 
+  const char * findIntegerInBuffer(const SbBool allowsign) const;
+  void consumeFromBuffer(const char * end);
+  SbBool readRealFromBuffer(double & d);
+
   SoInput_Reader * getReader(void);
   SoInput_Reader * reader;
   SbBool readHeaderInternal(SoInput * input);
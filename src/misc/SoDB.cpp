@@ -143,6 +143,7 @@
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include <Inventor/annex/Profiler/elements/SoProfilerElement.h>
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerTrace.h"
 
 // *************************************************************************
 
@@ -151,6 +152,7 @@
 #ifndef DOXYGEN_SKIP_THIS
 const char * SoDBP::EnvVars::COIN_PROFILER = "COIN_PROFILER";
 const char * SoDBP::EnvVars::COIN_PROFILER_OVERLAY = "COIN_PROFILER_OVERLAY";
+const char * SoDBP::EnvVars::COIN_PROFILER_TRACE = "COIN_PROFILER_TRACE";
 #endif // DOXYGEN_SKIP_THIS
 
 // *************************************************************************
@@ -247,6 +249,8 @@ SoDB::init(void)
   SoDBP::headerlist = new SbList<SoDB_HeaderInfo *>;
   SoDBP::sensormanager = new SoSensorManager;
   SoDBP::converters = new UInt32ToInt16Map;
+  SoDBP::transactionfields = new SbList<SoField *>;
+  SoDBP::transactionindex = new SbHash<SoField *, int>;
   // FIXME: these are never cleaned up
 
   // NB! There are dependencies in the order of initialization of
@@ -467,6 +471,7 @@ SoDB::init(void)
   if (SoProfiler::isEnabled()) {
     SoProfiler::init();
   }
+  SoProfilerTrace::parseCoinProfilerTraceVariable();
 
   // Debugging for memory leaks will be easier if we can clean up the
   // resource usage. This needs to be done last in init(), so we get
@@ -1173,6 +1178,96 @@ SoDB::endNotify(void)
 
 }
 
+/*!
+  Starts a transaction for batched scene graph edits.
+
+  Until the matching commitTransaction(), field changes will not be
+  propagated through the scene graph. The fields are just recorded
+  as changed, and notification of their auditors is postponed until
+  the transaction is committed. This is useful when doing many field
+  changes in one go, for instance updating thousands of SoTransform
+  nodes from a simulation, since the notification of each change
+  would otherwise walk up through the scene graph, invalidate caches
+  and schedule sensors every time.
+
+  Transactions can be nested, only the outermost commitTransaction()
+  will notify.
+
+  Note that only field changes are postponed. Other changes, like
+  adding or removing children of a group node, will notify at once as
+  usual.
+
+  In a thread safe build, the global notification lock is held from
+  beginTransaction() until the outermost commitTransaction(). Field
+  changes from other threads will block until the transaction is
+  committed, so the thread owning the transaction must not wait for
+  other threads that might change fields (e.g. by joining them or
+  waiting on a condition they signal) while the transaction is open,
+  as that will deadlock. Keep transactions short, and make sure each
+  beginTransaction() is matched by a commitTransaction() on the same
+  thread.
+
+  \since Coin 4.0
+  \sa commitTransaction(), isInTransaction()
+*/
+void
+SoDB::beginTransaction(void)
+{
+  // The notification lock is held until the transaction is committed,
+  // so field changes from other threads will not sneak into this
+  // transaction.
+#ifdef COIN_THREADSAFE
+  (void) cc_recmutex_internal_notify_lock();
+#endif // COIN_THREADSAFE
+  SoDBP::transactioncounter++;
+}
+
+/*!
+  Commits a transaction started with beginTransaction().
+
+  Each field changed during the transaction is notified once, in the
+  order of the first change to it. A node affected by several of the
+  changes (e.g. a node with several changed fields, or a group node
+  above several changed nodes) is only notified once. The state of the
+  scene graph after the commit is the same as if the field changes had
+  been notified one by one, but node sensors triggered by the commit
+  will only see the first of the changes through
+  SoDataSensor::getTriggerField() and friends.
+
+  \since Coin 4.0
+  \sa beginTransaction()
+*/
+void
+SoDB::commitTransaction(void)
+{
+  // An unbalanced commit must neither make the counter negative nor
+  // release a notification lock this thread does not hold.
+  if (SoDBP::transactioncounter == 0) {
+#if COIN_DEBUG
+    SoDebugError::postWarning("SoDB::commitTransaction",
+                              "no transaction to commit");
+#endif // COIN_DEBUG
+    return;
+  }
+  SoDBP::transactioncounter--;
+  if (SoDBP::transactioncounter == 0) SoDBP::commitFieldChanges();
+#ifdef COIN_THREADSAFE
+  (void) cc_recmutex_internal_notify_unlock();
+#endif // COIN_THREADSAFE
+}
+
+/*!
+  Returns \c TRUE if a transaction is open.
+
+  \since Coin 4.0
+  \sa beginTransaction()
+*/
+SbBool
+SoDB::isInTransaction(void)
+{
+  return SoDBP::transactioncounter > 0;
+}
+
 /*!
   Turn on or off the real time sensor.
 
@@ -1209,6 +1304,12 @@ SoDB::readAllWrapper(SoInput * in, const SoType & grouptype)
   assert(grouptype.canCreateInstance());
   assert(grouptype.isDerivedFrom(SoGroup::getClassTypeId()));
 
+  // the file name is kept in an SbName, as the trace event will
+  // outlive the SoInput
+  const char * filename = SoProfilerTrace::isActive() ? in->getCurFileName() : NULL;
+  SoProfilerTraceScope trace("io", "SoDB::readAll",
+                             filename ? SbName(filename).getString() : NULL);
+
   SbBool valid = in->isValidFile();
 
 #ifdef HAVE_NODEKITS
@@ -1692,6 +1793,7 @@ SoDB::removeRoute(SoNode * fromnode, const char * eventout,
 
 #include <Inventor/SoInput.h>
 #include <Inventor/SoInteraction.h>
+#include <Inventor/errors/SoDebugError.h>
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/fields/SoMFNode.h>
 #include <Inventor/fields/SoSFTime.h>
@@ -1700,8 +1802,113 @@ SoDB::removeRoute(SoNode * fromnode, const char * eventout,
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoRotationXYZ.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/sensors/SoNodeSensor.h>
 #include <boost/detail/workaround.hpp>
 
+static void
+countTriggers(void * data, SoSensor *)
+{
+  (*static_cast<int *>(data))++;
+}
+
+BOOST_AUTO_TEST_CASE(transaction)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTransform * t0 = new SoTransform;
+  SoTransform * t1 = new SoTransform;
+  SoTransform * t2 = new SoTransform;
+  root->addChild(t0);
+  root->addChild(t1);
+  root->addChild(t2);
+
+  int triggered = 0;
+  SoNodeSensor sensor(countTriggers, &triggered);
+  sensor.setPriority(0);
+  sensor.attach(root);
+
+  t0->translation.setValue(1.0f, 0.0f, 0.0f);
+  t1->translation.setValue(2.0f, 0.0f, 0.0f);
+  BOOST_CHECK_MESSAGE(triggered == 2, "expected a trigger per field change");
+
+  triggered = 0;
+  SoDB::beginTransaction();
+  BOOST_CHECK(SoDB::isInTransaction());
+  t0->translation.setValue(3.0f, 0.0f, 0.0f);
+  t0->rotation.setValue(SbVec3f(0.0f, 0.0f, 1.0f), 1.0f);
+  t1->translation.setValue(4.0f, 0.0f, 0.0f);
+  t2->scaleFactor.setValue(2.0f, 2.0f, 2.0f);
+  root->removeChild(t2); // t2 dies with a pending change
+  SoDB::beginTransaction();
+  t1->translation.setValue(5.0f, 0.0f, 0.0f);
+  SoDB::commitTransaction();
+  // removeChild() notifies at once
+  BOOST_CHECK_MESSAGE(triggered == 1, "field changes should wait for the commit");
+  SoDB::commitTransaction();
+  BOOST_CHECK(!SoDB::isInTransaction());
+  BOOST_CHECK_MESSAGE(triggered == 2, "expected a single trigger for the transaction");
+  BOOST_CHECK(t0->translation.getValue() == SbVec3f(3.0f, 0.0f, 0.0f));
+  BOOST_CHECK(t1->translation.getValue() == SbVec3f(5.0f, 0.0f, 0.0f));
+
+  sensor.detach();
+  root->unref();
+}
+
+// Do-nothing error handler for ignoring debug warnings while testing.
+static void
+ignoreDebugErrors(const SoError * error, void * data)
+{
+}
+
+BOOST_AUTO_TEST_CASE(transactionNesting)
+{
+  SoTransform * t = new SoTransform;
+  t->ref();
+
+  int triggered = 0;
+  SoNodeSensor sensor(countTriggers, &triggered);
+  sensor.setPriority(0);
+  sensor.attach(t);
+
+  SoDB::beginTransaction();
+  SoDB::beginTransaction();
+  SoDB::beginTransaction();
+  t->translation.setValue(1.0f, 0.0f, 0.0f);
+  SoDB::commitTransaction();
+  t->translation.setValue(2.0f, 0.0f, 0.0f);
+  SoDB::commitTransaction();
+  BOOST_CHECK(SoDB::isInTransaction());
+  BOOST_CHECK_MESSAGE(triggered == 0, "inner commits should not notify");
+  SoDB::commitTransaction();
+  BOOST_CHECK(!SoDB::isInTransaction());
+  BOOST_CHECK_MESSAGE(triggered == 1, "expected one trigger for the outermost commit");
+
+  // An unbalanced commit should be ignored, without leaving the
+  // transaction counter negative.
+  SoErrorCB * oldcb = SoDebugError::getHandlerCallback();
+  void * oldcbdata = SoDebugError::getHandlerData();
+  SoDebugError::setHandlerCallback(ignoreDebugErrors, NULL);
+  SoDB::commitTransaction();
+  SoDebugError::setHandlerCallback(oldcb, oldcbdata);
+  BOOST_CHECK(!SoDB::isInTransaction());
+
+  triggered = 0;
+  t->translation.setValue(3.0f, 0.0f, 0.0f);
+  BOOST_CHECK_MESSAGE(triggered == 1, "changes after the commit should notify at once");
+
+  SoDB::beginTransaction();
+  BOOST_CHECK(SoDB::isInTransaction());
+  t->translation.setValue(4.0f, 0.0f, 0.0f);
+  BOOST_CHECK(triggered == 1);
+  SoDB::commitTransaction();
+  BOOST_CHECK(!SoDB::isInTransaction());
+  BOOST_CHECK(triggered == 2);
+
+  sensor.detach();
+  t->unref();
+}
+
 BOOST_AUTO_TEST_CASE(globalRealTimeField)
 {
   //Need to do this here, since we do not have any manager that calls it for us.
@@ -4,6 +4,7 @@
 #include <Inventor/SoInput.h>
 #include <Inventor/fields/SoField.h>
 #include <Inventor/fields/SoSFTime.h>
+#include <Inventor/misc/SoNotification.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/sensors/SoTimerSensor.h>
 
@@ -17,6 +18,7 @@
 
 #include "fields/SoGlobalField.h"
 #include "coindefs.h"
+#include "threads/recmutexp.h"
 
 #ifdef COIN_THREADSAFE
 // need to include SbRWMutex.h to make C++ call the actual destructor,
@@ -30,6 +32,9 @@ SoTimerSensor * SoDBP::globaltimersensor = NULL;
 UInt32ToInt16Map * SoDBP::converters = NULL;
 SbBool SoDBP::isinitialized = FALSE;
 int SoDBP::notificationcounter = 0;
+int SoDBP::transactioncounter = 0;
+SbList<SoField *> * SoDBP::transactionfields = NULL;
+SbHash<SoField *, int> * SoDBP::transactionindex = NULL;
 SbList<SoDBP::ProgressCallbackInfo> * SoDBP::progresscblist = NULL;
 
 // *************************************************************************
@@ -124,6 +129,10 @@ SoDBP::clean(void)
   SoDBP::globaltimersensor = NULL;
   delete SoDBP::converters;
   SoDBP::converters = NULL;
+  delete SoDBP::transactionfields;
+  SoDBP::transactionfields = NULL;
+  delete SoDBP::transactionindex;
+  SoDBP::transactionindex = NULL;
 
   delete SoDBP::sensormanager;
   SoDBP::sensormanager = NULL;
@@ -139,6 +148,77 @@ SoDBP::clean(void)
 #endif // COIN_THREADSAFE
 }
 
+// Called from SoField::startNotify(). If a transaction is open, the
+// field is added to the set of changed fields (once) and TRUE is
+// returned, so the caller will skip the notification for now.
+SbBool
+SoDBP::recordFieldChange(SoField * field)
+{
+  // Fast path for the common case of no open transaction, so plain
+  // field edits don't pay for the lock. The counter is checked again
+  // below with the lock held.
+  if (SoDBP::transactioncounter == 0) return FALSE;
+
+#ifdef COIN_THREADSAFE
+  (void) cc_recmutex_internal_notify_lock();
+#endif // COIN_THREADSAFE
+  const SbBool record = SoDBP::transactioncounter > 0;
+  if (record) {
+    if (SoDBP::transactionindex->put(field, SoDBP::transactionfields->getLength())) {
+      SoDBP::transactionfields->append(field);
+    }
+  }
+#ifdef COIN_THREADSAFE
+  (void) cc_recmutex_internal_notify_unlock();
+#endif // COIN_THREADSAFE
+  return record;
+}
+
+// Called from the SoField destructor, so we don't try to notify a
+// dead field when the transaction is committed.
+void
+SoDBP::forgetFieldChange(SoField * field)
+{
+  if (SoDBP::transactionindex == NULL ||
+      SoDBP::transactionindex->getNumElements() == 0) return;
+
+#ifdef COIN_THREADSAFE
+  (void) cc_recmutex_internal_notify_lock();
+#endif // COIN_THREADSAFE
+  int idx;
+  if (SoDBP::transactionindex->get(field, idx)) {
+    (*SoDBP::transactionfields)[idx] = NULL;
+    (void) SoDBP::transactionindex->erase(field);
+  }
+#ifdef COIN_THREADSAFE
+  (void) cc_recmutex_internal_notify_unlock();
+#endif // COIN_THREADSAFE
+}
+
+// Notifies all fields changed during the transaction, in the order
+// they were first changed. All the notification lists share the same
+// time stamp, so SoNode::notify() will stop the propagation at nodes
+// which have already been notified. This means that a node, and all
+// nodes above it in the scene graph, is notified only once no matter
+// how many of its fields (or fields below it) were changed.
+void
+SoDBP::commitFieldChanges(void)
+{
+  SoDB::startNotify();
+  SoNotList stamp;
+  SbList<SoField *> & fields = *SoDBP::transactionfields;
+  for (int i = 0; i < fields.getLength(); i++) {
+    SoField * field = fields[i];
+    if (field == NULL) continue;
+    fields[i] = NULL;
+    (void) SoDBP::transactionindex->erase(field);
+    SoNotList l(&stamp);
+    field->notify(&l);
+  }
+  fields.truncate(0);
+  SoDB::endNotify();
+}
+
 void
 SoDBP::removeRealTimeFieldCB(void)
 {
@@ -46,6 +46,7 @@
 
 #include "misc/SbHash.h"
 
+class SoField;
 class SoSensor;
 class SbRWMutex;
 
@@ -68,6 +69,11 @@ public:
 
 typedef SbHash<uint32_t, int16_t> UInt32ToInt16Map;
 
+inline unsigned int SbHashFunc(const SoField * key)
+{
+  return SbHashFunc(reinterpret_cast<size_t>(key));
+}
+
 // *************************************************************************
 
 class SoDBP {
@@ -75,6 +81,7 @@ public:
   struct EnvVars {
     static const char * COIN_PROFILER;
     static const char * COIN_PROFILER_OVERLAY;
+    static const char * COIN_PROFILER_TRACE;
   };
 
   static void variableArgsSanityCheck(void);
@@ -94,6 +101,13 @@ public:
   static int notificationcounter;
   static SbBool isinitialized;
 
+  static int transactioncounter;
+  static SbList<SoField *> * transactionfields;
+  static SbHash<SoField *, int> * transactionindex;
+  static SbBool recordFieldChange(SoField * field);
+  static void forgetFieldChange(SoField * field);
+  static void commitFieldChanges(void);
+
   static SbBool is3dsFile(SoInput * in);
   static SoSeparator * read3DSFile(SoInput * in);
 
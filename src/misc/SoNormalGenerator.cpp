@@ -36,18 +36,192 @@
 
   \ingroup general
 
+  Vertices with equal coordinates are merged using a hash table, so
+  that smoothing works across polygons that don't share vertex
+  indices. For large meshes, face normals and vertex normals can be
+  calculated by a pool of worker threads. The number of threads is set
+  with the COIN_NORMAL_GENERATOR_THREADS environment variable. The
+  generated normals are the same as when only one thread is used.
+
   FIXME: document properly
 */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
 #include <Inventor/misc/SoNormalGenerator.h>
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
+#include <Inventor/C/tidbits.h>
 #include <Inventor/errors/SoDebugError.h>
 
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/wpool.h>
+#include "threads/threadsutilp.h"
+#endif // HAVE_THREADS
+
+#include <boost/static_assert.hpp>
+
 #include "tidbitsp.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 
+// *************************************************************************
+
+class SoNormalGeneratorP {
+public:
+  SoNormalGeneratorP(const int approxVertices)
+    : points(approxVertices),
+      faceStart(approxVertices / 4) { }
+
+  // the unique points, and an open addressing hash table of indices
+  // into points (-1 for empty slots), see SoNormalGenerator::addPoint()
+  SbList <SbVec3f> points;
+  SbList <int> pointTable;
+  // index of the first vertex of each face in vertexList
+  SbList <int> faceStart;
+};
+
+// SoNormalGenerator used to keep an SbBSPTree where the pimpl pointer
+// and the reserved bytes are now, make sure the size is the same.
+struct sonormalgen_oldlayout {
+  SbBSPTree bsp;
+  SbList <int> vertexList;
+  SbList <int> vertexFace;
+  SbList <SbVec3f> faceNormals;
+  SbList <SbVec3f> vertexNormals;
+  SbBool ccw;
+  SbBool perVertex;
+  int currFaceStart;
+};
+BOOST_STATIC_ASSERT(sizeof(SoNormalGenerator) == sizeof(sonormalgen_oldlayout));
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// *************************************************************************
+
+// Face normals and vertex normals are calculated in chunks of at
+// least this many faces/vertices. Smaller meshes are always handled
+// by the calling thread.
+#define SONORMALGEN_MIN_CHUNK 8192
+
+typedef void sonormalgen_chunk_f(void * closure, const int start, const int end);
+
+typedef struct {
+  sonormalgen_chunk_f * func;
+  void * closure;
+  int start;
+  int end;
+} sonormalgen_chunk;
+
+#ifdef HAVE_THREADS
+
+static cc_wpool * sonormalgen_pool = NULL;
+static int sonormalgen_initialized = FALSE;
+
+static void
+sonormalgen_cleanup(void)
+{
+  if (sonormalgen_pool) cc_wpool_destruct(sonormalgen_pool);
+  sonormalgen_pool = NULL;
+  sonormalgen_initialized = FALSE;
+}
+
+// Returns the worker pool, or NULL if COIN_NORMAL_GENERATOR_THREADS
+// isn't set.
+static cc_wpool *
+sonormalgen_get_pool(void)
+{
+  if (!sonormalgen_initialized) {
+    CC_GLOBAL_LOCK;
+    if (!sonormalgen_initialized) {
+      const char * env = coin_getenv("COIN_NORMAL_GENERATOR_THREADS");
+      const int numthreads = env ? atoi(env) : 0;
+      if (numthreads > 0 && cc_thread_implementation() != CC_NO_THREADS) {
+        sonormalgen_pool = cc_wpool_construct(numthreads);
+        coin_atexit((coin_atexit_f *)sonormalgen_cleanup, CC_ATEXIT_NORMAL);
+      }
+      sonormalgen_initialized = TRUE;
+    }
+    CC_GLOBAL_UNLOCK;
+  }
+  return sonormalgen_pool;
+}
+
+static void
+sonormalgen_run_chunk(void * closure)
+{
+  sonormalgen_chunk * chunk = (sonormalgen_chunk *) closure;
+  chunk->func(chunk->closure, chunk->start, chunk->end);
+}
+
+#endif // HAVE_THREADS
+
+// Calls func for the range [0, num), split into chunks which are
+// handled by the worker pool and the calling thread. Each chunk must
+// only write to its own part of the output.
+static void
+sonormalgen_parallel(const int num, sonormalgen_chunk_f * func, void * closure)
+{
+#ifdef HAVE_THREADS
+  cc_wpool * pool = (num >= 2 * SONORMALGEN_MIN_CHUNK) ? sonormalgen_get_pool() : NULL;
+  if (pool) {
+    const int numchunks = SbMin(cc_wpool_get_num_workers(pool) + 1,
+                                num / SONORMALGEN_MIN_CHUNK);
+    // if another thread is using the pool, just do all the work here
+    if (cc_wpool_try_begin(pool, numchunks - 1)) {
+      sonormalgen_chunk * chunks = new sonormalgen_chunk[numchunks];
+      int i;
+      for (i = 0; i < numchunks; i++) {
+        chunks[i].func = func;
+        chunks[i].closure = closure;
+        chunks[i].start = int((int64_t(num) * i) / numchunks);
+        chunks[i].end = int((int64_t(num) * (i + 1)) / numchunks);
+      }
+      for (i = 0; i < numchunks - 1; i++) {
+        cc_wpool_start_worker(pool, sonormalgen_run_chunk, &chunks[i]);
+      }
+      cc_wpool_end(pool);
+      sonormalgen_run_chunk(&chunks[numchunks - 1]);
+      cc_wpool_wait_all(pool);
+      delete[] chunks;
+      return;
+    }
+  }
+#endif // HAVE_THREADS
+  func(closure, 0, num);
+}
+
+// Hash function for the point table. Equal points must give the same
+// hash value, also 0.0 and -0.0.
+static inline uint32_t
+sonormalgen_hash(const SbVec3f & v)
+{
+  uint32_t h = 0x9e3779b9;
+  for (int i = 0; i < 3; i++) {
+    const float f = v[i] + 0.0f; // -0.0 + 0.0 == 0.0
+    uint32_t k;
+    (void) memcpy(&k, &f, sizeof(k));
+    k *= 0xcc9e2d51;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593;
+    h ^= k;
+    h = (h << 13) | (h >> 19);
+    h = h * 5 + 0xe6546b64;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+// *************************************************************************
+
 /*!
   Constructor with \a isccw indicating if polygons are specified
   in counterclockwise order. The \a approxVertices can be used
@@ -55,14 +229,14 @@
 */
 SoNormalGenerator::SoNormalGenerator(const SbBool isccw,
                                      const int approxVertices)
-  : bsp(128, approxVertices),
-    vertexList(approxVertices),
+  : vertexList(approxVertices),
     vertexFace(approxVertices),
     faceNormals(approxVertices / 4),
     vertexNormals(approxVertices),
     ccw(isccw),
     perVertex(TRUE)
 {
+  PRIVATE(this) = new SoNormalGeneratorP(approxVertices);
 }
 
 /*!
@@ -70,6 +244,7 @@ SoNormalGenerator::SoNormalGenerator(const SbBool isccw,
 */
 SoNormalGenerator::~SoNormalGenerator()
 {
+  delete PRIVATE(this);
 }
 
 /*!
@@ -84,7 +259,9 @@ void
 SoNormalGenerator::reset(const SbBool ccwarg)
 {
   this->ccw = ccwarg;
-  this->bsp.clear();
+  PRIVATE(this)->points.truncate(0);
+  PRIVATE(this)->pointTable.truncate(0);
+  PRIVATE(this)->faceStart.truncate(0);
   this->vertexList.truncate(0);
   this->vertexFace.truncate(0);
   this->faceNormals.truncate(0);
@@ -111,8 +288,8 @@ SoNormalGenerator::beginPolygon(void)
 void
 SoNormalGenerator::polygonVertex(const SbVec3f &v)
 {
-  this->vertexList.append(this->bsp.addPoint(v));
-  this->vertexFace.append(this->faceNormals.getLength());
+  this->vertexList.append(this->addPoint(v));
+  this->vertexFace.append(PRIVATE(this)->faceStart.getLength());
 }
 
 /*!
@@ -123,8 +300,9 @@ SoNormalGenerator::polygonVertex(const SbVec3f &v)
 void
 SoNormalGenerator::endPolygon(void)
 {
-  SbVec3f n = this->calcFaceNormal();
-  this->faceNormals.append(n);
+  assert(this->vertexList.getLength() - this->currFaceStart >= 3);
+  // the face normal is calculated when normals are generated
+  PRIVATE(this)->faceStart.append(this->currFaceStart);
 }
 
 /*!
@@ -159,31 +337,50 @@ SoNormalGenerator::quad(const SbVec3f &v0,
   this->endPolygon();
 }
 
+typedef struct {
+  const SbVec3f * facenormals;
+  const int * vertexlist;
+  const int * vertexface;
+  const int * pointfacestart;
+  const int * pointfaces;
+  const int * outvertices;
+  float threshold;
+  SbVec3f * normals;
+} sonormalgen_vertexdata;
+
 //
 // calculates the normal vector for a vertex, based on the
 // normal vectors of all incident faces
 //
 static void
-calc_normal_vec(const SbVec3f *facenormals, const int facenum,
-                SbList <int32_t> &faceArray, const float threshold,
-                SbVec3f &vertnormal)
+sonormalgen_vertex_normals(void * closure, const int start, const int end)
 {
-  // start with face normal vector
-  const SbVec3f * facenormal = &facenormals[facenum];
-  vertnormal = *facenormal;
-
-  int n = faceArray.getLength();
-  int currface;
-
-  for (int i = 0; i < n; i++) {
-    currface = faceArray[i];
-    if (currface != facenum) { // check all but this face
-      const SbVec3f &normal = facenormals[currface];
-      if ((normal.dot(*facenormal)) > threshold) {
-        // smooth towards this face
-        vertnormal += normal;
+  const sonormalgen_vertexdata * data = (const sonormalgen_vertexdata *) closure;
+  const SbVec3f * facenormals = data->facenormals;
+  const int * pointfaces = data->pointfaces;
+
+  for (int i = start; i < end; i++) {
+    const int vi = data->outvertices ? data->outvertices[i] : i;
+    const int facenum = data->vertexface[vi];
+    const int point = data->vertexlist[vi];
+
+    // start with face normal vector
+    const SbVec3f & facenormal = facenormals[facenum];
+    SbVec3f vertnormal = facenormal;
+
+    const int n = data->pointfacestart[point + 1];
+    for (int j = data->pointfacestart[point]; j < n; j++) {
+      const int currface = pointfaces[j];
+      if (currface != facenum) { // check all but this face
+        const SbVec3f & normal = facenormals[currface];
+        if ((normal.dot(facenormal)) > data->threshold) {
+          // smooth towards this face
+          vertnormal += normal;
+        }
       }
     }
+    (void) vertnormal.normalize();
+    data->normals[i] = vertnormal;
   }
 }
 
@@ -213,66 +410,72 @@ SoNormalGenerator::generate(const float creaseAngle,
 
   int i;
 
-  // for each vertex, store all faceindices the vertex is a part of
-  SbList <int32_t> * vertexFaceArray = new SbList<int32_t>[bsp.numPoints()];
-
-  int numvi = this->vertexList.getLength();
-
+  this->calcFaceNormals();
+
+  const int numvi = this->vertexList.getLength();
+  const int numpoints = PRIVATE(this)->points.getLength();
+  const int * vertexlist = this->vertexList.getArrayPtr();
+
+  // for each point, store all faceindices the point is a part of. The
+  // faces of point p are found in pointfaces[pointfacestart[p]] to
+  // pointfaces[pointfacestart[p+1]-1], in vertex order.
+  int * pointfacestart = new int[numpoints + 1];
+  int * pointfaces = new int[numvi];
+  for (i = 0; i <= numpoints; i++) pointfacestart[i] = 0;
+  for (i = 0; i < numvi; i++) pointfacestart[vertexlist[i] + 1]++;
+  for (i = 0; i < numpoints; i++) pointfacestart[i + 1] += pointfacestart[i];
+  int * fillpos = new int[numpoints];
+  (void) memcpy(fillpos, pointfacestart, numpoints * sizeof(int));
   for (i = 0; i < numvi; i++) {
-    vertexFaceArray[vertexList[i]].append(this->vertexFace[i]);
+    pointfaces[fillpos[vertexlist[i]]++] = this->vertexFace[i];
   }
+  delete[] fillpos;
 
-  float threshold = (float)cos(SbClamp(creaseAngle, 0.0f, (float) M_PI));
-
+  // find the vertices to generate normals for
+  SbList <int> outvertices;
   if (striplens) {
+    outvertices.ensureCapacity(numvi);
     i = 0;
     for (int j = 0; j < numstrips; j++) {
       assert(i+2 < numvi);
-      SbVec3f tmpvec;
-      calc_normal_vec(this->faceNormals.getArrayPtr(),
-                      this->vertexFace[i],
-                      vertexFaceArray[vertexList[i]],
-                      threshold, tmpvec);
-      (void) tmpvec.normalize();
-      this->vertexNormals.append(tmpvec);
-      calc_normal_vec(this->faceNormals.getArrayPtr(),
-                      this->vertexFace[i+1],
-                      vertexFaceArray[vertexList[i+1]],
-                      threshold, tmpvec);
-      (void) tmpvec.normalize();
-      this->vertexNormals.append(tmpvec);
+      outvertices.append(i);
+      outvertices.append(i+1);
 
       int num = striplens[j] - 2;
 
       while (num--) {
         i += 2;
         assert(i < numvi);
-        calc_normal_vec(this->faceNormals.getArrayPtr(),
-                        this->vertexFace[i],
-                        vertexFaceArray[vertexList[i]],
-                        threshold, tmpvec);
-        (void) tmpvec.normalize();
-        this->vertexNormals.append(tmpvec);
+        outvertices.append(i);
         i++;
       }
     }
   }
-  else {
-    for (i = 0; i < numvi; i++) {
-      SbVec3f tmpvec;
-      calc_normal_vec(this->faceNormals.getArrayPtr(),
-                      this->vertexFace[i],
-                      vertexFaceArray[vertexList[i]],
-                      threshold, tmpvec);
-      (void) tmpvec.normalize();
-      this->vertexNormals.append(tmpvec);
-    }
-  }
-  delete [] vertexFaceArray;
+  const int numout = striplens ? outvertices.getLength() : numvi;
+
+  const int first = this->vertexNormals.getLength();
+  this->vertexNormals.ensureCapacity(first + numout);
+  for (i = 0; i < numout; i++) this->vertexNormals.append(SbVec3f(0.0f, 0.0f, 0.0f));
+
+  sonormalgen_vertexdata data;
+  data.facenormals = this->faceNormals.getArrayPtr();
+  data.vertexlist = vertexlist;
+  data.vertexface = this->vertexFace.getArrayPtr();
+  data.pointfacestart = pointfacestart;
+  data.pointfaces = pointfaces;
+  data.outvertices = striplens ? outvertices.getArrayPtr() : NULL;
+  data.threshold = (float)cos(SbClamp(creaseAngle, 0.0f, (float) M_PI));
+  data.normals = const_cast<SbVec3f *>(this->vertexNormals.getArrayPtr()) + first;
+  sonormalgen_parallel(numout, sonormalgen_vertex_normals, &data);
+
+  delete[] pointfacestart;
+  delete[] pointfaces;
   this->vertexFace.truncate(0, TRUE);
   this->vertexList.truncate(0, TRUE);
   this->faceNormals.truncate(0, TRUE);
-  this->bsp.clear();
+  PRIVATE(this)->faceStart.truncate(0, TRUE);
+  PRIVATE(this)->points.truncate(0, TRUE);
+  PRIVATE(this)->pointTable.truncate(0, TRUE);
   this->vertexNormals.fit();
 
   // return vertex normals
@@ -286,6 +489,7 @@ void
 SoNormalGenerator::generatePerStrip(const int32_t * striplens,
                                     const int numstrips)
 {
+  this->calcFaceNormals();
   int cnt = 0;
   for (int i = 0; i < numstrips; i++) {
     int n = striplens[i] - 2;
@@ -310,7 +514,7 @@ SoNormalGenerator::generatePerStrip(const int32_t * striplens,
 void
 SoNormalGenerator::generatePerFace(void)
 {
-  // face normals have already been generated. Just set flag.
+  this->calcFaceNormals();
   this->perVertex = FALSE;
   this->faceNormals.fit();
 }
@@ -323,6 +527,7 @@ SoNormalGenerator::generatePerFace(void)
 void
 SoNormalGenerator::generateOverall(void)
 {
+  this->calcFaceNormals();
   const int n = this->faceNormals.getLength();
   const SbVec3f * normals = this->faceNormals.getArrayPtr();
   SbVec3f acc(0.0f, 0.0f, 0.0f);
@@ -396,59 +601,153 @@ SoNormalGenerator::setNormal(const int32_t /* index */,
 }
 
 //
-// Calculates the face normal to the current face.
+// Returns the index of the point equal to v, adding v to the points
+// list if it hasn't been added before.
+//
+int
+SoNormalGenerator::addPoint(const SbVec3f & v)
+{
+  // keep the table at most half full
+  if (2 * (PRIVATE(this)->points.getLength() + 1) > PRIVATE(this)->pointTable.getLength()) {
+    this->resizePointTable(SbMax(PRIVATE(this)->pointTable.getLength() * 2, 256));
+  }
+  const uint32_t mask = uint32_t(PRIVATE(this)->pointTable.getLength() - 1);
+  uint32_t i = sonormalgen_hash(v) & mask;
+  int idx;
+  while ((idx = PRIVATE(this)->pointTable[i]) >= 0) {
+    if (PRIVATE(this)->points[idx] == v) return idx;
+    i = (i + 1) & mask;
+  }
+  idx = PRIVATE(this)->points.getLength();
+  PRIVATE(this)->pointTable[i] = idx;
+  PRIVATE(this)->points.append(v);
+  return idx;
+}
+
+//
+// Rebuilds the point table with size entries. size must be a power
+// of two.
 //
-SbVec3f
-SoNormalGenerator::calcFaceNormal(void)
+void
+SoNormalGenerator::resizePointTable(const int size)
 {
-  const int num = this->vertexList.getLength() - this->currFaceStart;
-
-  assert(num >= 3);
-  const int * cind = (const int *) this->vertexList.getArrayPtr() + this->currFaceStart;
-  const SbVec3f * coords = this->bsp.getPointsArrayPtr();
-  SbVec3f ret;
-
-  if (num == 3) { // triangle
-    const SbVec3f v0 = coords[cind[0]] - coords[cind[1]];
-    const SbVec3f v1 = coords[cind[2]] - coords[cind[1]];
-    if (!this->ccw) { ret = v0.cross(v1); }
-    else { ret = v1.cross(v0); }
+  assert((size & (size - 1)) == 0);
+  PRIVATE(this)->pointTable.truncate(0);
+  PRIVATE(this)->pointTable.ensureCapacity(size);
+  int i;
+  for (i = 0; i < size; i++) PRIVATE(this)->pointTable.append(-1);
+
+  const uint32_t mask = uint32_t(size - 1);
+  const int n = PRIVATE(this)->points.getLength();
+  for (i = 0; i < n; i++) {
+    uint32_t j = sonormalgen_hash(PRIVATE(this)->points[i]) & mask;
+    while (PRIVATE(this)->pointTable[j] >= 0) j = (j + 1) & mask;
+    PRIVATE(this)->pointTable[j] = i;
   }
-  else {
-    // For non-triangle faces
-    const SbVec3f *vert1, *vert2;
-    ret.setValue(0.0f, 0.0f, 0.0f);
-    vert2 = coords + cind[num-1];
-    for (int i = 0; i < num; i++) {
-      vert1 = vert2;
-      vert2 = coords + cind[i];
-      ret[0] += ((*vert1)[1] - (*vert2)[1]) * ((*vert1)[2] + (*vert2)[2]);
-      ret[1] += ((*vert1)[2] - (*vert2)[2]) * ((*vert1)[0] + (*vert2)[0]);
-      ret[2] += ((*vert1)[0] - (*vert2)[0]) * ((*vert1)[1] + (*vert2)[1]);
+}
+
+typedef struct {
+  const SbVec3f * coords;
+  const int * vertexlist;
+  const int * facestart;
+  int numfaces;
+  int numvertices;
+  SbBool ccw;
+  SbVec3f * facenormals;
+} sonormalgen_facedata;
+
+//
+// Calculates the face normals for faces [start, end).
+//
+static void
+sonormalgen_face_normals(void * closure, const int start, const int end)
+{
+  const sonormalgen_facedata * data = (const sonormalgen_facedata *) closure;
+  const SbVec3f * coords = data->coords;
+
+  for (int f = start; f < end; f++) {
+    const int * cind = data->vertexlist + data->facestart[f];
+    const int num = ((f + 1 < data->numfaces) ? data->facestart[f + 1] : data->numvertices) -
+      data->facestart[f];
+    SbVec3f ret;
+
+    if (num == 3) { // triangle
+      const SbVec3f v0 = coords[cind[0]] - coords[cind[1]];
+      const SbVec3f v1 = coords[cind[2]] - coords[cind[1]];
+      if (!data->ccw) { ret = v0.cross(v1); }
+      else { ret = v1.cross(v0); }
+    }
+    else {
+      // For non-triangle faces
+      const SbVec3f *vert1, *vert2;
+      ret.setValue(0.0f, 0.0f, 0.0f);
+      vert2 = coords + cind[num-1];
+      for (int i = 0; i < num; i++) {
+        vert1 = vert2;
+        vert2 = coords + cind[i];
+        ret[0] += ((*vert1)[1] - (*vert2)[1]) * ((*vert1)[2] + (*vert2)[2]);
+        ret[1] += ((*vert1)[2] - (*vert2)[2]) * ((*vert1)[0] + (*vert2)[0]);
+        ret[2] += ((*vert1)[0] - (*vert2)[0]) * ((*vert1)[1] + (*vert2)[1]);
+      }
+      if (!data->ccw) ret = -ret;
     }
-    if (!this->ccw) ret = -ret;
+
+    if (ret.normalize() == 0.0f) {
+      // set to (0,0,0) so that this face will not influence normal smoothing
+      ret.setValue(0.0f, 0.0f, 0.0f);
+    }
+    data->facenormals[f] = ret;
+  }
+}
+
+//
+// Calculates the face normals for all faces added since the last
+// call.
+//
+void
+SoNormalGenerator::calcFaceNormals(void)
+{
+  const int first = this->faceNormals.getLength();
+  const int numfaces = PRIVATE(this)->faceStart.getLength();
+  if (first >= numfaces) return;
+
+  this->faceNormals.ensureCapacity(numfaces);
+  for (int i = first; i < numfaces; i++) {
+    this->faceNormals.append(SbVec3f(0.0f, 0.0f, 0.0f));
   }
 
-  if (ret.normalize() == 0.0f) {
+  sonormalgen_facedata data;
+  data.coords = PRIVATE(this)->points.getArrayPtr();
+  data.vertexlist = this->vertexList.getArrayPtr();
+  data.facestart = PRIVATE(this)->faceStart.getArrayPtr() + first;
+  data.numfaces = numfaces - first;
+  data.numvertices = this->vertexList.getLength();
+  data.ccw = this->ccw;
+  data.facenormals = const_cast<SbVec3f *>(this->faceNormals.getArrayPtr()) + first;
+  sonormalgen_parallel(numfaces - first, sonormalgen_face_normals, &data);
+
 #if COIN_DEBUG
-    // make this an optional warning since it's really ok (in most
-    // cases) to have empty triangles. pederb, 2005-12-21
-    if (coin_debug_extra()) {
+  // make this an optional warning since it's really ok (in most
+  // cases) to have empty triangles. pederb, 2005-12-21
+  if (coin_debug_extra()) {
+    const SbVec3f * coords = PRIVATE(this)->points.getArrayPtr();
+    for (int f = first; f < numfaces; f++) {
+      if (this->faceNormals[f] != SbVec3f(0.0f, 0.0f, 0.0f)) continue;
+      const int end = (f + 1 < numfaces) ? PRIVATE(this)->faceStart[f + 1] : this->vertexList.getLength();
       SbString s;
-      for (int i = 0; i < num; i++) {
-        const SbVec3f v = coords[cind[i]];
+      for (int i = PRIVATE(this)->faceStart[f]; i < end; i++) {
+        const SbVec3f v = coords[this->vertexList[i]];
         SbString c;
         c.sprintf(" <%f, %f, %f>", v[0], v[1], v[2]);
         s += c;
       }
-      SoDebugError::postWarning("SoNormalGenerator::calcFaceNormal",
+      SoDebugError::postWarning("SoNormalGenerator::calcFaceNormals",
                                 "Normal vector found to be of zero length "
                                 "for face with vertex coordinates:%s",
                                 s.getString());
     }
-#endif // COIN_DEBUG      
-    // set to (0,0,0) so that this face will not influence normal smoothing
-    ret.setValue(0.0f, 0.0f, 0.0f);
   }
-  return ret;
+#endif // COIN_DEBUG
 }
+
+#undef PRIVATE
@@ -108,8 +108,30 @@ SoPickedPoint::SoPickedPoint(const SoPickedPoint &pp)
 SoPickedPoint::SoPickedPoint(const SoPath * const pathptr, SoState * const stateptr,
                              const SbVec3f &objSpacePoint)
 {
-  this->path = pathptr->copy();
-  this->path->ref();
+  this->path = NULL;
+  this->init(pathptr, stateptr, objSpacePoint);
+}
+
+//
+// Sets up the picked point for a new intersection. Called from the
+// constructor, and by SoRayPickAction when reusing an instance which
+// has been through clear().
+//
+void
+SoPickedPoint::init(const SoPath * const pathptr, SoState * const stateptr,
+                    const SbVec3f &objSpacePoint)
+{
+  if (this->path == NULL) {
+    this->path = pathptr->copy();
+    this->path->ref();
+  }
+  else {
+    // reuse the path instance instead of allocating a new copy
+    const SoFullPath * frompath = (const SoFullPath *) pathptr;
+    const int len = frompath->getLength();
+    this->path->setHead(frompath->getHead());
+    for (int i = 1; i < len; i++) this->path->append(frompath->getIndex(i));
+  }
   this->state = stateptr;
   this->objPoint = objSpacePoint;
   SoModelMatrixElement::get(state).multVecMatrix(objSpacePoint, this->point);
@@ -130,13 +152,32 @@ SoPickedPoint::SoPickedPoint(const SoPath * const pathptr, SoState * const state
  */
 SoPickedPoint::~SoPickedPoint()
 {
-  assert(this->path);
-  this->path->unref();
+  // the path is NULL after clear() if someone else held on to it
+  if (this->path) this->path->unref();
 
   // SoDetailList will delete all SoDetail instances, so we don't have
   // to do that here
 }
 
+//
+// Releases the nodes in the path and the details, so the instance
+// can be kept around for reuse through init() without holding on to
+// parts of the scene graph.
+//
+void
+SoPickedPoint::clear(void)
+{
+  if (this->path->getRefCount() > 1) {
+    // the application has referenced the path, so leave it alone
+    this->path->unref();
+    this->path = NULL;
+  }
+  else {
+    this->path->truncate(0);
+  }
+  this->detailList.truncate(0);
+}
+
 /*!
   Returns a copy of this picked point.
 
@@ -60,6 +60,18 @@
   to the point where SoProfilerStats is located. Depending of how you
   wish to use the data, either attach sensors to the fields, or connect
   the fields on other coin nodes to the fields on SoProfilerStats.
+
+  <h2>Recording a timeline trace</h2>
+
+  Set the environment variable \ref COIN_PROFILER_TRACE to a file
+  name, or call SoProfiler::startTrace(), to record a timeline of
+  action traversals, render cache builds, VBO and texture uploads,
+  sensor queue processing and file reads. The timeline is written
+  when SoProfiler::stopTrace() is called, or when the application
+  exits, in the Chrome trace-event JSON format, and can be inspected
+  with chrome://tracing or Perfetto. Tracing does not depend on
+  profiling being enabled, and only records a few events per
+  traversal, so the overhead is small.
 */
 
 
@@ -71,6 +83,7 @@
 
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerTrace.h"
 
 #include <string>
 #include <vector>
@@ -228,6 +241,41 @@ SoProfiler::isEnabled(void)
   return profiler::enabled;
 }
 
+/*!
+  Starts recording a timeline trace, which will be written to \a
+  filename in the Chrome trace-event JSON format when stopTrace() is
+  called or the application exits. Any trace already being recorded is
+  written to its file first.
+
+  Returns \c FALSE if \a filename is empty.
+
+  \sa stopTrace(), \ref COIN_PROFILER_TRACE
+*/
+SbBool
+SoProfiler::startTrace(const char * filename)
+{
+  return SoProfilerTrace::start(filename);
+}
+
+/*!
+  Stops recording the timeline trace started by startTrace() and
+  writes it to file.
+*/
+void
+SoProfiler::stopTrace(void)
+{
+  SoProfilerTrace::stop();
+}
+
+/*!
+  Returns whether a timeline trace is being recorded.
+*/
+SbBool
+SoProfiler::isTraceActive(void)
+{
+  return SoProfilerTrace::isActive();
+}
+
 SbBool
 SoProfilerP::shouldContinuousRender(void)
 {
@@ -0,0 +1,425 @@
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "profiler/SoProfilerTrace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/C/threads/mutex.h>
+#include <Inventor/C/threads/storage.h>
+#include <Inventor/SbString.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/errors/SoDebugError.h>
+
+#include "coindefs.h"
+#include "tidbitsp.h"
+#include "misc/SoDBP.h"
+#include "threads/threadsutilp.h"
+
+// *************************************************************************
+
+// Number of events kept for each thread. Must be a power of two.
+#define SOPROFILERTRACE_RINGSIZE (1 << 16)
+
+namespace {
+
+  struct trace_event {
+    const char * category;
+    const char * name;
+    const char * arg;
+    double timestamp;
+    char phase;
+  };
+
+  // Each thread writes to its own buffer, so the buffers can be
+  // written as one timeline per thread. The mutex of a buffer is only
+  // taken by its own thread, and by start() and stop(), so recording
+  // threads don't wait for each other.
+  struct trace_buffer {
+    trace_event * events;
+    unsigned int next;
+    int threadidx;
+    cc_mutex * mutex;
+    SbBool recording;
+  };
+
+  namespace trace {
+    static cc_storage * buffers = NULL;
+    static SbString filename;
+    static SbTime starttime;
+    static int numthreads = 0;
+    static SbBool cleanupset = FALSE;
+    static SbBool exitset = FALSE;
+    // TRUE while events are recorded, guarded by the global lock.
+    // Used to initialize the recording flag of new buffers. The flag
+    // of each buffer is guarded by its mutex. SoProfilerTrace::active
+    // is read without locking by the trace points, and is only a hint.
+    static SbBool recording = FALSE;
+  };
+
+  void
+  trace_buffer_construct(void * closure)
+  {
+    trace_buffer * buf = static_cast<trace_buffer *>(closure);
+    buf->events = NULL;
+    buf->next = 0;
+    buf->threadidx = 0;
+    buf->mutex = NULL;
+    buf->recording = FALSE;
+  }
+
+  void
+  trace_buffer_destruct(void * closure)
+  {
+    trace_buffer * buf = static_cast<trace_buffer *>(closure);
+    delete[] buf->events;
+    if (buf->mutex) cc_mutex_destruct(buf->mutex);
+  }
+
+  // Returns the mutex of the buffer, or NULL if the buffer hasn't been
+  // set up by its thread yet. The buffers are set up while holding
+  // the global lock.
+  cc_mutex *
+  trace_buffer_mutex(trace_buffer * buf)
+  {
+    CC_GLOBAL_LOCK;
+    cc_mutex * mutex = buf->mutex;
+    CC_GLOBAL_UNLOCK;
+    return mutex;
+  }
+
+  void
+  trace_buffer_start(void * closure, void * COIN_UNUSED_ARG(data))
+  {
+    trace_buffer * buf = static_cast<trace_buffer *>(closure);
+    cc_mutex * mutex = trace_buffer_mutex(buf);
+    if (mutex == NULL) return;
+    cc_mutex_lock(mutex);
+    buf->next = 0;
+    buf->recording = TRUE;
+    cc_mutex_unlock(mutex);
+  }
+
+  void
+  trace_buffer_stop(void * closure, void * COIN_UNUSED_ARG(data))
+  {
+    trace_buffer * buf = static_cast<trace_buffer *>(closure);
+    cc_mutex * mutex = trace_buffer_mutex(buf);
+    if (mutex == NULL) return;
+    cc_mutex_lock(mutex);
+    buf->recording = FALSE;
+    cc_mutex_unlock(mutex);
+  }
+
+  trace_buffer *
+  trace_get_buffer(void)
+  {
+    trace_buffer * buf = static_cast<trace_buffer *>(cc_storage_get(trace::buffers));
+    if (buf->mutex == NULL) {
+      CC_GLOBAL_LOCK;
+      buf->events = new trace_event[SOPROFILERTRACE_RINGSIZE];
+      buf->threadidx = ++trace::numthreads;
+      buf->recording = trace::recording;
+      buf->mutex = cc_mutex_construct();
+      CC_GLOBAL_UNLOCK;
+    }
+    return buf;
+  }
+
+  void
+  trace_record(const char * category, const char * name,
+               const char * arg, char phase)
+  {
+    trace_buffer * buf = trace_get_buffer();
+    cc_mutex_lock(buf->mutex);
+    if (buf->recording) {
+      trace_event & ev = buf->events[buf->next & (SOPROFILERTRACE_RINGSIZE - 1)];
+      ev.category = category;
+      ev.name = name;
+      ev.arg = arg;
+      ev.phase = phase;
+      ev.timestamp = (SbTime::getTimeOfDay() - trace::starttime).getValue() * 1000000.0;
+      buf->next++;
+    }
+    cc_mutex_unlock(buf->mutex);
+  }
+
+  void
+  trace_write_string(FILE * fp, const char * str)
+  {
+    (void)fputc('"', fp);
+    for (const char * c = str; *c; c++) {
+      if (*c == '"' || *c == '\\') {
+        (void)fputc('\\', fp);
+        (void)fputc(*c, fp);
+      }
+      else if (static_cast<unsigned char>(*c) < 0x20) {
+        (void)fprintf(fp, "\\u%04x", static_cast<unsigned int>(*c));
+      }
+      else {
+        (void)fputc(*c, fp);
+      }
+    }
+    (void)fputc('"', fp);
+  }
+
+  struct trace_write_data {
+    FILE * fp;
+    SbBool first;
+  };
+
+  void
+  trace_buffer_write(void * closure, void * data)
+  {
+    trace_buffer * buf = static_cast<trace_buffer *>(closure);
+    trace_write_data * wd = static_cast<trace_write_data *>(data);
+    cc_mutex * mutex = trace_buffer_mutex(buf);
+    if (mutex == NULL) return;
+
+    // the thread may still be recording an event, so stop it before
+    // reading the buffer
+    cc_mutex_lock(mutex);
+    buf->recording = FALSE;
+
+    // the buffer may have wrapped around, start at the oldest event
+    unsigned int first = 0;
+    if (buf->next > SOPROFILERTRACE_RINGSIZE) {
+      first = buf->next - SOPROFILERTRACE_RINGSIZE;
+    }
+    for (unsigned int i = first; i < buf->next; i++) {
+      const trace_event & ev = buf->events[i & (SOPROFILERTRACE_RINGSIZE - 1)];
+      (void)fputs(wd->first ? "\n" : ",\n", wd->fp);
+      wd->first = FALSE;
+      (void)fputs("{\"name\":", wd->fp);
+      trace_write_string(wd->fp, ev.name);
+      (void)fputs(",\"cat\":", wd->fp);
+      trace_write_string(wd->fp, ev.category);
+      (void)fprintf(wd->fp, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                    ev.phase, ev.timestamp, buf->threadidx);
+      if (ev.arg) {
+        (void)fputs(",\"args\":{\"detail\":", wd->fp);
+        trace_write_string(wd->fp, ev.arg);
+        (void)fputc('}', wd->fp);
+      }
+      (void)fputc('}', wd->fp);
+    }
+    cc_mutex_unlock(mutex);
+  }
+
+  void
+  trace_cleanup(void)
+  {
+    SoProfilerTrace::stop();
+    if (trace::buffers) {
+      cc_storage_destruct(trace::buffers);
+      trace::buffers = NULL;
+    }
+    trace::numthreads = 0;
+    trace::cleanupset = FALSE;
+  }
+
+  // the coin_atexit() callbacks are only invoked from SoDB::finish(),
+  // so also make sure the trace is written on a regular process exit.
+  // Registered with atexit() by SoProfilerTrace::start().
+  void
+  trace_exit(void)
+  {
+    SoProfilerTrace::stop();
+  }
+
+} // namespace
+
+// *************************************************************************
+
+SbBool SoProfilerTrace::active = FALSE;
+
+/*
+  Starts recording events, discarding any previously recorded ones.
+  The events are written to \a filename when stop() is called.
+*/
+SbBool
+SoProfilerTrace::start(const char * filename)
+{
+  if (SoProfilerTrace::active) SoProfilerTrace::stop();
+  if (!filename || !filename[0]) return FALSE;
+
+  if (trace::buffers == NULL) {
+    trace::buffers = cc_storage_construct_etc(sizeof(trace_buffer),
+                                              trace_buffer_construct,
+                                              trace_buffer_destruct);
+  }
+  if (!trace::cleanupset) {
+    coin_atexit(static_cast<coin_atexit_f *>(trace_cleanup), CC_ATEXIT_NORMAL);
+    trace::cleanupset = TRUE;
+  }
+  if (!trace::exitset) {
+    (void)atexit(trace_exit);
+    trace::exitset = TRUE;
+  }
+
+  CC_GLOBAL_LOCK;
+  trace::filename = filename;
+  trace::starttime = SbTime::getTimeOfDay();
+  trace::recording = TRUE;
+  CC_GLOBAL_UNLOCK;
+  cc_storage_apply_to_all(trace::buffers, trace_buffer_start, NULL);
+  SoProfilerTrace::active = TRUE;
+  return TRUE;
+}
+
+/*
+  Stops recording events, and writes the recorded events to the file
+  given to start().
+*/
+void
+SoProfilerTrace::stop(void)
+{
+  if (!SoProfilerTrace::active) return;
+  SoProfilerTrace::active = FALSE;
+
+  // new buffers won't record, and each existing buffer stops
+  // recording when it is written
+  CC_GLOBAL_LOCK;
+  trace::recording = FALSE;
+  CC_GLOBAL_UNLOCK;
+
+  FILE * fp = fopen(trace::filename.getString(), "w");
+  if (!fp) {
+    cc_storage_apply_to_all(trace::buffers, trace_buffer_stop, NULL);
+    SoDebugError::post("SoProfilerTrace::stop",
+                       "could not open '%s' for writing",
+                       trace::filename.getString());
+  }
+  else {
+    trace_write_data wd;
+    wd.fp = fp;
+    wd.first = TRUE;
+    (void)fputs("{\"traceEvents\":[", fp);
+    cc_storage_apply_to_all(trace::buffers, trace_buffer_write, &wd);
+    (void)fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+    (void)fclose(fp);
+  }
+}
+
+void
+SoProfilerTrace::begin(const char * category, const char * name,
+                       const char * arg)
+{
+  if (!SoProfilerTrace::active) return;
+  trace_record(category, name, arg, 'B');
+}
+
+void
+SoProfilerTrace::end(const char * category, const char * name)
+{
+  if (!SoProfilerTrace::active) return;
+  trace_record(category, name, NULL, 'E');
+}
+
+void
+SoProfilerTrace::parseCoinProfilerTraceVariable(void)
+{
+  const char * env = coin_getenv(SoDBP::EnvVars::COIN_PROFILER_TRACE);
+  if (env == NULL || env[0] == '\0') return;
+  (void)SoProfilerTrace::start(env);
+}
+
+#undef SOPROFILERTRACE_RINGSIZE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstring>
+#include <Inventor/SbString.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/annex/Profiler/SoProfiler.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+BOOST_AUTO_TEST_CASE(ringBufferAndFormat)
+{
+  const char * filename = "SoProfilerTraceTest.json";
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoSearchAction sa;
+  sa.setType(SoSeparator::getClassTypeId());
+
+  BOOST_CHECK(SoProfiler::startTrace(filename));
+  BOOST_CHECK(SoProfiler::isTraceActive());
+  // two events per apply(), more than the 65536 events kept
+  const int numapplies = 40000;
+  for (int i = 0; i < numapplies; i++) sa.apply(root);
+  SoProfiler::stopTrace();
+  BOOST_CHECK(!SoProfiler::isTraceActive());
+  root->unref();
+
+  SbString trace;
+  FILE * fp = fopen(filename, "rb");
+  BOOST_REQUIRE(fp != NULL);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf) - 1, fp)) > 0) {
+    buf[n] = '\0';
+    trace += buf;
+  }
+  (void)fclose(fp);
+  (void)remove(filename);
+
+  const char * header = "{\"traceEvents\":[\n";
+  const char * footer = "\n],\"displayTimeUnit\":\"ms\"}\n";
+  const int len = trace.getLength();
+  BOOST_REQUIRE(len > 100);
+  BOOST_CHECK(trace.getSubString(0, int(strlen(header)) - 1) == header);
+  BOOST_CHECK(trace.getSubString(len - int(strlen(footer))) == footer);
+
+  // only the last 65536 events are kept, starting with a begin event
+  int numevents = 0, numbegin = 0;
+  for (const char * ph = strstr(trace.getString(), "\"ph\":");
+       ph; ph = strstr(ph + 1, "\"ph\":")) {
+    numevents++;
+    if (ph[6] == 'B') numbegin++;
+  }
+  BOOST_CHECK_EQUAL(numevents, 65536);
+  BOOST_CHECK_EQUAL(numbegin, 65536 / 2);
+
+  const SbString first =
+    "{\"name\":\"SoSearchAction\",\"cat\":\"action\",\"ph\":\"B\",\"ts\":";
+  BOOST_CHECK(trace.getSubString(int(strlen(header)),
+                                 int(strlen(header)) + first.getLength() - 1) == first);
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,89 @@
+#ifndef COIN_SOPROFILERTRACE_H
+#define COIN_SOPROFILERTRACE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbBasic.h>
+
+/*
+  The SoProfilerTrace class records a timeline of begin/end events
+  from the library internals (action traversals, cache builds, GL
+  uploads, sensor processing, file reads), and writes them in the
+  Chrome trace-event JSON format, which can be loaded in
+  chrome://tracing or Perfetto.
+
+  Events are stored in a fixed size ring buffer for each thread, so
+  only the most recent events are kept on long runs. The category,
+  name and argument strings are stored as pointers, and must outlive
+  the trace. Use string literals or SbName strings.
+
+  Use the SoProfilerTraceScope class to instrument a block of code.
+  When tracing is not active, the cost is a test of a static flag.
+*/
+
+class SoProfilerTrace {
+public:
+  static SbBool start(const char * filename);
+  static void stop(void);
+  static SbBool isActive(void) { return SoProfilerTrace::active; }
+
+  static void begin(const char * category, const char * name,
+                    const char * arg = NULL);
+  static void end(const char * category, const char * name);
+
+  static void parseCoinProfilerTraceVariable(void);
+
+private:
+  static SbBool active;
+};
+
+class SoProfilerTraceScope {
+public:
+  SoProfilerTraceScope(const char * category, const char * name,
+                       const char * arg = NULL)
+    : category(category), name(name), traced(SoProfilerTrace::isActive())
+  {
+    if (this->traced) SoProfilerTrace::begin(category, name, arg);
+  }
+  ~SoProfilerTraceScope()
+  {
+    if (this->traced) SoProfilerTrace::end(this->category, this->name);
+  }
+
+private:
+  const char * category;
+  const char * name;
+  SbBool traced;
+};
+
+#endif // !COIN_SOPROFILERTRACE_H
@@ -40,6 +40,7 @@
 #include "SoProfilerElement.cpp"
 #include "SoProfilerTopEngine.cpp"
 #include "SoProfilerStats.cpp"
+#include "SoProfilerTrace.cpp"
 
 #ifdef HAVE_NODEKITS
 
@@ -33,6 +33,7 @@
 #include "CoinOffscreenGLCanvas.h"
 
 #include <climits>
+#include <cstring>
 
 #include <Inventor/C/glue/gl.h>
 #include <Inventor/errors/SoDebugError.h>
@@ -57,6 +58,11 @@ CoinOffscreenGLCanvas::CoinOffscreenGLCanvas(void)
   this->size = SbVec2s(0, 0);
   this->context = NULL;
   this->current_hdc = NULL;
+  for (int i = 0; i < NUM_READBUFFERS; i++) {
+    this->readbuffer[i] = 0;
+    this->readbuffersize[i] = 0;
+    this->readpending[i] = FALSE;
+  }
 }
 
 CoinOffscreenGLCanvas::~CoinOffscreenGLCanvas()
@@ -292,6 +298,13 @@ CoinOffscreenGLCanvas::destructContext(void)
 
   if (cc_glglue_context_make_current(this->context)) {
     SoContextHandler::destructingContext(this->renderid);
+    for (int i = 0; i < NUM_READBUFFERS; i++) {
+      if (this->readbuffer[i]) {
+        const cc_glglue * glue = cc_glglue_instance(this->renderid);
+        GLuint buffer = (GLuint) this->readbuffer[i];
+        cc_glglue_glDeleteBuffers(glue, 1, &buffer);
+      }
+    }
     this->deactivateGLContext();
   }
   else {
@@ -304,6 +317,11 @@ CoinOffscreenGLCanvas::destructContext(void)
 
   cc_glglue_context_destruct(this->context);
 
+  for (int i = 0; i < NUM_READBUFFERS; i++) {
+    this->readbuffer[i] = 0;
+    this->readbuffersize[i] = 0;
+    this->readpending[i] = FALSE;
+  }
   this->context = NULL;
   this->renderid = 0;
   this->current_hdc = NULL;
@@ -324,16 +342,11 @@ cc_glglue_win32_updateHDCBitmap(this->context);
 }
 // *************************************************************************
 
-// Pushes the rendered pixels into the internal memory array.
-void
-CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
-                                  const SbVec2s & vpdims,
-                                  unsigned int dstrowsize,
-                                  unsigned int nrcomponents) const
+// Helper function for readPixels() and beginReadPixels().
+static void
+coin_offscreen_reset_pixel_transfer(unsigned int rowlength)
 {
-  glPushAttrib(GL_ALL_ATTRIB_BITS);
-
-  // First reset all settings that can influence the result of a
+  // Reset all settings that can influence the result of a
   // glReadPixels() call, to make sure we get the actual contents of
   // the buffer, unmodified.
   //
@@ -342,7 +355,7 @@ CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
 
   glPixelStorei(GL_PACK_SWAP_BYTES, 0);
   glPixelStorei(GL_PACK_LSB_FIRST, 0);
-  glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)dstrowsize);
+  glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)rowlength);
   glPixelStorei(GL_PACK_SKIP_ROWS, 0);
   glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
 
@@ -378,6 +391,17 @@ CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
   glPixelMapfv(GL_PIXEL_MAP_G_TO_G, 1, &f);
   glPixelMapfv(GL_PIXEL_MAP_B_TO_B, 1, &f);
   glPixelMapfv(GL_PIXEL_MAP_A_TO_A, 1, &f);
+}
+
+// Pushes the rendered pixels into the internal memory array.
+void
+CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
+                                  const SbVec2s & vpdims,
+                                  unsigned int dstrowsize,
+                                  unsigned int nrcomponents) const
+{
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  coin_offscreen_reset_pixel_transfer(dstrowsize);
 
   // The flushing of the OpenGL pipeline before and after the
   // glReadPixels() call is done as a work-around for a reported
@@ -432,6 +456,114 @@ CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
   glPopAttrib();
 }
 
+// Starts an asynchronous read of the rendered pixels into pixel
+// buffer object number idx, so the application can do other work
+// (like rendering the next tile) while the pixels are copied. Returns
+// FALSE if pixel buffer objects are not supported, in which case
+// readPixels() must be used instead. The pixels are fetched with
+// endReadPixels().
+SbBool
+CoinOffscreenGLCanvas::beginReadPixels(const int idx, const SbVec2s & vpdims,
+                                       unsigned int nrcomponents)
+{
+  assert(idx >= 0 && idx < NUM_READBUFFERS);
+  assert((nrcomponents >= 1) && (nrcomponents <= 4));
+
+  const cc_glglue * glue = cc_glglue_instance(this->renderid);
+  if (!cc_glglue_has_vertex_buffer_object(glue) ||
+      !(cc_glglue_glversion_matches_at_least(glue, 2, 1, 0) ||
+        cc_glglue_glext_supported(glue, "GL_ARB_pixel_buffer_object"))) {
+    return FALSE;
+  }
+
+  // grayscale images are converted from RGB(A) in endReadPixels()
+  const unsigned int readcomponents = (nrcomponents == 1 || nrcomponents == 3) ? 3 : 4;
+  const size_t size = size_t(vpdims[0]) * size_t(vpdims[1]) * readcomponents;
+
+  if (this->readbuffer[idx] == 0) {
+    GLuint buffer;
+    cc_glglue_glGenBuffers(glue, 1, &buffer);
+    this->readbuffer[idx] = (unsigned int) buffer;
+    this->readbuffersize[idx] = 0;
+  }
+  cc_glglue_glBindBuffer(glue, GL_PIXEL_PACK_BUFFER, (GLuint) this->readbuffer[idx]);
+  if (this->readbuffersize[idx] < size) {
+    cc_glglue_glBufferData(glue, GL_PIXEL_PACK_BUFFER, (GLsizeiptr) size,
+                           NULL, GL_STREAM_READ);
+    this->readbuffersize[idx] = size;
+  }
+
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  coin_offscreen_reset_pixel_transfer(0);
+
+  // see comment about the ATI driver bug in readPixels()
+  glFlush();
+  glReadPixels(0, 0, vpdims[0], vpdims[1],
+               readcomponents == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glFlush();
+
+  glPopAttrib();
+  cc_glglue_glBindBuffer(glue, GL_PIXEL_PACK_BUFFER, 0);
+  this->readpending[idx] = TRUE;
+  return TRUE;
+}
+
+// Copies the pixels read by beginReadPixels() into dst, which has
+// rows of dstrowsize pixels. Waits for the read to finish if
+// necessary. Returns FALSE if dst couldn't be written, either because
+// there is no read in progress, which happens when the context was
+// destructed (and the pixel buffer objects with it) after
+// beginReadPixels(), or because the pixel buffer object couldn't be
+// mapped. readPixels() must then be used instead.
+SbBool
+CoinOffscreenGLCanvas::endReadPixels(const int idx, uint8_t * dst,
+                                     const SbVec2s & vpdims,
+                                     unsigned int dstrowsize,
+                                     unsigned int nrcomponents)
+{
+  assert(idx >= 0 && idx < NUM_READBUFFERS);
+  if (!this->readpending[idx]) return FALSE;
+  assert(this->readbuffer[idx]);
+  this->readpending[idx] = FALSE;
+
+  const cc_glglue * glue = cc_glglue_instance(this->renderid);
+  cc_glglue_glBindBuffer(glue, GL_PIXEL_PACK_BUFFER, (GLuint) this->readbuffer[idx]);
+  const unsigned char * src = (const unsigned char *)
+    cc_glglue_glMapBuffer(glue, GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+  if (src == NULL) {
+    if (CoinOffscreenGLCanvas::debug()) {
+      SoDebugError::post("CoinOffscreenGLCanvas::endReadPixels",
+                         "Couldn't map pixel buffer object.");
+    }
+    cc_glglue_glBindBuffer(glue, GL_PIXEL_PACK_BUFFER, 0);
+    return FALSE;
+  }
+
+  const unsigned int readcomponents = (nrcomponents == 1 || nrcomponents == 3) ? 3 : 4;
+  for (short y = 0; y < vpdims[1]; y++) {
+    uint8_t * dstrow = dst + size_t(y) * dstrowsize * nrcomponents;
+    if (nrcomponents == readcomponents) {
+      (void)memcpy(dstrow, src, size_t(vpdims[0]) * nrcomponents);
+      src += size_t(vpdims[0]) * nrcomponents;
+    }
+    else {
+      // manually convert to grayscale
+      for (short x = 0; x < vpdims[0]; x++) {
+        double v = src[0] * 0.3 + src[1] * 0.59 + src[2] * 0.11;
+        *dstrow++ = (unsigned char) v;
+        if (nrcomponents == 2) {
+          *dstrow++ = src[3];
+        }
+        src += readcomponents;
+      }
+    }
+  }
+  (void)cc_glglue_glUnmapBuffer(glue, GL_PIXEL_PACK_BUFFER);
+  cc_glglue_glBindBuffer(glue, GL_PIXEL_PACK_BUFFER, 0);
+  return TRUE;
+}
+
 // *************************************************************************
 
 static SbBool tilesize_cached = FALSE;
@@ -58,6 +58,14 @@ public:
                   unsigned int dstrowsize,
                   unsigned int nrcomponents) const;
 
+  // asynchronous readback through pixel buffer objects
+  enum { NUM_READBUFFERS = 2 };
+  SbBool beginReadPixels(const int idx, const SbVec2s & vpdims,
+                         unsigned int nrcomponents);
+  SbBool endReadPixels(const int idx, uint8_t * dst, const SbVec2s & vpdims,
+                       unsigned int dstrowsize,
+                       unsigned int nrcomponents);
+
   static SbBool debug(void);
 
   static SbBool allowResourcehog(void);
@@ -77,6 +85,10 @@ private:
   void * context;
   uint32_t renderid;
   const void * current_hdc;
+
+  unsigned int readbuffer[NUM_READBUFFERS];
+  size_t readbuffersize[NUM_READBUFFERS];
+  SbBool readpending[NUM_READBUFFERS];
 };
 
 // *************************************************************************
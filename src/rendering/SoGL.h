@@ -52,6 +52,8 @@ class SoTextureCoordinateBundle;
 class SoVertexAttributeBundle;
 class SbVec3f;
 class SbVec2f;
+class SoNode;
+class SoGLImage;
 
 // flags for cone, cylinder and cube
 
@@ -68,6 +70,10 @@ class SbVec2f;
 // pointer.
 const cc_glglue * sogl_glue_instance(const SoState * state);
 
+// Tells an SoGLImage which texture node it is used for. The node is
+// touched when an asynchronous resize of the image is done.
+void sogl_glimage_set_owner_node(SoGLImage * image, SoNode * node);
+
 
 // render
 void sogl_render_cone(const float bottomRadius,
@@ -113,6 +113,16 @@
   for textures when the texture quality is higher than this value.
   Default value is 0.85
 
+  \li COIN_TEXTURE_MEMORY_LIMIT: The maximum number of megabytes of
+  texture memory to use in each context before the least recently
+  used textures are deleted. See setTextureMemoryLimit(). Default
+  value is 0, which means no limit.
+
+  \li COIN_GLIMAGE_ASYNC_RESIZE: Number of worker threads used to
+  resize texture images to a legal OpenGL size. A low resolution
+  version of the image is used until the resized image is ready.
+  Default value is 0, which resizes images in the rendering thread.
+
   \COIN_CLASS_EXTENSION
 
   \since Coin 2.0
@@ -213,6 +223,10 @@
 #include <Inventor/misc/SoContextHandler.h>
 #include <Inventor/misc/SoGLCubeMapImage.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/actions/SoAction.h>
+#include <Inventor/nodes/SoNode.h>
+#include <Inventor/sensors/SoTimerSensor.h>
+#include <Inventor/C/threads/sched.h>
 
 #ifdef COIN_THREADSAFE
 #include <Inventor/threads/SbMutex.h>
@@ -224,8 +238,10 @@
 #include "glue/GLUWrapper.h"
 #include "glue/glp.h"
 #include "glue/simage_wrapper.h"
+#include "misc/SbHash.h"
 #include "threads/threadsutilp.h"
 #include "coindefs.h"
+#include "profiler/SoProfilerTrace.h"
 
 #if BOOST_WORKAROUND(COIN_MSVC, <= COIN_MSVC_6_0_VERSION)
 // truncating symbol length
@@ -619,6 +635,53 @@ fast_image_resize3d(const unsigned char * src,
 
 // *************************************************************************
 
+//
+// Asynchronous resizing of texture images. When enabled (see
+// COIN_GLIMAGE_ASYNC_RESIZE), images which need to be resized before
+// they can be used as textures are resized by a cc_sched worker
+// thread. A low resolution version of the image is used as the
+// texture until the worker is done.
+//
+
+class soglimage_asyncjob {
+public:
+  unsigned char * src;
+  SbVec2s srcsize;
+  SbVec2s dstsize;
+  int numcomponents;
+  SbBool highquality;
+  unsigned char * result;
+  SoNode * node; // touched when the job is done, to trigger a redraw
+  SbBool done;
+  SbBool cancelled;
+};
+
+static cc_sched * glimage_async_sched = NULL;
+static SoTimerSensor * glimage_async_sensor = NULL;
+static SbList <soglimage_asyncjob *> * glimage_async_jobs = NULL;
+
+// the size of the image used until the resized image is ready
+#define GLIMAGE_PLACEHOLDER_SIZE 32
+
+// *************************************************************************
+
+//
+// Texture memory budget. All images with texture objects are kept in
+// glimage_residentlist, so that the least recently used textures can
+// be deleted when a context uses more texture memory than
+// glimage_memorylimit (see SoGLImage::setTextureMemoryLimit()).
+//
+
+class SoGLImageP;
+static SbList <SoGLImageP *> * glimage_residentlist = NULL;
+static size_t glimage_memorylimit = 0; // 0 means no limit
+static uint32_t glimage_usecounter = 0; // increased each time a texture is used
+// glimage_usecounter at the start of the current frame in each
+// context, see SoGLImage::beginFrame()
+static SbHash<int, uint32_t> * glimage_framestart = NULL;
+
+// *************************************************************************
+
 class SoGLImageP {
 public:
 #ifdef COIN_THREADSAFE
@@ -629,7 +692,8 @@ public:
   static uint32_t current_glimageid;
   static uint32_t getNextGLImageId(void);
 
-  SoGLDisplayList *createGLDisplayList(SoState *state);
+  SoGLDisplayList *createGLDisplayList(SoState *state,
+                                       SbBool * placeholder = NULL);
   void checkTransparency(void);
   void unrefDLists(SoState *state);
   void reallyCreateTexture(SoState *state,
@@ -640,8 +704,15 @@ public:
                            const SbBool mipmap,
                            const int border);
   void reallyBindPBuffer(SoState *state);
+  void getResizedSize(SoState * state, const int numcomponents,
+                      uint32_t &xsize, uint32_t &ysize, uint32_t &zsize);
   void resizeImage(SoState * state, unsigned char *&imageptr,
                    uint32_t &xsize, uint32_t &ysize, uint32_t &zsize);
+  SbBool resizeImageAsync(SoState * state, unsigned char *&imageptr,
+                          uint32_t &xsize, uint32_t &ysize, uint32_t &zsize,
+                          SbBool & placeholder,
+                          soglimage_asyncjob *& finishedjob);
+  void releaseAsyncJob(void);
   SbBool shouldCreateMipmap(void);
   void applyFilter(const SbBool ismipmap);
 
@@ -669,19 +740,36 @@ public:
   class dldata {
   public:
     dldata(void)
-      : dlist(NULL), age(0) { }
-    dldata(SoGLDisplayList *dl)
+      : dlist(NULL), age(0), placeholder(FALSE), bytes(0), lastused(0) { }
+    dldata(SoGLDisplayList *dl, const SbBool isplaceholder = FALSE)
       : dlist(dl),
-        age(0) { }
+        age(0),
+        placeholder(isplaceholder),
+        bytes(0),
+        lastused(0) { }
     dldata(const dldata & org)
       : dlist(org.dlist),
-        age(org.age) { }
+        age(org.age),
+        placeholder(org.placeholder),
+        bytes(org.bytes),
+        lastused(org.lastused) { }
     SoGLDisplayList *dlist;
     uint32_t age;
+    SbBool placeholder; // texture created from a low resolution image
+    size_t bytes; // estimated texture memory used
+    uint32_t lastused; // for LRU eviction, see enforceMemoryLimit()
   };
 
+  soglimage_asyncjob * asyncjob;
+  // the texture node this image was last set for, see
+  // SoGLMultiTextureImageElement::set(). Not referenced.
+  SoNode * ownernode;
+  static void setOwnerNode(SoGLImage * image, SoNode * node);
+
   SbList <dldata> dlists;
-  SoGLDisplayList *findDL(SoState *state);
+  void appendDL(SoGLDisplayList * dl, const SbBool placeholder = FALSE);
+  size_t getTextureBytes(const SoGLDisplayList * dl) const;
+  SoGLDisplayList *findDL(SoState *state, SbBool * placeholder = NULL);
   void tagDL(SoState *state);
   void unrefOldDL(SoState *state, const uint32_t maxage);
   SoGLImage *owner;
@@ -689,6 +777,10 @@ public:
   void init(void);
   static void contextCleanup(uint32_t context, void * closure);
 
+  int residentidx; // index in glimage_residentlist
+  static size_t getTextureMemoryUsage(const int context);
+  static void enforceMemoryLimit(SoState * state, const SoGLImageP * keep);
+
   static SoGLImage::SoGLImageResizeCB * resizecb;
   static void * resizeclosure;
 };
@@ -731,6 +823,81 @@ SbMutex * SoGLImageP::mutex;
 
 // *************************************************************************
 
+static void
+glimage_async_free_job(soglimage_asyncjob * job)
+{
+  delete[] job->src;
+  if (job->result) {
+    if (job->highquality) simage_wrapper()->simage_free_image(job->result);
+    else delete[] job->result;
+  }
+  delete job;
+}
+
+// called from a worker thread
+static void
+glimage_async_resize(void * closure)
+{
+  soglimage_asyncjob * job = (soglimage_asyncjob *) closure;
+  unsigned char * result;
+  if (job->highquality) {
+    result = simage_wrapper()->simage_resize(job->src,
+                                             job->srcsize[0], job->srcsize[1],
+                                             job->numcomponents,
+                                             job->dstsize[0], job->dstsize[1]);
+  }
+  else {
+    result = new unsigned char[job->dstsize[0] * job->dstsize[1] *
+                               job->numcomponents];
+    fast_image_resize(job->src, result,
+                      job->srcsize[0], job->srcsize[1], job->numcomponents,
+                      job->dstsize[0], job->dstsize[1]);
+  }
+  delete[] job->src;
+  job->src = NULL;
+
+  LOCK_GLIMAGE;
+  job->result = result;
+  job->done = TRUE;
+  UNLOCK_GLIMAGE;
+}
+
+#ifdef COIN_THREADSAFE
+
+// Polls for finished jobs, and touches the node the texture was
+// needed for to trigger a redraw with the resized image.
+static void
+glimage_async_sensor_cb(void * COIN_UNUSED_ARG(closure), SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  SbList <SoNode *> touchlist;
+  LOCK_GLIMAGE;
+  int i = 0;
+  while (i < glimage_async_jobs->getLength()) {
+    soglimage_asyncjob * job = (*glimage_async_jobs)[i];
+    if (job->done) {
+      if (job->node) touchlist.append(job->node);
+      job->node = NULL;
+      glimage_async_jobs->removeFast(i);
+      // cancelled jobs are no longer owned by an SoGLImage
+      if (job->cancelled) glimage_async_free_job(job);
+    }
+    else i++;
+  }
+  if (glimage_async_jobs->getLength() == 0) glimage_async_sensor->unschedule();
+  UNLOCK_GLIMAGE;
+
+  // outside the lock, since unref() might destruct the node, and
+  // with it the SoGLImage
+  for (i = 0; i < touchlist.getLength(); i++) {
+    touchlist[i]->touch();
+    touchlist[i]->unref();
+  }
+}
+
+#endif // COIN_THREADSAFE
+
+// *************************************************************************
+
 /*!
   Constructor.
 */
@@ -742,6 +909,14 @@ SoGLImage::SoGLImage(void)
   PRIVATE(this)->init(); // init members to default values
   PRIVATE(this)->owner = this;
 
+  PRIVATE(this)->residentidx = -1;
+  if (glimage_residentlist) {
+    LOCK_GLIMAGE;
+    PRIVATE(this)->residentidx = glimage_residentlist->getLength();
+    glimage_residentlist->append(PRIVATE(this));
+    UNLOCK_GLIMAGE;
+  }
+
   // check environment variables
   if (COIN_TEX2_LINEAR_LIMIT < 0.0f) {
     const char *env = coin_getenv("COIN_TEX2_LINEAR_LIMIT");
@@ -817,6 +992,22 @@ SoGLImage::initClass(void)
 #endif // COIN_THREADSAFE
   glimage_bufferstorage = new SbStorage(sizeof(soglimage_buffer),
                                         glimage_buffer_construct, glimage_buffer_destruct);
+  glimage_residentlist = new SbList <SoGLImageP *>;
+  glimage_framestart = new SbHash<int, uint32_t>;
+
+  const char * limitenv = coin_getenv("COIN_TEXTURE_MEMORY_LIMIT");
+  if (limitenv) glimage_memorylimit = size_t(atoi(limitenv)) * 1024 * 1024;
+
+#ifdef COIN_THREADSAFE
+  const char * env = coin_getenv("COIN_GLIMAGE_ASYNC_RESIZE");
+  const int numthreads = env ? atoi(env) : 0;
+  if (numthreads > 0 && cc_thread_implementation() != CC_NO_THREADS) {
+    glimage_async_sched = cc_sched_construct(numthreads);
+    glimage_async_jobs = new SbList <soglimage_asyncjob *>;
+    glimage_async_sensor = new SoTimerSensor(glimage_async_sensor_cb, NULL);
+    glimage_async_sensor->setInterval(SbTime(0.1));
+  }
+#endif // COIN_THREADSAFE
 
   coin_atexit((coin_atexit_f*)SoGLImage::cleanupClass, CC_ATEXIT_NORMAL);
 
@@ -829,8 +1020,27 @@ SoGLImage::initClass(void)
 void
 SoGLImage::cleanupClass(void)
 {
+  if (glimage_async_sched) {
+    cc_sched_destruct(glimage_async_sched); // waits for running jobs
+    glimage_async_sched = NULL;
+    delete glimage_async_sensor;
+    glimage_async_sensor = NULL;
+    // jobs not cancelled are still owned by an SoGLImage
+    for (int i = 0; i < glimage_async_jobs->getLength(); i++) {
+      soglimage_asyncjob * job = (*glimage_async_jobs)[i];
+      if (job->cancelled) glimage_async_free_job(job);
+    }
+    delete glimage_async_jobs;
+    glimage_async_jobs = NULL;
+  }
   delete glimage_bufferstorage;
   glimage_bufferstorage = NULL;
+  delete glimage_residentlist;
+  glimage_residentlist = NULL;
+  glimage_memorylimit = 0;
+  glimage_usecounter = 0;
+  delete glimage_framestart;
+  glimage_framestart = NULL;
 #ifdef COIN_THREADSAFE
   delete SoGLImageP::mutex;
   SoGLImageP::mutex = NULL;
@@ -914,7 +1124,7 @@ SoGLImage::setGLDisplayList(SoGLDisplayList * dl,
   if (PRIVATE(this)->isregistered) SoGLImage::unregisterImage(this);
   PRIVATE(this)->unrefDLists(state);
   dl->ref();
-  PRIVATE(this)->dlists.append(SoGLImageP::dldata(dl));
+  PRIVATE(this)->dlists.append(SoGLImageP::dldata(dl)); // size unknown
   PRIVATE(this)->image = NULL; // we have no data. Texture is organized outside this image
   PRIVATE(this)->wraps = wraps;
   PRIVATE(this)->wrapt = wrapt;
@@ -1034,6 +1244,12 @@ SoGLImage::setData(const SbImage *image,
 {
   PRIVATE(this)->imageage = 0;
 
+  if (PRIVATE(this)->asyncjob) {
+    LOCK_GLIMAGE;
+    PRIVATE(this)->releaseAsyncJob();
+    UNLOCK_GLIMAGE;
+  }
+
   if (image == NULL) {
     PRIVATE(this)->unrefDLists(createinstate);
     if (PRIVATE(this)->isregistered) SoGLImage::unregisterImage(this);
@@ -1077,7 +1293,7 @@ SoGLImage::setData(const SbImage *image,
     if (copyok) {
       dl->ref();
       PRIVATE(this)->unrefDLists(createinstate);
-      PRIVATE(this)->dlists.append(SoGLImageP::dldata(dl));
+      PRIVATE(this)->appendDL(dl);
       PRIVATE(this)->image = NULL; // data is temporary, and only for current context
       dl->call(createinstate);
 
@@ -1117,7 +1333,7 @@ SoGLImage::setData(const SbImage *image,
       PRIVATE(this)->border = border;
       PRIVATE(this)->unrefDLists(createinstate);
       if (createinstate) {
-        PRIVATE(this)->dlists.append(SoGLImageP::dldata(PRIVATE(this)->createGLDisplayList(createinstate)));
+        PRIVATE(this)->appendDL(PRIVATE(this)->createGLDisplayList(createinstate));
         PRIVATE(this)->image = NULL; // data is assumed to be temporary
       }
     }
@@ -1188,6 +1404,16 @@ SoGLImage::~SoGLImage()
   SoContextHandler::removeContextDestructionCallback(SoGLImageP::contextCleanup, PRIVATE(this));
   if (PRIVATE(this)->isregistered) SoGLImage::unregisterImage(this);
   PRIVATE(this)->unrefDLists(NULL);
+  LOCK_GLIMAGE;
+  if (PRIVATE(this)->asyncjob) PRIVATE(this)->releaseAsyncJob();
+  if (glimage_residentlist && PRIVATE(this)->residentidx >= 0) {
+    const int idx = PRIVATE(this)->residentidx;
+    glimage_residentlist->removeFast(idx);
+    if (idx < glimage_residentlist->getLength()) {
+      (*glimage_residentlist)[idx]->residentidx = idx;
+    }
+  }
+  UNLOCK_GLIMAGE;
   delete PRIVATE(this);
 }
 
@@ -1243,35 +1469,65 @@ SoGLImage::getImage(void) const
 SoGLDisplayList *
 SoGLImage::getGLDisplayList(SoState *state)
 {
+  SbBool placeholder = FALSE;
   LOCK_GLIMAGE;
-  SoGLDisplayList *dl = PRIVATE(this)->findDL(state);
+  SoGLDisplayList *dl = PRIVATE(this)->findDL(state, &placeholder);
+  if (placeholder &&
+      (!PRIVATE(this)->asyncjob || PRIVATE(this)->asyncjob->done)) {
+    // the resized image is ready (or was uploaded for another context
+    // and freed), replace the low resolution texture
+    int n = PRIVATE(this)->dlists.getLength();
+    for (int i = 0; i < n; i++) {
+      if (PRIVATE(this)->dlists[i].dlist == dl) {
+        PRIVATE(this)->dlists.removeFast(i);
+        break;
+      }
+    }
+    dl->unref(state);
+    dl = NULL;
+  }
   UNLOCK_GLIMAGE;
 
   if (dl == NULL) {
-    dl = PRIVATE(this)->createGLDisplayList(state);
+    dl = PRIVATE(this)->createGLDisplayList(state, &placeholder);
     if (dl) {
       LOCK_GLIMAGE;
-      PRIVATE(this)->dlists.append(SoGLImageP::dldata(dl));
+      PRIVATE(this)->appendDL(dl, placeholder);
+      if (glimage_memorylimit > 0) SoGLImageP::enforceMemoryLimit(state, PRIVATE(this));
       UNLOCK_GLIMAGE;
     }
   }
+  else if (placeholder) {
+    // don't cache the low resolution texture
+    SoCacheElement::setInvalid(TRUE);
+    if (state->isCacheOpen()) {
+      SoCacheElement::invalidate(state);
+    }
+  }
   if (dl && !dl->isMipMapTextureObject() && PRIVATE(this)->image) {
     float quality = SoTextureQualityElement::get(state);
     float oldquality = PRIVATE(this)->quality;
     PRIVATE(this)->quality = quality;
     if (PRIVATE(this)->shouldCreateMipmap()) {
+      // recreate DL to get a mipmapped image. This is done outside
+      // the lock, since the image might have to be resized.
+      SoGLDisplayList * newdl =
+        PRIVATE(this)->createGLDisplayList(state, &placeholder);
       LOCK_GLIMAGE;
-      // recreate DL to get a mipmapped image
       int n = PRIVATE(this)->dlists.getLength();
       for (int i = 0; i < n; i++) {
         if (PRIVATE(this)->dlists[i].dlist == dl) {
           dl->unref(state); // unref old DL
-          dl = PRIVATE(this)->createGLDisplayList(state);
+          dl = newdl;
+          newdl = NULL;
           PRIVATE(this)->dlists[i].dlist = dl;
+          PRIVATE(this)->dlists[i].placeholder = placeholder;
+          PRIVATE(this)->dlists[i].bytes = PRIVATE(this)->getTextureBytes(dl);
           break;
         }
       }
       UNLOCK_GLIMAGE;
+      if (newdl) newdl->unref(state);
     }
     else PRIVATE(this)->quality = oldquality;
   }
@@ -1394,20 +1650,19 @@ SoGLImageP::init(void)
   this->imageage = 0;
   this->endframecb = NULL;
   this->glimageid = 0; // glimageid 0 is an empty image
+  this->asyncjob = NULL;
+  this->ownernode = NULL;
 }
 
 //
-// resize image if necessary. Returns pointer to temporary
-// buffer if that happens, and the new size in xsize, ysize.
+// find the size the image must be resized to before it can be used
+// as a texture. xsize, ysize and zsize should contain the current
+// size, and will be set to the new size.
 //
 void
-SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
-                        uint32_t & xsize, uint32_t & ysize, uint32_t & zsize)
+SoGLImageP::getResizedSize(SoState * state, const int numcomponents,
+                           uint32_t & xsize, uint32_t & ysize, uint32_t & zsize)
 {
-  SbVec3s size;
-  int numcomponents;
-  unsigned char *bytes = this->image->getValue(size, numcomponents);
-
   uint32_t newx = xsize;
   uint32_t newy = ysize;
   uint32_t newz = zsize;
@@ -1513,8 +1768,31 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
   newy += 2 * this->border;
   newz = (zsize==0)?0:newz + (2 * this->border);
 
+  xsize = newx;
+  ysize = newy;
+  zsize = newz;
+}
+
+//
+// resize image if necessary. Returns pointer to temporary
+// buffer if that happens, and the new size in xsize, ysize.
+//
+void
+SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
+                        uint32_t & xsize, uint32_t & ysize, uint32_t & zsize)
+{
+  SbVec3s size;
+  int numcomponents;
+  unsigned char *bytes = this->image->getValue(size, numcomponents);
+
+  uint32_t newx = xsize;
+  uint32_t newy = ysize;
+  uint32_t newz = zsize;
+  this->getResizedSize(state, numcomponents, newx, newy, newz);
+
   if ((newx != xsize) || (newy != ysize) || (newz != zsize)) {
     // We need to resize.
+    const cc_glglue * glw = sogl_glue_instance(state);
 
     int numbytes = newx * newy * ((newz==0)?1:newz) * numcomponents;
     unsigned char * glimage_tmpimagebuffer = glimage_get_buffer(numbytes, FALSE);
@@ -1604,6 +1882,125 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
   zsize = newz;
 }
 
+//
+// Resize the image on a worker thread, if asynchronous resizing is
+// enabled and possible for this image. Returns FALSE if the image
+// must be resized the usual way. Otherwise, imageptr, xsize and ysize
+// are set to the resized image if the worker is done, or to a low
+// resolution version of the image, in which case placeholder is set
+// to TRUE. When the resized image is returned, the finished job is
+// returned in finishedjob, and must be freed by the caller after the
+// image has been uploaded.
+//
+SbBool
+SoGLImageP::resizeImageAsync(SoState * state, unsigned char *& imageptr,
+                             uint32_t & xsize, uint32_t & ysize, uint32_t & zsize,
+                             SbBool & placeholder,
+                             soglimage_asyncjob *& finishedjob)
+{
+  if (!glimage_async_sched || zsize != 0 || this->border != 0 ||
+      (this->flags & SoGLImage::RECTANGLE) || SoGLImageP::resizecb) {
+    return FALSE;
+  }
+  // the GLU resize function needs a GL context, and can't be used
+  // from a worker thread
+  const SbBool highquality = SoTextureScaleQualityElement::get(state) >= 0.5f;
+  if (highquality &&
+      !(simage_wrapper()->available &&
+        simage_wrapper()->versionMatchesAtLeast(1,1,1) &&
+        simage_wrapper()->simage_resize)) {
+    return FALSE;
+  }
+
+  SbVec3s size;
+  int numcomponents;
+  unsigned char * bytes = this->image->getValue(size, numcomponents);
+
+  uint32_t newx = xsize;
+  uint32_t newy = ysize;
+  uint32_t newz = zsize;
+  this->getResizedSize(state, numcomponents, newx, newy, newz);
+  if ((newx == xsize) && (newy == ysize)) return TRUE;
+
+  const SbVec2s dstsize((short) newx, (short) newy);
+  LOCK_GLIMAGE;
+  soglimage_asyncjob * job = this->asyncjob;
+  if (job && (job->dstsize != dstsize || job->highquality != highquality)) {
+    this->releaseAsyncJob();
+    job = NULL;
+  }
+  if (job == NULL) {
+    job = new soglimage_asyncjob;
+    // copy the image data, since the owner of the data might change
+    // it while the worker thread is running
+    const int numbytes = xsize * ysize * numcomponents;
+    job->src = new unsigned char[numbytes];
+    (void)memcpy(job->src, bytes, numbytes);
+    job->srcsize.setValue((short) xsize, (short) ysize);
+    job->dstsize = dstsize;
+    job->numcomponents = numcomponents;
+    job->highquality = highquality;
+    job->result = NULL;
+    // the texture node is touched when the job is done
+    job->node = this->ownernode;
+    if (job->node) job->node->ref();
+    job->done = FALSE;
+    job->cancelled = FALSE;
+
+    this->asyncjob = job;
+    glimage_async_jobs->append(job);
+    if (!glimage_async_sensor->isScheduled()) glimage_async_sensor->schedule();
+    cc_sched_schedule(glimage_async_sched, glimage_async_resize, job, 0);
+  }
+  const SbBool done = job->done;
+  if (done) {
+    // the caller frees the job after uploading the resized image, so
+    // it's detached from this image and the list of pending jobs
+    this->asyncjob = NULL;
+    const int idx = glimage_async_jobs->find(job);
+    if (idx >= 0) glimage_async_jobs->removeFast(idx);
+  }
+  UNLOCK_GLIMAGE;
+
+  if (done) {
+    imageptr = job->result;
+    finishedjob = job;
+  }
+  else {
+    while (newx > GLIMAGE_PLACEHOLDER_SIZE || newy > GLIMAGE_PLACEHOLDER_SIZE) {
+      if (newx > 1) newx >>= 1;
+      if (newy > 1) newy >>= 1;
+    }
+    unsigned char * buf = glimage_get_buffer(newx * newy * numcomponents, FALSE);
+    fast_image_resize(bytes, buf, xsize, ysize, numcomponents, newx, newy);
+    imageptr = buf;
+    placeholder = TRUE;
+  }
+  xsize = newx;
+  ysize = newy;
+  return TRUE;
+}
+
+//
+// Release the asynchronous resize job for the current image. The
+// image mutex must be locked when calling this method.
+//
+void
+SoGLImageP::releaseAsyncJob(void)
+{
+  soglimage_asyncjob * job = this->asyncjob;
+  if (job == NULL) return;
+  this->asyncjob = NULL;
+
+  // jobs still in the list are freed by glimage_async_sensor_cb()
+  if (glimage_async_jobs && glimage_async_jobs->find(job) >= 0) {
+    job->cancelled = TRUE;
+  }
+  else {
+    glimage_async_free_job(job);
+  }
+}
+
 //
 // private method that in addition to creating the display list,
 // tests the size of the image and performs a resize if the size is not
@@ -1611,8 +2008,10 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
 // reallyCreateTexture is called (only) from here.
 //
 SoGLDisplayList *
-SoGLImageP::createGLDisplayList(SoState *state)
+SoGLImageP::createGLDisplayList(SoState *state, SbBool * placeholder)
 {
+  if (placeholder) *placeholder = FALSE;
+
   SbVec3s size;
   int numcomponents;
   unsigned char *bytes =
@@ -1620,6 +2019,8 @@ SoGLImageP::createGLDisplayList(SoState *state)
 
   if (!this->pbuffer && !bytes) return NULL;
 
+  SoProfilerTraceScope trace("gl", "SoGLImage upload");
+
   uint32_t xsize = size[0];
   uint32_t ysize = size[1];
   uint32_t zsize = size[2];
@@ -1630,13 +2031,18 @@ SoGLImageP::createGLDisplayList(SoState *state)
 
   const cc_glglue * glw = sogl_glue_instance(state);
   SbBool mipmap = this->shouldCreateMipmap();
+  soglimage_asyncjob * finishedjob = NULL;
 
   if (imageptr) {
     if (is3D ||
         (!SoGLDriverDatabase::isSupported(glw, SO_GL_NON_POWER_OF_TWO_TEXTURES) ||
          (mipmap && (!SoGLDriverDatabase::isSupported(glw, SO_GL_GENERATE_MIPMAP) &&
                      !SoGLDriverDatabase::isSupported(glw, "GL_SGIS_generate_mipmap"))))) {
-      this->resizeImage(state, imageptr, xsize, ysize, zsize);
+      if (!placeholder ||
+          !this->resizeImageAsync(state, imageptr, xsize, ysize, zsize,
+                                  *placeholder, finishedjob)) {
+        this->resizeImage(state, imageptr, xsize, ysize, zsize);
+      }
     }
   }
   SoCacheElement::setInvalid(TRUE);
@@ -1671,9 +2077,36 @@ SoGLImageP::createGLDisplayList(SoState *state)
                               this->border);
   }
   dl->close(state);
+
+  if (finishedjob) {
+    // the resized image has been uploaded, and is not needed anymore
+    if (finishedjob->node) finishedjob->node->unref();
+    glimage_async_free_job(finishedjob);
+  }
   return dl;
 }
 
+//
+// Called by SoGLMultiTextureImageElement::set() to tell which
+// texture node the image is used for. The node is only needed for
+// asynchronous resizing, and it normally stays the same from frame to
+// frame, so the lock is only taken when the node changes.
+//
+void
+SoGLImageP::setOwnerNode(SoGLImage * image, SoNode * node)
+{
+  if (!glimage_async_sched || PRIVATE(image)->ownernode == node) return;
+  LOCK_GLIMAGE;
+  PRIVATE(image)->ownernode = node;
+  UNLOCK_GLIMAGE;
+}
+
+void
+sogl_glimage_set_owner_node(SoGLImage * image, SoNode * node)
+{
+  SoGLImageP::setOwnerNode(image, node);
+}
+
 //
 // Test image data for transparency by checking each texel.
 //
@@ -1907,16 +2340,42 @@ SoGLImageP::unrefDLists(SoState *state)
   this->dlists.truncate(0);
 }
 
+// add a newly created dl to the list of dls
+void
+SoGLImageP::appendDL(SoGLDisplayList * dl, const SbBool placeholder)
+{
+  dldata data(dl, placeholder);
+  data.bytes = this->getTextureBytes(dl);
+  data.lastused = ++glimage_usecounter;
+  this->dlists.append(data);
+}
+
+// estimate the texture memory used by a texture created by
+// createGLDisplayList()
+size_t
+SoGLImageP::getTextureBytes(const SoGLDisplayList * dl) const
+{
+  if (dl == NULL || this->pbuffer) return 0;
+  size_t bytes = size_t(this->glsize[0]) * size_t(this->glsize[1]) *
+    size_t(this->glsize[2] ? this->glsize[2] : 1) * size_t(this->glcomp);
+  // the mipmap levels add up to a third of the base level
+  if (dl->isMipMapTextureObject()) bytes += bytes / 3;
+  return bytes;
+}
+
 // find dl for a context, NULL if not found
 SoGLDisplayList *
-SoGLImageP::findDL(SoState *state)
+SoGLImageP::findDL(SoState *state, SbBool * placeholder)
 {
   int currcontext = SoGLCacheContextElement::get(state);
   int i, n = this->dlists.getLength();
   SoGLDisplayList *dl;
   for (i = 0; i < n; i++) {
     dl = this->dlists[i].dlist;
-    if (dl->getContext() == currcontext) return dl;
+    if (dl->getContext() == currcontext) {
+      if (placeholder) *placeholder = this->dlists[i].placeholder;
+      return dl;
+    }
   }
   return NULL;
 }
@@ -1931,6 +2390,7 @@ SoGLImageP::tagDL(SoState *state)
     dl = this->dlists[i].dlist;
     if (dl->getContext() == currcontext) {
       this->dlists[i].age = 0;
+      this->dlists[i].lastused = ++glimage_usecounter;
       break;
     }
   }
@@ -2067,6 +2527,106 @@ SoGLImageP::getNextGLImageId(void)
 static SbList <SoGLImage*> * glimage_reglist;
 static uint32_t glimage_maxage = 60;
 
+// sort eviction candidates on least recently used, and on size for
+// textures used at the same time
+typedef struct {
+  SoGLImageP * image;
+  SoGLDisplayList * dlist;
+  uint32_t lastused;
+  size_t bytes;
+} soglimage_evictdata;
+
+extern "C" {
+static int
+compare_evictdata(const void * a, const void * b)
+{
+  const soglimage_evictdata * ea = (const soglimage_evictdata *) a;
+  const soglimage_evictdata * eb = (const soglimage_evictdata *) b;
+  if (ea->lastused != eb->lastused) return ea->lastused < eb->lastused ? -1 : 1;
+  if (ea->bytes != eb->bytes) return ea->bytes > eb->bytes ? -1 : 1;
+  return 0;
+}
+}
+
+// returns the estimated texture memory used in a context. Must be
+// called with the image mutex locked.
+size_t
+SoGLImageP::getTextureMemoryUsage(const int context)
+{
+  size_t used = 0;
+  const int n = glimage_residentlist ? glimage_residentlist->getLength() : 0;
+  for (int i = 0; i < n; i++) {
+    const SbList <dldata> & dlists = (*glimage_residentlist)[i]->dlists;
+    for (int j = 0; j < dlists.getLength(); j++) {
+      if (dlists[j].dlist->getContext() == context) used += dlists[j].bytes;
+    }
+  }
+  return used;
+}
+
+// Deletes the least recently used textures in the current context
+// until the texture memory used is below glimage_memorylimit.
+// Textures used in the current frame and textures in keep are never
+// deleted, and neither are textures which can't be recreated (images
+// where the image data isn't kept). Textures still referenced by
+// others, render caches for instance, are not deleted either, since
+// that wouldn't free any memory until the caches are destroyed. Must
+// be called with the image mutex locked.
+void
+SoGLImageP::enforceMemoryLimit(SoState * state, const SoGLImageP * keep)
+{
+  const int context = SoGLCacheContextElement::get(state);
+  size_t used = 0;
+  SbList <soglimage_evictdata> candidates;
+
+  uint32_t framestart;
+  const SbBool hasframe = glimage_framestart->get(context, framestart);
+
+  const int n = glimage_residentlist->getLength();
+  for (int i = 0; i < n; i++) {
+    SoGLImageP * thisp = (*glimage_residentlist)[i];
+    const SbBool canevict = thisp != keep && thisp->image && !thisp->pbuffer;
+    for (int j = 0; j < thisp->dlists.getLength(); j++) {
+      const dldata & data = thisp->dlists[j];
+      if (data.dlist->getContext() != context) continue;
+      used += data.bytes;
+      if (canevict && data.bytes &&
+          (!hasframe || data.lastused <= framestart) &&
+          data.dlist->getRefCount() == 1) {
+        soglimage_evictdata evict;
+        evict.image = thisp;
+        evict.dlist = data.dlist;
+        evict.lastused = data.lastused;
+        evict.bytes = data.bytes;
+        candidates.append(evict);
+      }
+    }
+  }
+  if (used <= glimage_memorylimit) return;
+
+  qsort((void *) candidates.getArrayPtr(), candidates.getLength(),
+        sizeof(soglimage_evictdata), compare_evictdata);
+
+  for (int i = 0; i < candidates.getLength() && used > glimage_memorylimit; i++) {
+    SbList <dldata> & dlists = candidates[i].image->dlists;
+    for (int j = 0; j < dlists.getLength(); j++) {
+      if (dlists[j].dlist == candidates[i].dlist) {
+#if COIN_DEBUG && 0 // debug
+        SoDebugError::postInfo("SoGLImageP::enforceMemoryLimit",
+                               "DL evicted, %lu bytes: %p",
+                               (unsigned long) dlists[j].bytes,
+                               candidates[i].image->owner);
+#endif // debug
+        // the only reference, so the texture is deleted here
+        dlists[j].dlist->unref(state);
+        dlists.removeFast(j);
+        used -= candidates[i].bytes;
+        break;
+      }
+    }
+  }
+}
+
 static void
 regimage_cleanup(void)
 {
@@ -2080,12 +2640,23 @@ regimage_cleanup(void)
   rendering the scene, typically in the viewer's actualRedraw().
   \a state should be your SoGLRenderAction state.
 
+  SoGLRenderAction calls this method before each rendering, so that
+  textures used in the current frame are not deleted by the texture
+  memory limit (see setTextureMemoryLimit()).
+
   \sa endFrame(), tagImage(), setDisplayListMaxAge()
 */
 void
-SoGLImage::beginFrame(SoState * /* state */)
+SoGLImage::beginFrame(SoState * state)
 {
-  // nothing is done for now
+  // textures used from now on are kept by the texture memory limit
+  if (glimage_memorylimit > 0 && state) {
+    LOCK_GLIMAGE;
+    const int context = SoGLCacheContextElement::get(state);
+    (void)glimage_framestart->put(context, glimage_usecounter);
+    SoGLImageP::enforceMemoryLimit(state, NULL);
+    UNLOCK_GLIMAGE;
+  }
 }
 
 /*!
@@ -2117,6 +2688,11 @@ SoGLImage::tagImage(SoState *state, SoGLImage *image)
 void
 SoGLImage::endFrame(SoState *state)
 {
+  if (glimage_memorylimit > 0 && state) {
+    LOCK_GLIMAGE;
+    SoGLImageP::enforceMemoryLimit(state, NULL);
+    UNLOCK_GLIMAGE;
+  }
   if (glimage_reglist) {
     std::list<std::pair<void (*)(void *), void *> > cb_list;
     LOCK_GLIMAGE;
@@ -2181,6 +2757,59 @@ SoGLImage::setDisplayListMaxAge(const uint32_t maxage)
   glimage_maxage = maxage;
 }
 
+/*!
+  Sets the maximum number of bytes of texture memory to be used by
+  SoGLImage instances (including the subimages of SoGLBigImage
+  instances) in each OpenGL context. When this limit is exceeded, the
+  least recently used textures are deleted, and recreated if they are
+  needed again. Textures used in the current frame (since the last
+  call to beginFrame(), which SoGLRenderAction does before each
+  rendering) are never deleted, and neither are textures still
+  referenced by render caches. The limit might therefore be exceeded.
+
+  The texture memory used is estimated from the size and number of
+  components of the textures. Set to 0, the default, for no limit.
+  The default can also be set with the COIN_TEXTURE_MEMORY_LIMIT
+  environment variable, in megabytes.
+
+  \sa getTextureMemoryUsage(), setDisplayListMaxAge()
+  \since Coin 4.0
+*/
+void
+SoGLImage::setTextureMemoryLimit(const size_t bytes)
+{
+  glimage_memorylimit = bytes;
+}
+
+/*!
+  Returns the texture memory limit.
+
+  \sa setTextureMemoryLimit()
+  \since Coin 4.0
+*/
+size_t
+SoGLImage::getTextureMemoryLimit(void)
+{
+  return glimage_memorylimit;
+}
+
+/*!
+  Returns the estimated number of bytes of texture memory used by
+  SoGLImage instances in the OpenGL context of \a state.
+
+  \sa setTextureMemoryLimit()
+  \since Coin 4.0
+*/
+size_t
+SoGLImage::getTextureMemoryUsage(SoState * state)
+{
+  LOCK_GLIMAGE;
+  const size_t used =
+    SoGLImageP::getTextureMemoryUsage(SoGLCacheContextElement::get(state));
+  UNLOCK_GLIMAGE;
+  return used;
+}
+
 // used internally to keep track of the SoGLImages
 void
 SoGLImage::registerImage(SoGLImage *image)
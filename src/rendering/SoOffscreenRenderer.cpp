@@ -150,6 +150,15 @@
   GL_UNSIGNED_BYTE, respectively. This means that the maximum
   resolution is 32 bits, 8 bits for each of the R/G/B/A components.
 
+  If the OpenGL driver supports pixel buffer objects, the pixels are
+  read asynchronously: for tiled rendering, the pixels of one tile are
+  copied while the next tile is rendered, and for regular rendering,
+  the copying starts at the end of render() and is completed in
+  getBuffer(). The offscreen context, and with it all OpenGL caches
+  and textures, is kept between calls to render() as long as the
+  viewport region doesn't grow, so reuse the same SoOffscreenRenderer
+  instance when rendering many images.
+
 
   One particular usage of the SoOffscreenRenderer is to make it render
   frames to be used for the construction of movies. The general
@@ -382,6 +391,7 @@ public:
   {
     this->master = masterptr;
     this->didreadbuffer = TRUE;
+    this->pendingreadback = FALSE;
 
     this->backgroundcolor.setValue(0,0,0);
     this->components = SoOffscreenRenderer::RGB;
@@ -414,6 +424,8 @@ public:
 
   static SoGLRenderAction::AbortCode GLRenderAbortCallback(void *userData);
   SbBool renderFromBase(SoBase * base);
+  SbVec2s renderTile(SoBase * base, const int x, const int y,
+                     const SbVec2s & glsize, const SbVec2s & fullsize);
 
   void setCameraViewvolForTile(SoCamera * cam);
 
@@ -447,6 +459,10 @@ public:
 
   // used for lazy readPixels()
   SbBool didreadbuffer;
+  // set when the pixels are being read into a pixel buffer object
+  SbBool pendingreadback;
+  SbVec2s pendingdims;
+  unsigned int pendingcomponents;
 private:
   SoOffscreenRenderer * master;
 };
@@ -697,6 +713,40 @@ SoOffscreenRendererP::GLRenderAbortCallback(void *userData)
   return SoGLRenderAction::CONTINUE;
 }
 
+// Renders the tile at (x, y) in tiled rendering. Returns the size of
+// the tile.
+SbVec2s
+SoOffscreenRendererP::renderTile(SoBase * base, const int x, const int y,
+                                 const SbVec2s & glsize, const SbVec2s & fullsize)
+{
+  this->currenttile = SbVec2s(x, y);
+
+  // Find current "active" tilesize.
+  this->subsize[0] = glsize[0];
+  this->subsize[1] = glsize[1];
+  if (x == (this->numsubscreens[0] - 1)) {
+    this->subsize[0] = fullsize[0] % glsize[0];
+    if (this->subsize[0] == 0) { this->subsize[0] = glsize[0]; }
+  }
+  if (y == (this->numsubscreens[1] - 1)) {
+    this->subsize[1] = fullsize[1] % glsize[1];
+    if (this->subsize[1] == 0) { this->subsize[1] = glsize[1]; }
+  }
+
+  SbViewportRegion subviewport = SbViewportRegion(SbVec2s(this->subsize[0], this->subsize[1]));
+  this->renderaction->setViewportRegion(subviewport);
+
+  if (base->isOfType(SoNode::getClassTypeId()))
+    this->renderaction->apply((SoNode *)base);
+  else if (base->isOfType(SoPath::getClassTypeId()))
+    this->renderaction->apply((SoPath *)base);
+  else {
+    assert(FALSE && "Cannot apply to anything else than an SoNode or an SoPath");
+  }
+
+  return subviewport.getViewportSizePixels();
+}
+
 // Collects common code from the two render() functions.
 SbBool
 SoOffscreenRendererP::renderFromBase(SoBase * base)
@@ -843,42 +893,49 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
     this->visitedcamera = NULL;
     this->renderaction->setAbortCallback(SoOffscreenRendererP::GLRenderAbortCallback, this);
 
+    const unsigned int nrcomp = PUBLIC(this)->getComponents();
+
+    // When pixel buffer objects are available, the pixels of a tile
+    // are read asynchronously, and copied into the buffer after the
+    // next tile has been rendered. Not done when debugging, since the
+    // buffer is written after each tile.
+    const SbBool pipelined = SoOffscreenRendererP::debugTileOutputPrefix() == NULL;
+    int readidx = 0;
+    SbBool prevpending = FALSE;
+    SbVec2s prevvpsize;
+    SbVec2s prevtile;
+    int prevoffset = 0;
+
     // Render entire scene graph for each subscreen.
     for (int y=0; y < this->numsubscreens[1]; y++) {
       for (int x=0; x < this->numsubscreens[0]; x++) {
-        this->currenttile = SbVec2s(x, y);
-
-        // Find current "active" tilesize.
-        this->subsize[0] = glsize[0];
-        this->subsize[1] = glsize[1];
-        if (x == (this->numsubscreens[0] - 1)) {
-          this->subsize[0] = fullsize[0] % glsize[0];
-          if (this->subsize[0] == 0) { this->subsize[0] = glsize[0]; }
-        }
-        if (y == (this->numsubscreens[1] - 1)) {
-          this->subsize[1] = fullsize[1] % glsize[1];
-          if (this->subsize[1] == 0) { this->subsize[1] = glsize[1]; }
-        }
-
-        SbViewportRegion subviewport = SbViewportRegion(SbVec2s(this->subsize[0], this->subsize[1]));
-        this->renderaction->setViewportRegion(subviewport);
-
-        if (base->isOfType(SoNode::getClassTypeId()))
-          this->renderaction->apply((SoNode *)base);
-        else if (base->isOfType(SoPath::getClassTypeId()))
-          this->renderaction->apply((SoPath *)base);
-        else {
-          assert(FALSE && "Cannot apply to anything else than an SoNode or an SoPath");
-        }
-
-        const unsigned int nrcomp = PUBLIC(this)->getComponents();
+        const SbVec2s vpsize = this->renderTile(base, x, y, glsize, fullsize);
 
         const int MAINBUF_OFFSET =
           (glsize[1] * y * fullsize[0] + glsize[0] * x) * nrcomp;
 
-        const SbVec2s vpsize = subviewport.getViewportSizePixels();
-        this->glcanvas.readPixels(this->buffer + MAINBUF_OFFSET,
-                                  vpsize, fullsize[0], nrcomp);
+        if (pipelined &&
+            this->glcanvas.beginReadPixels(readidx, vpsize, nrcomp)) {
+          if (prevpending &&
+              !this->glcanvas.endReadPixels(1 - readidx, this->buffer + prevoffset,
+                                            prevvpsize, fullsize[0], nrcomp)) {
+            // The pixels of the previous tile were lost. The current
+            // tile is already in the pixel buffer object, so the
+            // previous tile can be rendered again and read directly.
+            (void)this->renderTile(base, prevtile[0], prevtile[1], glsize, fullsize);
+            this->glcanvas.readPixels(this->buffer + prevoffset,
+                                      prevvpsize, fullsize[0], nrcomp);
+          }
+          prevpending = TRUE;
+          prevvpsize = vpsize;
+          prevtile.setValue(x, y);
+          prevoffset = MAINBUF_OFFSET;
+          readidx = 1 - readidx;
+        }
+        else {
+          this->glcanvas.readPixels(this->buffer + MAINBUF_OFFSET,
+                                    vpsize, fullsize[0], nrcomp);
+        }
 
         // Debug option to dump the (full) buffer after each
         // iteration.
@@ -907,6 +964,15 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
       }
     }
 
+    // The last tile is still in the framebuffer, so it can be read
+    // directly if the pixel buffer object read failed.
+    if (prevpending &&
+        !this->glcanvas.endReadPixels(1 - readidx, this->buffer + prevoffset,
+                                      prevvpsize, fullsize[0], nrcomp)) {
+      this->glcanvas.readPixels(this->buffer + prevoffset,
+                                prevvpsize, fullsize[0], nrcomp);
+    }
+
     this->renderaction->setAbortCallback(NULL, this);
 
     if (!this->visitedcamera) {
@@ -944,9 +1010,17 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
       t = SbTime::getTimeOfDay();
     }
 
+    // Start reading the pixels into a pixel buffer object, so the
+    // transfer can run while the application does other work before
+    // calling getBuffer().
+    this->pendingcomponents = PUBLIC(this)->getComponents();
+    this->pendingdims = fullsize;
+    this->pendingreadback =
+      this->glcanvas.beginReadPixels(0, fullsize, this->pendingcomponents);
+
     if (CoinOffscreenGLCanvas::debug()) {
       SoDebugError::postInfo("SoOffscreenRendererP::renderFromBase",
-                             "*TIMING* glcanvas.readPixels() took %f msecs",
+                             "*TIMING* glcanvas.beginReadPixels() took %f msecs",
                              (SbTime::getTimeOfDay() - t).getValue() * 1000);
     }
   }
@@ -1032,12 +1106,22 @@ SoOffscreenRenderer::getBuffer(void) const
 {
   if (!PRIVATE(this)->didreadbuffer) {
     const SbVec2s dims = this->getViewportRegion().getViewportSizePixels();
+    const unsigned int nrcomp = (unsigned int) this->getComponents();
     //fprintf(stderr,"reading pixels: %d %d\n", dims[0], dims[1]);
 
     PRIVATE(this)->glcanvas.activateGLContext();
-    PRIVATE(this)->glcanvas.readPixels(PRIVATE(this)->buffer, dims, dims[0],
-                                       (unsigned int) this->getComponents());
+    // the read in progress is lost if the context was recreated since
+    // render(), and endReadPixels() returns FALSE
+    if (!PRIVATE(this)->pendingreadback ||
+        PRIVATE(this)->pendingdims != dims ||
+        PRIVATE(this)->pendingcomponents != nrcomp ||
+        !PRIVATE(this)->glcanvas.endReadPixels(0, PRIVATE(this)->buffer, dims,
+                                               dims[0], nrcomp)) {
+      PRIVATE(this)->glcanvas.readPixels(PRIVATE(this)->buffer, dims, dims[0],
+                                         nrcomp);
+    }
     PRIVATE(this)->glcanvas.deactivateGLContext();
+    PRIVATE(this)->pendingreadback = FALSE;
     PRIVATE(this)->didreadbuffer = TRUE;
   }
   return PRIVATE(this)->buffer;
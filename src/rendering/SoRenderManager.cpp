@@ -272,8 +272,7 @@ SoRenderManager::SoRenderManager(void)
   PRIVATE(this)->glaction = new SoGLRenderAction(SbViewportRegion(400, 400));
   PRIVATE(this)->audiorenderaction = new SoAudioRenderAction;
 
-  PRIVATE(this)->clipsensor =
-    new SoNodeSensor(SoRenderManagerP::updateClippingPlanesCB, PRIVATE(this));
+  PRIVATE(this)->clipsensor = new SoRenderManagerClipSensor(PRIVATE(this));
   PRIVATE(this)->clipsensor->setPriority(this->getRedrawPriority() - 1);
 
 }
@@ -357,6 +356,7 @@ SoRenderManager::setCamera(SoCamera * camera)
   }
   PRIVATE(this)->camera = camera;
   if (camera) camera->ref();
+  PRIVATE(this)->invalidateClipCache();
 }
 
 /*!
@@ -432,6 +432,8 @@ SoRenderManager::detachRootSensor(void)
 void
 SoRenderManager::attachClipSensor(SoNode * const sceneroot)
 {
+  // notifications were not tracked while the sensor was detached
+  PRIVATE(this)->invalidateClipCache();
   PRIVATE(this)->clipsensor->attach(sceneroot);
   if (PRIVATE(this)->autoclipping != SoRenderManager::NO_AUTO_CLIPPING) {
     PRIVATE(this)->clipsensor->schedule();
@@ -988,6 +990,7 @@ SoRenderManager::setAutoClipping(AutoClippingStrategy autoclipping)
     case SoRenderManager::FIXED_NEAR_PLANE:
     case SoRenderManager::VARIABLE_NEAR_PLANE:
       if (!PRIVATE(this)->clipsensor->getAttachedNode()) {
+        PRIVATE(this)->invalidateClipCache();
         PRIVATE(this)->clipsensor->attach(PRIVATE(this)->scene);
       }
       PRIVATE(this)->clipsensor->schedule();
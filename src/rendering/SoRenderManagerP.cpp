@@ -41,9 +41,14 @@
 #include <Inventor/actions/SoGetMatrixAction.h>
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/misc/SoNotRec.h>
+
+#include "tidbitsp.h"
 
 SbBool SoRenderManagerP::touchtimer = TRUE;
 SbBool SoRenderManagerP::cleanupfunctionset = FALSE;
+int SoRenderManagerP::debugautoclipping = -1;
 int SoRenderManagerRootSensor::debugrootnotifications = -1;
 
 #define PRIVATE(p) (p->pimpl)
@@ -57,6 +62,11 @@ SoRenderManagerP::SoRenderManagerP(SoRenderManager * publ)
   this->getmatrixaction = NULL;
   this->getbboxaction = NULL;
   this->searchaction = NULL;
+  this->clipbboxvalid = FALSE;
+  this->clipcamvalid = FALSE;
+  this->clippasses = 0;
+  this->clipbboxreused = 0;
+  this->cliptime = SbTime::zero();
 }
 
 SoRenderManagerP::~SoRenderManagerP()
@@ -97,10 +107,62 @@ SoRenderManagerP::updateClippingPlanesCB(void * closure, SoSensor * COIN_UNUSED_
 {
   SoRenderManagerP * thisp = (SoRenderManagerP *) closure;
   if (thisp->autoclipping != SoRenderManager::NO_AUTO_CLIPPING) {
+    if (SoRenderManagerP::debugautoclipping == -1) {
+      const char * env = coin_getenv("COIN_DEBUG_AUTOCLIPPING");
+      SoRenderManagerP::debugautoclipping = env && (atoi(env) > 0);
+    }
+    if (!SoRenderManagerP::debugautoclipping) {
+      thisp->setClippingPlanes();
+      return;
+    }
+
+    const SbBool reuse = thisp->clipbboxvalid &&
+      (thisp->clipbboxvp == thisp->glaction->getViewportRegion());
+    const SbTime start = SbTime::getTimeOfDay();
     thisp->setClippingPlanes();
+    const SbTime spent = SbTime::getTimeOfDay() - start;
+
+    thisp->clippasses++;
+    if (reuse) thisp->clipbboxreused++;
+    thisp->cliptime += spent;
+    SoDebugError::postInfo("SoRenderManager::updateClippingPlanesCB",
+                           "clipping pass took %.3f ms, average %.3f ms "
+                           "(%d of %d passes reused the scene bounding box)",
+                           spent.getValue() * 1000.0,
+                           thisp->cliptime.getValue() * 1000.0 / thisp->clippasses,
+                           thisp->clipbboxreused, thisp->clippasses);
   }
 }
 
+// Called for every notification which reaches the clip sensor, to
+// find out which of the data cached by setClippingPlanes() is still
+// valid. Changes to the camera node itself can not change where the
+// camera is in the scene graph, and nearDistance and farDistance
+// (which setClippingPlanes() writes) do not affect the scene bounds.
+void
+SoRenderManagerP::clipSensorNotify(SoNotList * l)
+{
+  const SoNotRec * rec = l->getFirstRecAtNode();
+  if (this->camera && rec && rec->getBase() == this->camera) {
+    const SoField * field = l->getLastField();
+    if (field != &this->camera->nearDistance &&
+        field != &this->camera->farDistance) {
+      // the bounding box of screen space shapes, like SoText2,
+      // depends on the view volume
+      this->clipbboxvalid = FALSE;
+    }
+    return;
+  }
+  this->invalidateClipCache();
+}
+
+void
+SoRenderManagerP::invalidateClipCache(void)
+{
+  this->clipbboxvalid = FALSE;
+  this->clipcamvalid = FALSE;
+}
+
 void
 SoRenderManagerP::setClippingPlanes(void)
 {
@@ -110,18 +172,28 @@ SoRenderManagerP::setClippingPlanes(void)
 
   SbViewportRegion vp = this->glaction->getViewportRegion();
 
-  if (!this->getbboxaction) {
-    this->getbboxaction = new SoGetBoundingBoxAction(vp);
-  } else {
-    this->getbboxaction->setViewportRegion(vp);
+  // Only traverse the scene when something but the camera has
+  // changed. Subgraphs below SoSeparator nodes with a valid
+  // SoBoundingBoxCache are not traversed by the action, so the cost
+  // is proportional to the parts of the scene that actually changed.
+  if (!this->clipbboxvalid || this->clipbboxvp != vp) {
+    if (!this->getbboxaction) {
+      this->getbboxaction = new SoGetBoundingBoxAction(vp);
+    } else {
+      this->getbboxaction->setViewportRegion(vp);
+    }
+    this->getbboxaction->apply(scene);
+    this->clipbbox = this->getbboxaction->getXfBoundingBox();
+    this->clipbboxvp = vp;
+    this->clipbboxvalid = TRUE;
+  }
+  if (!this->clipcamvalid) {
+    this->getCameraCoordinateSystem(this->clipcammatrix, this->clipcaminverse);
+    this->clipcamvalid = TRUE;
   }
-  this->getbboxaction->apply(scene);
 
-  SbXfBox3f xbox = this->getbboxaction->getXfBoundingBox();
-  SbMatrix cammat;
-  SbMatrix inverse;
-  this->getCameraCoordinateSystem(cammat, inverse);
-  xbox.transform(inverse);
+  SbXfBox3f xbox = this->clipbbox;
+  xbox.transform(this->clipcaminverse);
 
   SbMatrix mat;
   mat.setTranslate(- camera->position.getValue());
@@ -348,6 +420,13 @@ SoRenderManagerRootSensor::notify(SoNotList * l)
   inherited::notify(l);
 }
 
+void
+SoRenderManagerClipSensor::notify(SoNotList * l)
+{
+  this->pimpl->clipSensorNotify(l);
+  inherited::notify(l);
+}
+
 SbBool
 SoRenderManagerRootSensor::debug(void)
 {
@@ -45,6 +45,8 @@
 
 #include <Inventor/system/gl.h>
 #include <Inventor/SbColor4f.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbXfBox3f.h>
 #include <Inventor/SoRenderManager.h>
 #include <Inventor/SbViewportRegion.h>
 #include <Inventor/elements/SoLazyElement.h>
@@ -53,6 +55,7 @@
 
 class SbMatrix;
 class SoNodeSensor;
+class SoNotList;
 class SoInfo;
 class SoNode;
 class SoGetBoundingBoxAction;
@@ -67,6 +70,8 @@ public:
 
   void setClippingPlanes(void);
   static void updateClippingPlanesCB(void * closure, SoSensor * sensor);
+  void clipSensorNotify(SoNotList * l);
+  void invalidateClipCache(void);
   void getCameraCoordinateSystem(SbMatrix & matrix,
                                  SbMatrix & inverse);
   static void redrawshotTriggeredCB(void * data, SoSensor * sensor);
@@ -103,6 +108,18 @@ public:
   uint32_t redrawpri;
   SoNodeSensor * clipsensor;
 
+  // Data reused between auto clipping passes. The clip sensor clears
+  // the valid flags on scene graph changes.
+  SbXfBox3f clipbbox;
+  SbViewportRegion clipbboxvp;
+  SbBool clipbboxvalid;
+  SbMatrix clipcammatrix;
+  SbMatrix clipcaminverse;
+  SbBool clipcamvalid;
+  int clippasses;
+  int clipbboxreused;
+  SbTime cliptime;
+
   SoGetBoundingBoxAction * getbboxaction;
   SoAudioRenderAction * audiorenderaction;
   SoGetMatrixAction * getmatrixaction;
@@ -131,6 +148,7 @@ public:
   // "private" data
   static SbBool touchtimer;
   static SbBool cleanupfunctionset;
+  static int debugautoclipping;
 
 #ifdef COIN_THREADSAFE
   SbMutex mutex;
@@ -164,5 +182,21 @@ private:
 
 // *************************************************************************
 
+class SoRenderManagerClipSensor : public SoNodeSensor {
+  typedef SoNodeSensor inherited;
+
+public:
+  SoRenderManagerClipSensor(SoRenderManagerP * pimpl)
+    : inherited(SoRenderManagerP::updateClippingPlanesCB, pimpl), pimpl(pimpl) { }
+  virtual ~SoRenderManagerClipSensor() { }
+
+  virtual void notify(SoNotList * l);
+
+private:
+  SoRenderManagerP * pimpl;
+};
+
+// *************************************************************************
+
 
 #endif // COIN_SORENDERMANAGERP_H
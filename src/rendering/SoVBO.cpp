@@ -57,6 +57,7 @@
 #include "threads/threadsutilp.h"
 #include "glue/glp.h"
 #include "tidbitsp.h"
+#include "profiler/SoProfilerTrace.h"
 
 static int vbo_vertex_count_min_limit = -1;
 static int vbo_vertex_count_max_limit = -1;
@@ -308,6 +309,7 @@ SoVBO::bindBuffer(uint32_t contextid)
   GLuint buffer;
   if (!this->vbohash.get(contextid, buffer)) {
     // need to create a new buffer for this context
+    SoProfilerTraceScope trace("gl", "SoVBO upload");
     cc_glglue_glGenBuffers(glue, 1, &buffer);
     cc_glglue_glBindBuffer(glue, this->target, buffer);
     cc_glglue_glBufferData(glue, this->target,
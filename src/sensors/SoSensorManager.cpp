@@ -109,6 +109,7 @@
 
 #include "misc/SbHash.h"
 #include "coindefs.h" // COIN_STUB()
+#include "profiler/SoProfilerTrace.h"
 
 // *************************************************************************
 
@@ -134,6 +135,130 @@
 
 // *************************************************************************
 
+// A priority queue of sensors, ordered on a key (priority or trigger
+// time) and then on insertion order, so sensors with equal keys are
+// processed FIFO. This is a binary heap where removed sensors are not
+// taken out of the heap, just forgotten in the hash of live entries
+// and skipped when they reach the top. Insertion and removal of the
+// first sensor are O(log n), removal of an arbitrary sensor is O(1).
+template <class Type, class Key>
+class SoSensorQueue {
+public:
+  SoSensorQueue(void) : counter(0) { }
+
+  void insert(Type * sensor, const Key & key) {
+    Entry entry;
+    entry.key = key;
+    entry.seq = this->counter++;
+    entry.sensor = sensor;
+    // if the sensor was already in the queue, the old entry goes stale
+    (void) this->live.put(sensor, entry.seq);
+    this->heap.append(entry);
+    this->siftUp(this->heap.getLength() - 1);
+  }
+
+  SbBool remove(Type * sensor) {
+    if (!this->live.erase(sensor)) return FALSE;
+    // don't let the stale entries dominate the heap
+    const int numlive = static_cast<int>(this->live.getNumElements());
+    if (this->heap.getLength() > 64 && this->heap.getLength() > 4 * numlive) {
+      this->compact();
+    }
+    return TRUE;
+  }
+
+  int getLength(void) const {
+    return static_cast<int>(this->live.getNumElements());
+  }
+
+  Type * getFirst(Key & key) {
+    this->purge();
+    if (this->heap.getLength() == 0) return NULL;
+    key = this->heap[0].key;
+    return this->heap[0].sensor;
+  }
+
+  Type * removeFirst(void) {
+    this->purge();
+    if (this->heap.getLength() == 0) return NULL;
+    Type * sensor = this->heap[0].sensor;
+    (void) this->live.erase(sensor);
+    this->pop();
+    return sensor;
+  }
+
+private:
+  struct Entry {
+    Key key;
+    uint64_t seq;
+    Type * sensor;
+  };
+
+  static SbBool before(const Entry & a, const Entry & b) {
+    if (a.key < b.key) return TRUE;
+    if (b.key < a.key) return FALSE;
+    return a.seq < b.seq;
+  }
+
+  SbBool isLive(const Entry & entry) const {
+    uint64_t seq;
+    return this->live.get(entry.sensor, seq) && seq == entry.seq;
+  }
+
+  void purge(void) {
+    while (this->heap.getLength() && !this->isLive(this->heap[0])) {
+      this->pop();
+    }
+  }
+
+  void pop(void) {
+    const int last = this->heap.getLength() - 1;
+    this->heap[0] = this->heap[last];
+    this->heap.truncate(last);
+    if (last > 0) this->siftDown(0);
+  }
+
+  void compact(void) {
+    int n = 0;
+    for (int i = 0; i < this->heap.getLength(); i++) {
+      if (this->isLive(this->heap[i])) this->heap[n++] = this->heap[i];
+    }
+    this->heap.truncate(n);
+    for (int i = n / 2 - 1; i >= 0; i--) this->siftDown(i);
+  }
+
+  void siftUp(int i) {
+    const Entry entry = this->heap[i];
+    while (i > 0) {
+      const int parent = (i - 1) / 2;
+      if (!before(entry, this->heap[parent])) break;
+      this->heap[i] = this->heap[parent];
+      i = parent;
+    }
+    this->heap[i] = entry;
+  }
+
+  void siftDown(int i) {
+    const int n = this->heap.getLength();
+    const Entry entry = this->heap[i];
+    for (;;) {
+      int child = 2 * i + 1;
+      if (child >= n) break;
+      if (child + 1 < n && before(this->heap[child + 1], this->heap[child])) child++;
+      if (!before(this->heap[child], entry)) break;
+      this->heap[i] = this->heap[child];
+      i = child;
+    }
+    this->heap[i] = entry;
+  }
+
+  SbList<Entry> heap;
+  SbHash<Type *, uint64_t> live;
+  uint64_t counter;
+};
+
+// *************************************************************************
+
 class SoSensorManagerP {
 public:
   SoSensorManagerP(void) : alive(ALIVE_PATTERN) { }
@@ -146,9 +271,9 @@ public:
   // delayqueue   - stores SoDelayQueueSensor's in sorted order.
   // timerqueue - stores SoTimerSensors in sorted order.
 
-  SbList <SoDelayQueueSensor *> immediatequeue;
-  SbList <SoDelayQueueSensor *> delayqueue;
-  SbList <SoTimerQueueSensor *> timerqueue;
+  SoSensorQueue<SoDelayQueueSensor, uint32_t> immediatequeue;
+  SoSensorQueue<SoDelayQueueSensor, uint32_t> delayqueue;
+  SoSensorQueue<SoTimerQueueSensor, double> timerqueue;
   SbList <SoTimerSensor*> reschedulelist;
 
   // FIXME: from what I can see, the two dicts below are simply used
@@ -294,7 +419,7 @@ SoSensorManager::insertDelaySensor(SoDelayQueueSensor * newentry)
   // strategy.
   if (newentry->getPriority() == 0) {
     LOCK_IMMEDIATE_QUEUE(this);
-    PRIVATE(this)->immediatequeue.append(newentry);
+    PRIVATE(this)->immediatequeue.insert(newentry, 0);
     UNLOCK_IMMEDIATE_QUEUE(this);
   }
   else {
@@ -305,17 +430,8 @@ SoSensorManager::insertDelaySensor(SoDelayQueueSensor * newentry)
     }
 
     LOCK_DELAY_QUEUE(this);
-    SbList <SoDelayQueueSensor *> & delayqueue = PRIVATE(this)->delayqueue;
-
-    // <= in test since the sensors should be processed FIFO for
-    // sensors with equal priority
-    uint32_t newsensorpriority = newentry->getPriority();
-    int pos = 0;
-    while((pos < delayqueue.getLength()) &&
-          (delayqueue[pos]->getPriority() <= newsensorpriority)) {
-      pos++;
-    }
-    delayqueue.insert(newentry, pos);
+    // sensors with equal priority are processed FIFO
+    PRIVATE(this)->delayqueue.insert(newentry, newentry->getPriority());
     UNLOCK_DELAY_QUEUE(this);
     this->notifyChanged();
   }
@@ -343,20 +459,9 @@ SoSensorManager::insertTimerSensor(SoTimerQueueSensor * newentry)
   SoSensorManagerP::assertAlive(PRIVATE(this));
   assert(newentry);
 
-  SbList <SoTimerQueueSensor *> & timerqueue = PRIVATE(this)->timerqueue;
-
   LOCK_TIMER_QUEUE(this);
-  int i = 0;
-
-  // <= in test since the sensors should be processed FIFO for sensors
-  // with the same trigger time
-  double newtime = newentry->getTriggerTime().getValue();
-  while ((i < timerqueue.getLength()) &&
-         (timerqueue[i]->getTriggerTime().getValue() <= newtime)) {
-    i++;
-  }
-  timerqueue.insert(newentry, i);
-
+  // sensors with the same trigger time are processed FIFO
+  PRIVATE(this)->timerqueue.insert(newentry, newentry->getTriggerTime().getValue());
   UNLOCK_TIMER_QUEUE(this);
 
 #if DEBUG_TIMER_SENSORHANDLING || 0 // debug
@@ -387,28 +492,24 @@ SoSensorManager::removeDelaySensor(SoDelayQueueSensor * entry)
 
   LOCK_DELAY_QUEUE(this);
   // Check "real" queue first..
-  int idx = PRIVATE(this)->delayqueue.find(entry);
-  if (idx != -1) PRIVATE(this)->delayqueue.remove(idx);
+  SbBool found = PRIVATE(this)->delayqueue.remove(entry);
   UNLOCK_DELAY_QUEUE(this);
 
   // ..then the immediate queue.
-  if (idx == -1) {
+  if (!found) {
     LOCK_IMMEDIATE_QUEUE(this);
-    idx = PRIVATE(this)->immediatequeue.find(entry);
-    if (idx != -1) PRIVATE(this)->immediatequeue.remove(idx);
+    found = PRIVATE(this)->immediatequeue.remove(entry);
     UNLOCK_IMMEDIATE_QUEUE(this);
   }
   // ..then the reinsert list
-  if (idx == -1) {
-    if (PRIVATE(this)->reinsertdict.erase(entry)) {
-      idx = 0; // make sure notifyChanged() is called.
-    }
+  if (!found) {
+    found = PRIVATE(this)->reinsertdict.erase(entry) != 0;
   }
 
-  if (idx != -1) this->notifyChanged();
+  if (found) this->notifyChanged();
 
 #if COIN_DEBUG
-  if (idx == -1) {
+  if (!found) {
     SoDebugError::postWarning("SoSensorManager::removeDelaySensor",
                               "trying to remove element not in list");
   }
@@ -424,9 +525,7 @@ SoSensorManager::removeTimerSensor(SoTimerQueueSensor * entry)
   SoSensorManagerP::assertAlive(PRIVATE(this));
 
   LOCK_TIMER_QUEUE(this);
-  int idx = PRIVATE(this)->timerqueue.find(entry);
-  if (idx != -1) {
-    PRIVATE(this)->timerqueue.remove(idx);
+  if (PRIVATE(this)->timerqueue.remove(entry)) {
     UNLOCK_TIMER_QUEUE(this);
     this->notifyChanged();
   }
@@ -450,6 +549,8 @@ SoSensorManager::processTimerQueue(void)
   if (PRIVATE(this)->processingtimerqueue || PRIVATE(this)->timerqueue.getLength() == 0)
     return;
 
+  SoProfilerTraceScope trace("sensor", "SoSensorManager::processTimerQueue");
+
 #if DEBUG_TIMER_SENSORHANDLING // debug
   SoDebugError::postInfo("SoSensorManager::processTimerQueue",
                          "start: %d elements", PRIVATE(this)->timerqueue.getLength());
@@ -477,16 +578,16 @@ SoSensorManager::processTimerQueue(void)
 
   LOCK_TIMER_QUEUE(this);
 
-  SbTime currenttime = SbTime::getTimeOfDay();
-  while (PRIVATE(this)->timerqueue.getLength() > 0 &&
-         PRIVATE(this)->timerqueue[0]->getTriggerTime() <= currenttime) {
+  const double currenttime = SbTime::getTimeOfDay().getValue();
+  double triggertime;
+  while (PRIVATE(this)->timerqueue.getFirst(triggertime) &&
+         triggertime <= currenttime) {
 #if DEBUG_TIMER_SENSORHANDLING // debug
     SoDebugError::postInfo("SoSensorManager::processTimerQueue",
-                           "process element with triggertime %s",
-                           PRIVATE(this)->timerqueue[0]->getTriggerTime().format().getString());
+                           "process element with triggertime %f",
+                           triggertime);
 #endif // debug
-    SoSensor * sensor = PRIVATE(this)->timerqueue[0];
-    PRIVATE(this)->timerqueue.remove(0);
+    SoSensor * sensor = PRIVATE(this)->timerqueue.removeFirst();
     UNLOCK_TIMER_QUEUE(this);
     sensor->trigger();
     LOCK_TIMER_QUEUE(this);
@@ -548,6 +649,8 @@ SoSensorManager::processDelayQueue(SbBool isidle)
   if (PRIVATE(this)->processingdelayqueue || PRIVATE(this)->delayqueue.getLength() == 0)
     return;
 
+  SoProfilerTraceScope trace("sensor", "SoSensorManager::processDelayQueue");
+
 #if DEBUG_DELAY_SENSORHANDLING // debug
   SoDebugError::postInfo("SoSensorManager::processDelayQueue",
                          "start: %d elements", PRIVATE(this)->delayqueue.getLength());
@@ -585,15 +688,14 @@ SoSensorManager::processDelayQueue(SbBool isidle)
 
   // Sensors with higher priorities are triggered first.
   while (PRIVATE(this)->delayqueue.getLength()) {
+    SoDelayQueueSensor * sensor = PRIVATE(this)->delayqueue.removeFirst();
+    UNLOCK_DELAY_QUEUE(this);
 #if DEBUG_DELAY_SENSORHANDLING // debug
     SoDebugError::postInfo("SoSensorManager::processDelayQueue",
                            "treat element with pri %d",
-                           PRIVATE(this)->delayqueue[0]->getPriority());
+                           sensor->getPriority());
 #endif // debug
 
-    SoDelayQueueSensor * sensor = PRIVATE(this)->delayqueue[0];
-    PRIVATE(this)->delayqueue.remove(0);
-    UNLOCK_DELAY_QUEUE(this);
 
     if (!isidle && sensor->isIdleOnly()) {
       // move sensor to another temporary list. It will be reinserted
@@ -692,8 +794,7 @@ SoSensorManager::processImmediateQueue(void)
     SoDebugError::postInfo("SoSensorManager::processImmediateQueue",
                            "trigger element");
 #endif // debug
-    SoSensor * sensor = PRIVATE(this)->immediatequeue[0];
-    PRIVATE(this)->immediatequeue.remove(0);
+    SoSensor * sensor = PRIVATE(this)->immediatequeue.removeFirst();
     UNLOCK_IMMEDIATE_QUEUE(this);
 
     sensor->trigger();
@@ -772,8 +873,10 @@ SoSensorManager::isTimerSensorPending(SbTime & tm)
   SoSensorManagerP::assertAlive(PRIVATE(this));
 
   LOCK_TIMER_QUEUE(this);
-  if (PRIVATE(this)->timerqueue.getLength() > 0) {
-    tm = PRIVATE(this)->timerqueue[0]->getTriggerTime();
+  SoTimerQueueSensor * first;
+  double triggertime;
+  if ((first = PRIVATE(this)->timerqueue.getFirst(triggertime)) != NULL) {
+    tm = first->getTriggerTime();
     UNLOCK_TIMER_QUEUE(this);
     return TRUE;
   }
@@ -900,6 +1003,163 @@ SoSensorManager::mergeDelayQueues(void)
 }
 
 
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/sensors/SoAlarmSensor.h>
+#include <Inventor/sensors/SoOneShotSensor.h>
+#include <Inventor/sensors/SoSensorManager.h>
+
+static SbList<int> * sensororder = NULL;
+
+static void
+recordSensorOrder(void * data, SoSensor *)
+{
+  sensororder->append(*static_cast<int *>(data));
+}
+
+static SbBool
+checkSensorOrder(const int * expected, const int num)
+{
+  if (sensororder->getLength() != num) return FALSE;
+  for (int i = 0; i < num; i++) {
+    if ((*sensororder)[i] != expected[i]) return FALSE;
+  }
+  return TRUE;
+}
+
+// Exposes setTriggerTime(), which reschedules a scheduled sensor.
+class TestAlarmSensor : public SoAlarmSensor {
+public:
+  TestAlarmSensor(SoSensorCB * func, void * data) : SoAlarmSensor(func, data) { }
+  void reschedule(const SbTime & time) { this->setTriggerTime(time); }
+};
+
+BOOST_AUTO_TEST_CASE(delayQueueOrder)
+{
+  SoSensorManager * sm = SoDB::getSensorManager();
+  SbList<int> order;
+  sensororder = &order;
+
+  enum { NUM = 100 };
+  int ids[NUM + 1];
+  SoOneShotSensor * sensors[NUM + 1];
+  int i;
+  for (i = 0; i <= NUM; i++) {
+    ids[i] = i;
+    sensors[i] = new SoOneShotSensor(recordSensorOrder, &ids[i]);
+  }
+
+  // equal priorities are processed in scheduling order, and a
+  // sensor rescheduled with setPriority() goes last in its new group
+  const uint32_t priorities[] = { 100, 50, 100, 50, 100, 200, 100 };
+  for (i = 0; i < 7; i++) {
+    sensors[i]->setPriority(priorities[i]);
+    sensors[i]->schedule();
+  }
+  sensors[2]->setPriority(50);
+  sensors[3]->unschedule();
+  sensors[0]->setPriority(150);
+  sensors[0]->setPriority(100);
+  sm->processDelayQueue(TRUE);
+  const int expected[] = { 1, 2, 4, 6, 0, 5 };
+  BOOST_CHECK_MESSAGE(checkSensorOrder(expected, 6),
+                      "delay sensors not processed in FIFO order");
+
+  // unscheduling most sensors compacts the queue
+  order.truncate(0);
+  for (i = 0; i < NUM; i++) {
+    sensors[i]->setPriority(100);
+    sensors[i]->schedule();
+  }
+  for (i = 0; i < NUM; i++) {
+    if (i != 20 && i != 60 && i != 90) sensors[i]->unschedule();
+  }
+  sensors[60]->setPriority(50);
+  sensors[20]->setPriority(101);
+  sensors[NUM]->setPriority(100);
+  sensors[NUM]->schedule();
+  sm->processDelayQueue(TRUE);
+  const int expectedcompacted[] = { 60, 90, NUM, 20 };
+  BOOST_CHECK_MESSAGE(checkSensorOrder(expectedcompacted, 4),
+                      "delay sensors not processed in FIFO order after compaction");
+
+  // priority 0 sensors are processed FIFO in the immediate queue
+  order.truncate(0);
+  for (i = 0; i < 4; i++) {
+    sensors[i]->setPriority(0);
+    sensors[i]->schedule();
+  }
+  sensors[1]->unschedule();
+  sensors[1]->schedule();
+  sm->processImmediateQueue();
+  const int expectedimmediate[] = { 0, 2, 3, 1 };
+  BOOST_CHECK_MESSAGE(checkSensorOrder(expectedimmediate, 4),
+                      "immediate sensors not processed in FIFO order");
+
+  for (i = 0; i <= NUM; i++) delete sensors[i];
+  sensororder = NULL;
+}
+
+BOOST_AUTO_TEST_CASE(timerQueueOrder)
+{
+  SoSensorManager * sm = SoDB::getSensorManager();
+  SbList<int> order;
+  sensororder = &order;
+
+  enum { NUM = 100 };
+  int ids[NUM + 1];
+  TestAlarmSensor * sensors[NUM + 1];
+  int i;
+  for (i = 0; i <= NUM; i++) {
+    ids[i] = i;
+    sensors[i] = new TestAlarmSensor(recordSensorOrder, &ids[i]);
+  }
+
+  // all trigger times are in the past, so every sensor triggers.
+  // Equal trigger times are processed in scheduling order, and a
+  // sensor rescheduled with setTriggerTime() goes last in its new
+  // group.
+  const double times[] = { 1.0, 1.0, 0.5, 1.0, 2.0, 1.0 };
+  for (i = 0; i < 6; i++) {
+    sensors[i]->setTime(SbTime(times[i]));
+    sensors[i]->schedule();
+  }
+  sensors[3]->unschedule();
+  sensors[0]->reschedule(SbTime(3.0));
+  sensors[0]->reschedule(SbTime(1.0));
+  sensors[4]->reschedule(SbTime(0.5));
+  sm->processTimerQueue();
+  const int expected[] = { 2, 4, 1, 5, 0 };
+  BOOST_CHECK_MESSAGE(checkSensorOrder(expected, 5),
+                      "timer sensors not processed in FIFO order");
+
+  // unscheduling most sensors compacts the queue
+  order.truncate(0);
+  for (i = 0; i < NUM; i++) {
+    sensors[i]->setTime(SbTime(1.0));
+    sensors[i]->schedule();
+  }
+  for (i = 0; i < NUM; i++) {
+    if (i != 20 && i != 60 && i != 90) sensors[i]->unschedule();
+  }
+  sensors[60]->reschedule(SbTime(0.5));
+  sensors[20]->reschedule(SbTime(1.5));
+  sensors[NUM]->setTime(SbTime(1.0));
+  sensors[NUM]->schedule();
+  sm->processTimerQueue();
+  const int expectedcompacted[] = { 60, 90, NUM, 20 };
+  BOOST_CHECK_MESSAGE(checkSensorOrder(expectedcompacted, 4),
+                      "timer sensors not processed in FIFO order after compaction");
+
+  for (i = 0; i <= NUM; i++) delete sensors[i];
+  sensororder = NULL;
+}
+
+#endif // COIN_TEST_SUITE
+
 #undef DEBUG_DELAY_SENSORHANDLING
 #undef DEBUG_TIMER_SENSORHANDLING
 #undef ALIVE_PATTERN
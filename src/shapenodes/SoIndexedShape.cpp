@@ -43,6 +43,8 @@
 
 #include <Inventor/nodes/SoIndexedShape.h>
 
+#include <cfloat>
+
 #include <Inventor/actions/SoAction.h>
 #include <Inventor/elements/SoCoordinateElement.h>
 #include <Inventor/elements/SoShapeHintsElement.h>
@@ -164,14 +166,22 @@ SoIndexedShape::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
       vp->vertex.getValues(0) :
       coordelem->getArrayPtr3();
 
+    float bmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float bmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+
     const int32_t * ptr = this->coordIndex.getValues(0);
     const int32_t * endptr = ptr + this->coordIndex.getNum();
     while (ptr < endptr) {
       const int idx = *ptr++;
       if (idx < numcoords) {
         if (idx >= 0) {
-          box.extendBy(coords[idx]);
-          center += coords[idx];
+          const float * p = coords[idx].getValue();
+          for (int i = 0; i < 3; i++) {
+            if (p[i] < bmin[i]) bmin[i] = p[i];
+            if (p[i] > bmax[i]) bmax[i] = p[i];
+            sum[i] += p[i];
+          }
           numacc++;
         }
       }
@@ -186,6 +196,10 @@ SoIndexedShape::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
       }
 #endif // COIN_DEBUG
     }
+    if (numacc) {
+      box.setBounds(bmin[0], bmin[1], bmin[2], bmax[0], bmax[1], bmax[2]);
+      center.setValue(sum[0], sum[1], sum[2]);
+    }
   }
   else {
     SbVec3f tmp;
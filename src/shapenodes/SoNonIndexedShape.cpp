@@ -131,8 +131,8 @@ SoNonIndexedShape::computeCoordBBox(SoAction * action, int numVertices,
       vp->vertex.getValues(0) :
       coordelem->getArrayPtr3();
     
+    box.extendBy(coords + startidx, lastidx + 1 - startidx);
     for (int i = startidx; i <= lastidx; i++) {
-      box.extendBy(coords[i]);
       center += coords[i];
     }
   }
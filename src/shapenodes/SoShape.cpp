@@ -45,6 +45,8 @@
 
 #include <Inventor/nodes/SoShape.h>
 
+#include <cfloat>
+#include <cmath>
 #include <cstring>
 #include <cstdlib>
 
@@ -56,6 +58,7 @@
 #include <Inventor/C/tidbits.h>
 #include <Inventor/SbBox2f.h>
 #include <Inventor/SbClip.h>
+#include <Inventor/SbLine.h>
 #include <Inventor/SbPlane.h>
 #include <Inventor/SbTime.h>
 #include <Inventor/SoPickedPoint.h>
@@ -101,6 +104,7 @@
 #include <Inventor/misc/SoGLBigImage.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
 #include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoIndexedShape.h>
 #include <Inventor/nodes/SoLight.h>
 #include <Inventor/nodes/SoVertexProperty.h>
 #include <Inventor/nodes/SoVertexShape.h>
@@ -124,6 +128,7 @@
 
 // SoShape.cpp grew too big, so I had to move some code into new
 // files. pederb, 2001-07-18
+#include "soshape_pickcache.h"
 #include "soshape_primdata.h"
 #include "soshape_trianglesort.h"
 #include "soshape_bigtexture.h"
@@ -175,6 +180,7 @@ public:
   SoShapeP() {
     this->bboxcache = NULL;
     this->pvcache = NULL;
+    this->pickcache = NULL;
     this->bumprender = NULL;
     this->rendercnt = 0;
     this->flags = 0;
@@ -182,22 +188,26 @@ public:
   ~SoShapeP() {
     if (this->bboxcache) { this->bboxcache->unref(); }
     if (this->pvcache) { this->pvcache->unref(); }
+    if (this->pickcache) { this->pickcache->unref(); }
     delete this->bumprender;
   }
   enum {
     RENDERCNT_BITS = 4,     // bits needed to store rendercnt
-    FLAG_BITS = 4           // bits needed to store flags
+    FLAG_BITS = 6           // bits needed to store flags
   };
   enum Flags {
     SHOULD_BBOX_CACHE = 0x1,
     NEED_SETUP_SHAPE_HINTS = 0x2,
     DISABLE_VERTEX_ARRAY_CACHE = 0x4,
+    SHOULD_PICK_CACHE = 0x8
   };
 
   static void calibrateBBoxCache(void);
   static double bboxcachetimelimit;
+  static SbBool usepickcache;
   SoBoundingBoxCache * bboxcache;
   SoPrimitiveVertexCache * pvcache;
+  soshape_pickcache * pickcache;
   soshape_bumprender * bumprender;
   uint32_t flags : FLAG_BITS;
   // stores the number of frames rendered with no node changes
@@ -251,6 +261,7 @@ public:
 };
 
 double SoShapeP::bboxcachetimelimit;
+SbBool SoShapeP::usepickcache = TRUE;
 
 SbMutex * SoShapeP::mutex = NULL;
 
@@ -276,6 +287,9 @@ typedef struct {
   soshape_bigtexture * currentbigtexture;
   // used in generatePrimitives() callbacks to set correct material
   SoMaterialBundle * currentbundle;
+  // set while building a pick cache in SoShape::rayPick()
+  soshape_pickcache * pickcache;
+  const SoShape * pickcacheshape;
 
   int rendermode;
 } soshape_staticdata;
@@ -303,6 +317,8 @@ soshape_construct_staticdata(void * closure)
   data->bigtexturecontext = new SbList <uint32_t>;
   data->primdata = new soshape_primdata();
   data->trianglesort = new soshape_trianglesort();
+  data->pickcache = NULL;
+  data->pickcacheshape = NULL;
   data->rendermode = NORMAL;
 }
 
@@ -379,6 +395,9 @@ SoShape::initClass(void)
                   soshape_destruct_staticdata);
   SoShapeP::calibrateBBoxCache();
 
+  const char * env = coin_getenv("COIN_RAYPICK_CACHE");
+  if (env && (atoi(env) == 0)) SoShapeP::usepickcache = FALSE;
+
   coin_atexit((coin_atexit_f *)SoShapeP::cleanup, CC_ATEXIT_NORMAL);
 }
 
@@ -458,11 +477,116 @@ SoShape::rayPick(SoRayPickAction * action)
     if (!PRIVATE(this)->bboxcache ||
         !PRIVATE(this)->bboxcache->isValid(action->getState()) ||
         soshape_ray_intersect(action, PRIVATE(this)->bboxcache->getProjectedBox())) {
-      this->generatePrimitives(action);
+      if (SoShapeP::usepickcache) {
+        this->rayPickCached(action);
+      }
+      else {
+        this->generatePrimitives(action);
+      }
     }
   }
 }
 
+// Returns TRUE if the action already has a picked point closer than
+// nearest, the distance along the object space pick ray of the
+// nearest intersection with the shape. No point from the shape would
+// then be picked, since only the closest point is kept unless all
+// points are picked. The points are compared in object space, along
+// the pick ray, with a margin for the float precision.
+static SbBool
+soshape_has_closer_pick(SoRayPickAction * action, const float nearest)
+{
+  if (nearest == -FLT_MAX || action->isPickAll()) return FALSE;
+  const SoPickedPoint * pp = action->getPickedPoint(0);
+  if (pp == NULL) return FALSE;
+
+  const SbMatrix world2obj =
+    SoModelMatrixElement::get(action->getState()).inverse();
+  SbVec3f objpt;
+  world2obj.multVecMatrix(pp->getPoint(), objpt);
+  const SbLine & line = action->getLine();
+  const float t = (objpt - line.getPosition()).dot(line.getDirection());
+  const float eps = 1e-4f * (float(fabs(t)) + float(fabs(nearest))) + FLT_MIN;
+  return nearest > t + eps;
+}
+
+// Picks using the pick cache, which keeps the object space triangles
+// of the shape in a bounding volume hierarchy. When the pick ray
+// misses all the triangles, or only hits them behind a point which
+// has already been picked, primitives are not generated at all.
+// Otherwise primitives are generated as usual, so the picked points
+// and details are the same as without the cache.
+void
+SoShape::rayPickCached(SoRayPickAction * action)
+{
+  SoState * state = action->getState();
+
+  // lock since pickcache is shared among all threads
+  PRIVATE(this)->lock();
+  if (PRIVATE(this)->pickcache) {
+    if (PRIVATE(this)->pickcache->isValid(state)) {
+      float nearest;
+      const SbBool hit = PRIVATE(this)->pickcache->mightIntersect(action, nearest);
+      PRIVATE(this)->unlock();
+      if (hit && !soshape_has_closer_pick(action, nearest)) {
+        this->generatePrimitives(action);
+      }
+      return;
+    }
+    PRIVATE(this)->pickcache->unref();
+    PRIVATE(this)->pickcache = NULL;
+    // don't create pick caches for shapes that change between picks
+    PRIVATE(this)->flags &= ~SoShapeP::SHOULD_PICK_CACHE;
+  }
+
+  // only create the cache when the shape is picked a second time
+  // without changes, to avoid keeping copies of the triangles of
+  // shapes that are only picked once.
+  if ((PRIVATE(this)->flags & SoShapeP::SHOULD_PICK_CACHE) == 0) {
+    PRIVATE(this)->flags |= SoShapeP::SHOULD_PICK_CACHE;
+    PRIVATE(this)->unlock();
+    this->generatePrimitives(action);
+    return;
+  }
+
+  PRIVATE(this)->unlock();
+
+  // Build the cache without holding the lock, since generatePrimitives()
+  // runs arbitrary traversal code which might need the lock itself
+  // (getBBox() for instance), and to avoid serializing all picking. The
+  // cache being built is only visible to this thread until published.
+  soshape_staticdata * shapedata = soshape_get_staticdata();
+  soshape_pickcache * prevcache = shapedata->pickcache;
+  const SoShape * prevshape = shapedata->pickcacheshape;
+  SbBool storedinvalid = SoCacheElement::setInvalid(FALSE);
+  // must push state to make cache dependencies work
+  state->push();
+  soshape_pickcache * cache = new soshape_pickcache(state);
+  cache->ref();
+  SoCacheElement::set(state, cache);
+  shapedata->pickcache = cache;
+  shapedata->pickcacheshape = this;
+  // the primitives are picked as usual while collecting the triangles
+  this->generatePrimitives(action);
+  shapedata->pickcache = prevcache;
+  shapedata->pickcacheshape = prevshape;
+  state->pop();
+  SoCacheElement::setInvalid(storedinvalid);
+  cache->close();
+
+  PRIVATE(this)->lock();
+  // notify() clears SHOULD_PICK_CACHE if the shape changed while the
+  // cache was built, and another thread might have published a cache
+  // in the meantime. Keep the existing cache in both cases.
+  if ((PRIVATE(this)->flags & SoShapeP::SHOULD_PICK_CACHE) &&
+      PRIVATE(this)->pickcache == NULL) {
+    PRIVATE(this)->pickcache = cache;
+    cache = NULL;
+  }
+  PRIVATE(this)->unlock();
+  if (cache) cache->unref();
+}
+
 /*!
   A convenience function that returns the size of a \a boundingbox
   projected onto the screen. Useful for \c SCREEN_SPACE complexity
@@ -989,6 +1113,13 @@ SoShape::invokeTriangleCallbacks(SoAction * const action,
   if (action->getTypeId().isDerivedFrom(SoRayPickAction::getClassTypeId())) {
     SoRayPickAction * ra = (SoRayPickAction *) action;
 
+    soshape_staticdata * shapedata = soshape_get_staticdata();
+    if (shapedata->pickcacheshape == this) {
+      if (shapedata->pickcache) {
+        shapedata->pickcache->addTriangle(v1->getPoint(), v2->getPoint(), v3->getPoint());
+      }
+    }
+
     SbVec3f intersection;
     SbVec3f barycentric;
     SbBool front;
@@ -1100,6 +1231,11 @@ SoShape::invokeLineSegmentCallbacks(SoAction * const action,
   if (action->getTypeId().isDerivedFrom(SoRayPickAction::getClassTypeId())) {
     SoRayPickAction * ra = (SoRayPickAction *) action;
 
+    soshape_staticdata * shapedata = soshape_get_staticdata();
+    if (shapedata->pickcacheshape == this) {
+      if (shapedata->pickcache) shapedata->pickcache->addLineOrPoint();
+    }
+
     SbVec3f intersection;
     if (ra->intersect(v1->getPoint(), v2->getPoint(), intersection)) {
       if (ra->isBetweenPlanes(intersection)) {
@@ -1174,6 +1310,11 @@ SoShape::invokePointCallbacks(SoAction * const action,
   if (action->getTypeId().isDerivedFrom(SoRayPickAction::getClassTypeId())) {
     SoRayPickAction * ra = (SoRayPickAction *) action;
 
+    soshape_staticdata * shapedata = soshape_get_staticdata();
+    if (shapedata->pickcacheshape == this) {
+      if (shapedata->pickcache) shapedata->pickcache->addLineOrPoint();
+    }
+
     SbVec3f intersection = v->getPoint();
     if (ra->intersect(intersection)) {
       if (ra->isBetweenPlanes(intersection)) {
@@ -1428,7 +1569,10 @@ SoShape::notify(SoNotList * nl)
   if (PRIVATE(this)->pvcache) {
     PRIVATE(this)->pvcache->invalidate();
   }
-  PRIVATE(this)->flags &= ~SoShapeP::SHOULD_BBOX_CACHE;
+  if (PRIVATE(this)->pickcache) {
+    PRIVATE(this)->pickcache->invalidate();
+  }
+  PRIVATE(this)->flags &= ~(SoShapeP::SHOULD_BBOX_CACHE|SoShapeP::SHOULD_PICK_CACHE);
   PRIVATE(this)->rendercnt = 0;
   PRIVATE(this)->unlock();
 }
@@ -1571,6 +1715,15 @@ SoShape::startVertexArray(SoGLRenderAction * action,
   if (!SoGLDriverDatabase::isSupported(glue, SO_GL_VBO_IN_DISPLAYLIST)) {
     if (SoCacheElement::anyOpen(state)) {
       dovbo = FALSE;
+      // The vertex data is already retained on the server in a VBO,
+      // and recording it as plain vertex arrays would just copy it
+      // into the display list. Tell the auto caching heuristics to
+      // stop building render caches here so the VBO is used for the
+      // next frames instead.
+      if (vboelem->getVertexVBO()) {
+        SoGLCacheContextElement::shouldAutoCache(state,
+                                                 SoGLCacheContextElement::DONT_AUTO_CACHE);
+      }
     }
   }
   SoVBO * vertexvbo = dovbo ? vboelem->getVertexVBO() : NULL;
@@ -1752,6 +1905,30 @@ SoShape::finishVertexArray(SoGLRenderAction * action,
   SoGLVertexAttributeElement::getInstance(state)->disableVBO(action);
 }
 
+// Returns an estimate of the number of unique vertices the shape
+// will add to its primitive vertex cache, or 0 if not known. For
+// indexed shapes this is the smaller of the number of indices and the
+// number of coordinates. Reading SoCoordinateElement makes the open
+// cache depend on it, which generatePrimitives() does for these
+// shapes anyway.
+static int
+soshape_estimate_num_vertices(SoShape * shape, SoState * state)
+{
+  if (!shape->isOfType(SoIndexedShape::getClassTypeId())) return 0;
+  SoIndexedShape * indexed = static_cast<SoIndexedShape *>(shape);
+
+  int numcoords;
+  SoVertexProperty * vp =
+    static_cast<SoVertexProperty *>(indexed->vertexProperty.getValue());
+  if (vp && vp->vertex.getNum() > 0) {
+    numcoords = vp->vertex.getNum();
+  }
+  else {
+    numcoords = SoCoordinateElement::getInstance(state)->getNum();
+  }
+  return SbMin(numcoords, indexed->coordIndex.getNum());
+}
+
 void
 SoShape::validatePVCache(SoGLRenderAction * action)
 {
@@ -1771,6 +1948,7 @@ SoShape::validatePVCache(SoGLRenderAction * action)
     PRIVATE(this)->pvcache = new SoPrimitiveVertexCache(state);
     PRIVATE(this)->pvcache->ref();
     SoCacheElement::set(state, PRIVATE(this)->pvcache);
+    PRIVATE(this)->pvcache->reserve(soshape_estimate_num_vertices(this, state));
     shapedata->rendermode = PVCACHE;
     this->generatePrimitives(action);
     shapedata->rendermode = NORMAL;
@@ -1790,3 +1968,64 @@ SoShape::validatePVCache(SoGLRenderAction * action)
 
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+// check that picking gives the same result before and after the pick
+// cache has been built, both for rays hitting the triangles and rays
+// inside the bounding box missing them.
+BOOST_AUTO_TEST_CASE(rayPickCache)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+  coords->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+  coords->point.set1Value(2, SbVec3f(0.0f, 1.0f, 0.0f));
+  coords->point.set1Value(3, SbVec3f(9.0f, 9.0f, 1.0f));
+  coords->point.set1Value(4, SbVec3f(10.0f, 9.0f, 1.0f));
+  coords->point.set1Value(5, SbVec3f(9.0f, 10.0f, 1.0f));
+  root->addChild(coords);
+  SoFaceSet * faceset = new SoFaceSet;
+  faceset->numVertices.set1Value(0, 3);
+  faceset->numVertices.set1Value(1, 3);
+  root->addChild(faceset);
+
+  SoRayPickAction rp(SbViewportRegion(100, 100));
+  for (int i = 0; i < 3; i++) {
+    rp.setRay(SbVec3f(0.25f, 0.25f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+    rp.apply(root);
+    const SoPickedPoint * pp = rp.getPickedPoint();
+    BOOST_REQUIRE(pp != NULL);
+    BOOST_CHECK(pp->getPoint() == SbVec3f(0.25f, 0.25f, 0.0f));
+
+    rp.setRay(SbVec3f(9.25f, 9.25f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+    rp.apply(root);
+    pp = rp.getPickedPoint();
+    BOOST_REQUIRE(pp != NULL);
+    BOOST_CHECK(pp->getPoint() == SbVec3f(9.25f, 9.25f, 1.0f));
+
+    rp.setRay(SbVec3f(5.0f, 5.0f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+    rp.apply(root);
+    BOOST_CHECK(rp.getPickedPoint() == NULL);
+  }
+
+  // the cache must be invalidated when the shape changes
+  coords->point.set1Value(0, SbVec3f(4.0f, 4.0f, 0.0f));
+  coords->point.set1Value(1, SbVec3f(6.0f, 4.0f, 0.0f));
+  coords->point.set1Value(2, SbVec3f(4.0f, 6.0f, 0.0f));
+  rp.setRay(SbVec3f(4.5f, 4.5f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rp.apply(root);
+  BOOST_CHECK(rp.getPickedPoint() != NULL);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -58,6 +58,7 @@
 #include "SoTriangleStripSet.cpp"
 #include "SoVertexShape.cpp"
 #include "soshape_bigtexture.cpp"
+#include "soshape_pickcache.cpp"
 #include "soshape_primdata.cpp"
 #include "soshape_trianglesort.cpp"
 #include "soshape_bumprender.cpp"
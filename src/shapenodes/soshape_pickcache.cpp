@@ -0,0 +1,266 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+#include "shapenodes/soshape_pickcache.h"
+
+#include <cassert>
+#include <cfloat>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/SbLine.h>
+
+// Maximum number of triangles in a leaf node.
+#define PICKCACHE_LEAF_SIZE 4
+
+soshape_pickcache::soshape_pickcache(SoState * state)
+  : SoCache(state),
+    haslinesorpoints(FALSE)
+{
+}
+
+soshape_pickcache::~soshape_pickcache()
+{
+}
+
+void
+soshape_pickcache::addTriangle(const SbVec3f & v0,
+                               const SbVec3f & v1,
+                               const SbVec3f & v2)
+{
+  this->vertices.append(v0);
+  this->vertices.append(v1);
+  this->vertices.append(v2);
+}
+
+// Lines and points are picked with a radius around the ray, so the
+// cache can not be used to rule out intersections for shapes with
+// such primitives.
+void
+soshape_pickcache::addLineOrPoint(void)
+{
+  this->haslinesorpoints = TRUE;
+}
+
+// Builds the bounding volume hierarchy. Must be called after all
+// triangles have been added.
+void
+soshape_pickcache::close(void)
+{
+  this->nodes.truncate(0);
+  this->bbox.makeEmpty();
+  const int numtri = this->vertices.getLength() / 3;
+  if (this->haslinesorpoints || numtri == 0) {
+    this->vertices.truncate(0, TRUE);
+    return;
+  }
+  this->bbox.extendBy(this->vertices.getArrayPtr(), numtri * 3);
+
+  int * order = new int[numtri];
+  for (int i = 0; i < numtri; i++) order[i] = i;
+  (void) this->buildNode(order, 0, numtri);
+
+  // store the triangles in leaf order, for better memory locality
+  // when traversing the hierarchy
+  SbList <SbVec3f> sorted(numtri * 3);
+  for (int i = 0; i < numtri; i++) {
+    const SbVec3f * v = this->vertices.getArrayPtr() + order[i] * 3;
+    sorted.append(v[0]);
+    sorted.append(v[1]);
+    sorted.append(v[2]);
+  }
+  delete[] order;
+  this->vertices = sorted;
+}
+
+// Splits the triangles order[first] ... order[first+count-1] at the
+// median of their centroids along the longest axis of the node's
+// bounding box, so the depth of the hierarchy is at most
+// log2(numtriangles).
+int
+soshape_pickcache::buildNode(int * order, const int first, const int count)
+{
+  const SbVec3f * v = this->vertices.getArrayPtr();
+  node n;
+  int i, j;
+  for (j = 0; j < 3; j++) {
+    n.bmin[j] = FLT_MAX;
+    n.bmax[j] = -FLT_MAX;
+  }
+  for (i = first; i < first + count; i++) {
+    const SbVec3f * tri = v + order[i] * 3;
+    for (int k = 0; k < 3; k++) {
+      for (j = 0; j < 3; j++) {
+        if (tri[k][j] < n.bmin[j]) n.bmin[j] = tri[k][j];
+        if (tri[k][j] > n.bmax[j]) n.bmax[j] = tri[k][j];
+      }
+    }
+  }
+
+  const int idx = this->nodes.getLength();
+  if (count <= PICKCACHE_LEAF_SIZE) {
+    n.first = first;
+    n.count = count;
+    this->nodes.append(n);
+    return idx;
+  }
+  n.count = 0;
+  n.first = -1;
+  this->nodes.append(n);
+
+  int axis = 0;
+  for (j = 1; j < 3; j++) {
+    if (n.bmax[j] - n.bmin[j] > n.bmax[axis] - n.bmin[axis]) axis = j;
+  }
+
+  // quickselect on the centroid (times three) along axis
+  const int mid = first + count / 2;
+  int lo = first;
+  int hi = first + count - 1;
+  while (lo < hi) {
+    const SbVec3f * p = v + order[(lo + hi) / 2] * 3;
+    const float pivot = p[0][axis] + p[1][axis] + p[2][axis];
+    int l = lo, h = hi;
+    while (l <= h) {
+      const SbVec3f * a;
+      while (a = v + order[l] * 3, a[0][axis] + a[1][axis] + a[2][axis] < pivot) l++;
+      while (a = v + order[h] * 3, a[0][axis] + a[1][axis] + a[2][axis] > pivot) h--;
+      if (l <= h) {
+        const int tmp = order[l];
+        order[l] = order[h];
+        order[h] = tmp;
+        l++;
+        h--;
+      }
+    }
+    if (mid <= h) hi = h;
+    else if (mid >= l) lo = l;
+    else break;
+  }
+
+  (void) this->buildNode(order, first, mid - first);
+  const int second = this->buildNode(order, mid, first + count - mid);
+  this->nodes[idx].first = second;
+  return idx;
+}
+
+// Returns FALSE if the current (object space) pick ray of action is
+// guaranteed to miss all the triangles in the cache, TRUE if it
+// might hit one of them. On TRUE, nearest is set to the distance
+// along the object space pick ray to the nearest hit, or to -FLT_MAX
+// if it's not known.
+SbBool
+soshape_pickcache::mightIntersect(SoRayPickAction * action, float & nearest) const
+{
+  nearest = -FLT_MAX;
+  if (this->haslinesorpoints) return TRUE;
+  const int numnodes = this->nodes.getLength();
+  if (numnodes == 0) return FALSE;
+
+  const SbLine & line = action->getLine();
+  const SbVec3f & pos = line.getPosition();
+  const SbVec3f & dir = line.getDirection();
+
+  // The boxes are tested against the single precision line, while
+  // the triangles are tested against the double precision ray, so
+  // pad the boxes to make sure no intersections are missed.
+  SbVec3f bmin, bmax;
+  this->bbox.getBounds(bmin, bmax);
+  const SbVec3f center = (bmin + bmax) * 0.5f;
+  const float eps = 1e-5f * ((pos - center).length() + (bmax - bmin).length()) + FLT_MIN;
+
+  float invdir[3];
+  for (int j = 0; j < 3; j++) {
+    invdir[j] = (dir[j] != 0.0f) ? 1.0f / dir[j] : 0.0f;
+  }
+
+  const node * nodes = this->nodes.getArrayPtr();
+  const SbVec3f * v = this->vertices.getArrayPtr();
+
+  // all the nodes the ray passes through are visited, except those
+  // entirely behind the nearest hit found so far
+  SbBool hit = FALSE;
+  float nearesthit = FLT_MAX;
+  int stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const node & n = nodes[stack[--top]];
+
+    float tmin = -FLT_MAX;
+    float tmax = FLT_MAX;
+    SbBool miss = FALSE;
+    for (int j = 0; j < 3 && !miss; j++) {
+      const float lo = n.bmin[j] - eps;
+      const float hi = n.bmax[j] + eps;
+      if (invdir[j] == 0.0f) {
+        miss = (pos[j] < lo) || (pos[j] > hi);
+      }
+      else {
+        float t0 = (lo - pos[j]) * invdir[j];
+        float t1 = (hi - pos[j]) * invdir[j];
+        if (t0 > t1) { const float tmp = t0; t0 = t1; t1 = tmp; }
+        if (t0 > tmin) tmin = t0;
+        if (t1 < tmax) tmax = t1;
+        miss = tmin > tmax;
+      }
+    }
+    if (miss || (hit && tmin > nearesthit)) continue;
+
+    if (n.count > 0) {
+      SbVec3f isect, barycentric;
+      SbBool front;
+      for (int i = n.first; i < n.first + n.count; i++) {
+        const SbVec3f * tri = v + i * 3;
+        if (action->intersect(tri[0], tri[1], tri[2], isect, barycentric, front) &&
+            action->isBetweenPlanes(isect)) {
+          const float t = (isect - pos).dot(dir);
+          if (t < nearesthit) nearesthit = t;
+          hit = TRUE;
+        }
+      }
+    }
+    else {
+      assert(top + 2 <= 64);
+      stack[top++] = n.first;
+      stack[top++] = static_cast<int>(&n - nodes) + 1;
+    }
+  }
+  if (hit) nearest = nearesthit;
+  return hit;
+}
+
+#undef PICKCACHE_LEAF_SIZE
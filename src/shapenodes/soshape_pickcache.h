@@ -0,0 +1,84 @@
+#ifndef COIN_SOSHAPE_PICKCACHE_H
+#define COIN_SOSHAPE_PICKCACHE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/caches/SoCache.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/SbBox3f.h>
+
+class SoRayPickAction;
+
+// Object space triangles of a shape, organized in a bounding volume
+// hierarchy, used by SoShape::rayPick() to find out quickly whether
+// the pick ray misses all the triangles of the shape, or only hits
+// them behind an already picked point.
+class soshape_pickcache : public SoCache {
+  typedef SoCache inherited;
+public:
+  soshape_pickcache(SoState * state);
+
+  void addTriangle(const SbVec3f & v0, const SbVec3f & v1, const SbVec3f & v2);
+  void addLineOrPoint(void);
+  void close(void);
+
+  SbBool mightIntersect(SoRayPickAction * action, float & nearest) const;
+
+protected:
+  virtual ~soshape_pickcache();
+
+private:
+  typedef struct {
+    float bmin[3];
+    float bmax[3];
+    // leaf nodes: first triangle and number of triangles. Internal
+    // nodes: index of the second child, and count == 0. The first
+    // child always follows its parent.
+    int first;
+    int count;
+  } node;
+
+  int buildNode(int * order, const int first, const int count);
+
+  SbList <SbVec3f> vertices;
+  SbList <node> nodes;
+  SbBox3f bbox;
+  SbBool haslinesorpoints;
+};
+
+#endif // !COIN_SOSHAPE_PICKCACHE_H
@@ -33,6 +33,7 @@
 #include "shapenodes/soshape_trianglesort.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 
 #ifdef HAVE_CONFIG_H
@@ -85,22 +86,69 @@ soshape_trianglesort::triangle(SoState *,
   this->pvlist->append(*v3);
 }
 
-// qsort() callback.
-//
-// "extern C" wrapper is needed with the OSF1/cxx compiler (probably a
-// bug in the compiler, but it doesn't seem to hurt to do this
-// anyway).
-extern "C" {
-static int
-compare_triangles(const void * ptr1, const void * ptr2)
+// Maps a float to an unsigned integer with the same ordering.
+static inline uint32_t
+soshape_trianglesort_float_key(const float f)
 {
-  soshape_trianglesort::sorted_triangle * tri1 = (soshape_trianglesort::sorted_triangle*) ptr1;
-  soshape_trianglesort::sorted_triangle * tri2 = (soshape_trianglesort::sorted_triangle*) ptr2;
-
-  if (tri1->dist > tri2->dist) return -1;
-  if (tri1->dist == tri2->dist) return tri2->backface - tri1->backface;
-  return 1;
+  uint32_t u;
+  (void)memcpy(&u, &f, sizeof(uint32_t));
+  return (u & 0x80000000) ? ~u : (u | 0x80000000);
 }
+
+// Sorts the triangles on decreasing distance, with back faces before
+// front faces at equal distance. An LSD radix sort on the bit patterns
+// of the distances is used, which is O(n) as opposed to the
+// O(n log(n)) of qsort(). The triangles are generated anew for each
+// frame, so there is no previous order to exploit.
+static void
+soshape_trianglesort_sort(soshape_trianglesort::sorted_triangle * tarray,
+                          const int n)
+{
+  uint32_t * keys = new uint32_t[n * 2];
+  soshape_trianglesort::sorted_triangle * tmp =
+    new soshape_trianglesort::sorted_triangle[n];
+  uint32_t * srckeys = keys;
+  uint32_t * dstkeys = keys + n;
+  soshape_trianglesort::sorted_triangle * src = tarray;
+  soshape_trianglesort::sorted_triangle * dst = tmp;
+
+  // stable partition with the back faces first, the radix passes
+  // below keep this order for equal distances
+  int i, pos = 0;
+  for (i = 0; i < n; i++) { if (tarray[i].backface) dst[pos++] = tarray[i]; }
+  for (i = 0; i < n; i++) { if (!tarray[i].backface) dst[pos++] = tarray[i]; }
+  src = tmp; dst = tarray;
+
+  // inverted keys to sort on decreasing distance
+  for (i = 0; i < n; i++) srckeys[i] = ~soshape_trianglesort_float_key(src[i].dist);
+
+  for (int shift = 0; shift < 32; shift += 8) {
+    int count[256];
+    (void)memset(count, 0, sizeof(count));
+    for (i = 0; i < n; i++) count[(srckeys[i] >> shift) & 0xff]++;
+    // all keys have the same value for this byte
+    if (count[(srckeys[0] >> shift) & 0xff] == n) continue;
+
+    int sum = 0;
+    for (i = 0; i < 256; i++) {
+      const int c = count[i];
+      count[i] = sum;
+      sum += c;
+    }
+    for (i = 0; i < n; i++) {
+      const int p = count[(srckeys[i] >> shift) & 0xff]++;
+      dstkeys[p] = srckeys[i];
+      dst[p] = src[i];
+    }
+    uint32_t * tmpkeys = srckeys; srckeys = dstkeys; dstkeys = tmpkeys;
+    soshape_trianglesort::sorted_triangle * t = src; src = dst; dst = t;
+  }
+
+  if (src != tarray) {
+    (void)memcpy(tarray, src, n * sizeof(soshape_trianglesort::sorted_triangle));
+  }
+  delete[] tmp;
+  delete[] keys;
 }
 
 void
@@ -180,8 +228,9 @@ soshape_trianglesort::endShape(SoState * state, SoMaterialBundle & mb)
     }
   }
 
-  const sorted_triangle * tarray = this->trianglelist->getArrayPtr();
-  qsort((void*)tarray, n, sizeof(sorted_triangle), compare_triangles);
+  sorted_triangle * tarray =
+    const_cast<sorted_triangle *>(this->trianglelist->getArrayPtr());
+  soshape_trianglesort_sort(tarray, n);
 
   int idx;
 